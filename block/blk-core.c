@@ -54,6 +54,8 @@ static struct workqueue_struct *kblockd_workqueue;
 
 extern atomic_t emmc_reboot;
 
+static void blk_sw_stage_sync(struct request_queue *q);
+
 static void drive_stat_acct(struct request *rq, int new_io)
 {
 	struct hd_struct *part;
@@ -267,6 +269,9 @@ void blk_drain_queue(struct request_queue *q, bool drain_all)
 		bool drain = false;
 		int i;
 
+		if (q->sw_stage)
+			blk_sw_stage_sync(q);
+
 		spin_lock_irq(q->queue_lock);
 
 		elv_drain_elevator(q);
@@ -972,6 +977,247 @@ out:
 	return ret;
 }
 
+/*
+ * Per-CPU software submission stage.  Requests for a staged queue are
+ * collected on the submitting CPU's list under a lock that is only
+ * contended when a migrated submitter flushes it, merged there, and
+ * handed to the elevator in batches so the queue lock is taken once per
+ * batch instead of once per bio.  Only async writes from a plugged
+ * submitter are held back; the stage is flushed inline for anything
+ * else, and the plug remembers the stage so flushing the plug flushes it.
+ */
+struct blk_sw_stage {
+	spinlock_t		lock;
+	struct list_head	list;
+	unsigned int		nr;
+	struct request_queue	*q;
+	struct work_struct	work;
+};
+
+static bool blk_sw_stage_hold(struct bio *bio)
+{
+	return bio_data_dir(bio) == WRITE && !(bio->bi_rw & REQ_SYNC) &&
+		current->plug;
+}
+
+/* Called with stage->lock held and local interrupts disabled. */
+static void __blk_sw_stage_flush(struct blk_sw_stage *stage,
+				 bool from_schedule)
+	__releases(stage->lock)
+{
+	struct request_queue *q = stage->q;
+	struct request *rq;
+	unsigned int depth;
+	LIST_HEAD(list);
+
+	if (list_empty(&stage->list)) {
+		spin_unlock(&stage->lock);
+		return;
+	}
+
+	list_splice_init(&stage->list, &list);
+	depth = stage->nr;
+	stage->nr = 0;
+	spin_unlock(&stage->lock);
+
+	spin_lock(q->queue_lock);
+	while (!list_empty(&list)) {
+		rq = list_entry_rq(list.next);
+		list_del_init(&rq->queuelist);
+
+		if (unlikely(blk_queue_dead(q))) {
+			__blk_end_request_all(rq, -ENODEV);
+			continue;
+		}
+		__elv_add_request(q, rq, ELEVATOR_INSERT_SORT_MERGE);
+	}
+
+	trace_block_unplug(q, depth, !from_schedule);
+	if (blk_queue_dead(q)) {
+		spin_unlock(q->queue_lock);
+	} else if (from_schedule) {
+		spin_unlock(q->queue_lock);
+		blk_run_queue_async(q);
+	} else {
+		__blk_run_queue(q);
+		spin_unlock(q->queue_lock);
+	}
+}
+
+static void blk_sw_stage_flush(struct blk_sw_stage *stage, bool from_schedule)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&stage->lock, flags);
+	__blk_sw_stage_flush(stage, from_schedule);
+	local_irq_restore(flags);
+}
+
+static void blk_sw_stage_track(struct blk_sw_stage *stage)
+{
+	struct blk_plug *plug = current->plug;
+	struct blk_sw_stage *old = plug->sw_stage;
+
+	if (old == stage)
+		return;
+
+	plug->sw_stage = stage;
+	if (old)
+		blk_sw_stage_flush(old, false);
+}
+
+static bool attempt_sw_stage_merge(struct request_queue *q, struct bio *bio)
+{
+	struct blk_sw_stage *stage;
+	struct request *rq;
+	unsigned long flags;
+	bool hold = blk_sw_stage_hold(bio);
+	bool ret = false;
+
+	local_irq_save(flags);
+	stage = this_cpu_ptr(q->sw_stage);
+	spin_lock(&stage->lock);
+
+	list_for_each_entry_reverse(rq, &stage->list, queuelist) {
+		int el_ret;
+
+		if (!blk_rq_merge_ok(rq, bio))
+			continue;
+
+		el_ret = blk_try_merge(rq, bio);
+		if (el_ret == ELEVATOR_BACK_MERGE) {
+			ret = bio_attempt_back_merge(q, rq, bio);
+			if (ret)
+				break;
+		} else if (el_ret == ELEVATOR_FRONT_MERGE) {
+			ret = bio_attempt_front_merge(q, rq, bio);
+			if (ret)
+				break;
+		}
+	}
+	if (ret && !hold)
+		__blk_sw_stage_flush(stage, false);
+	else
+		spin_unlock(&stage->lock);
+	local_irq_restore(flags);
+
+	if (ret && hold)
+		blk_sw_stage_track(stage);
+	return ret;
+}
+
+static void blk_sw_stage_work(struct work_struct *work)
+{
+	struct blk_sw_stage *stage = container_of(work, struct blk_sw_stage,
+						  work);
+
+	blk_sw_stage_flush(stage, false);
+}
+
+static void blk_sw_stage_add(struct request_queue *q, struct request *rq,
+			     bool hold)
+{
+	struct blk_sw_stage *stage;
+	unsigned long flags;
+	int cpu;
+
+	local_irq_save(flags);
+	cpu = smp_processor_id();
+	stage = per_cpu_ptr(q->sw_stage, cpu);
+	spin_lock(&stage->lock);
+
+	if (list_empty(&stage->list))
+		trace_block_plug(q);
+	list_add_tail(&rq->queuelist, &stage->list);
+	drive_stat_acct(rq, 1);
+
+	/*
+	 * A non-empty stage always has its work pending, which is what
+	 * blk_drain_queue() relies on to find staged requests.
+	 */
+	if (++stage->nr >= q->sw_stage_batch || !hold) {
+		__blk_sw_stage_flush(stage, false);
+	} else {
+		if (stage->nr == 1)
+			queue_work_on(cpu, kblockd_workqueue, &stage->work);
+		spin_unlock(&stage->lock);
+	}
+	local_irq_restore(flags);
+
+	if (hold)
+		blk_sw_stage_track(stage);
+}
+
+static void blk_sw_stage_sync(struct request_queue *q)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		flush_work(&per_cpu_ptr(q->sw_stage, cpu)->work);
+}
+
+int blk_queue_enable_sw_stage(struct request_queue *q, unsigned int batch)
+{
+	struct blk_sw_stage __percpu *stages;
+	int cpu;
+
+	if (!batch)
+		batch = BLK_MAX_REQUEST_COUNT;
+
+	if (q->sw_stage) {
+		spin_lock_irq(q->queue_lock);
+		q->sw_stage_batch = batch;
+		queue_flag_set(QUEUE_FLAG_SW_STAGE, q);
+		spin_unlock_irq(q->queue_lock);
+		return 0;
+	}
+
+	stages = alloc_percpu(struct blk_sw_stage);
+	if (!stages)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct blk_sw_stage *stage = per_cpu_ptr(stages, cpu);
+
+		spin_lock_init(&stage->lock);
+		INIT_LIST_HEAD(&stage->list);
+		stage->nr = 0;
+		stage->q = q;
+		INIT_WORK(&stage->work, blk_sw_stage_work);
+	}
+
+	spin_lock_irq(q->queue_lock);
+	q->sw_stage = stages;
+	q->sw_stage_batch = batch;
+	queue_flag_set(QUEUE_FLAG_SW_STAGE, q);
+	spin_unlock_irq(q->queue_lock);
+	return 0;
+}
+EXPORT_SYMBOL(blk_queue_enable_sw_stage);
+
+void blk_queue_disable_sw_stage(struct request_queue *q)
+{
+	if (!q->sw_stage)
+		return;
+
+	spin_lock_irq(q->queue_lock);
+	queue_flag_clear(QUEUE_FLAG_SW_STAGE, q);
+	spin_unlock_irq(q->queue_lock);
+
+	blk_sw_stage_sync(q);
+}
+EXPORT_SYMBOL(blk_queue_disable_sw_stage);
+
+void blk_sw_stage_free(struct request_queue *q)
+{
+	if (!q->sw_stage)
+		return;
+
+	blk_sw_stage_sync(q);
+	free_percpu(q->sw_stage);
+	q->sw_stage = NULL;
+}
+
 void init_request_from_bio(struct request *req, struct bio *bio)
 {
 	req->cmd_type = REQ_TYPE_FS;
@@ -1003,6 +1249,13 @@ void blk_queue_bio(struct request_queue *q, struct bio *bio)
 		goto get_rq;
 	}
 
+	if (blk_queue_staged(q)) {
+		if (attempt_sw_stage_merge(q, bio))
+			return;
+		spin_lock_irq(q->queue_lock);
+		goto get_rq;
+	}
+
 	if (attempt_plug_merge(q, bio, &request_count))
 		return;
 
@@ -1041,6 +1294,11 @@ get_rq:
 	if (test_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags))
 		req->cpu = raw_smp_processor_id();
 
+	if (where == ELEVATOR_INSERT_SORT && blk_queue_staged(q)) {
+		blk_sw_stage_add(q, req, blk_sw_stage_hold(bio));
+		return;
+	}
+
 	plug = current->plug;
 	if (plug) {
 		if (list_empty(&plug->list))
@@ -1946,6 +2204,7 @@ void blk_start_plug(struct blk_plug *plug)
 	INIT_LIST_HEAD(&plug->list);
 	INIT_LIST_HEAD(&plug->cb_list);
 	plug->should_sort = 0;
+	plug->sw_stage = NULL;
 
 	if (!tsk->plug) {
 		tsk->plug = plug;
@@ -2011,6 +2270,12 @@ void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 	BUG_ON(plug->magic != PLUG_MAGIC);
 
 	flush_plug_callbacks(plug);
+
+	if (plug->sw_stage) {
+		blk_sw_stage_flush(plug->sw_stage, from_schedule);
+		plug->sw_stage = NULL;
+	}
+
 	if (list_empty(&plug->list))
 		return;
 
@@ -270,6 +270,30 @@ queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
 	return ret;
 }
 
+static ssize_t queue_sw_stage_show(struct request_queue *q, char *page)
+{
+	return queue_var_show(blk_queue_staged(q) ? q->sw_stage_batch : 0, page);
+}
+
+static ssize_t
+queue_sw_stage_store(struct request_queue *q, const char *page, size_t count)
+{
+	unsigned long batch;
+	ssize_t ret = queue_var_store(&batch, page, count);
+	int err;
+
+	if (!q->request_fn)
+		return -EINVAL;
+
+	if (!batch) {
+		blk_queue_disable_sw_stage(q);
+		return ret;
+	}
+
+	err = blk_queue_enable_sw_stage(q, batch);
+	return err ? err : ret;
+}
+
 static struct queue_sysfs_entry queue_requests_entry = {
 	.attr = {.name = "nr_requests", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_requests_show,
@@ -372,6 +396,12 @@ static struct queue_sysfs_entry queue_rq_affinity_entry = {
 	.store = queue_rq_affinity_store,
 };
 
+static struct queue_sysfs_entry queue_sw_stage_entry = {
+	.attr = {.name = "sw_stage", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_sw_stage_show,
+	.store = queue_sw_stage_store,
+};
+
 static struct queue_sysfs_entry queue_iostats_entry = {
 	.attr = {.name = "iostats", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_show_iostats,
@@ -404,6 +434,7 @@ static struct attribute *default_attrs[] = {
 	&queue_nonrot_entry.attr,
 	&queue_nomerges_entry.attr,
 	&queue_rq_affinity_entry.attr,
+	&queue_sw_stage_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
 	NULL,
@@ -470,6 +501,8 @@ static void blk_release_queue(struct kobject *kobj)
 
 	blk_throtl_exit(q);
 
+	blk_sw_stage_free(q);
+
 	if (rl->rq_pool)
 		mempool_destroy(rl->rq_pool);
 
@@ -22,6 +22,7 @@ void blk_rq_bio_prep(struct request_queue *q, struct request *rq,
 int blk_rq_append_bio(struct request_queue *q, struct request *rq,
 		      struct bio *bio);
 void blk_drain_queue(struct request_queue *q, bool drain_all);
+void blk_sw_stage_free(struct request_queue *q);
 void blk_dequeue_request(struct request *rq);
 void __blk_queue_free_tags(struct request_queue *q);
 bool __blk_end_bidi_request(struct request *rq, int error,
@@ -45,18 +45,27 @@ struct row_queue_params {
 	bool idling_enabled;
 	int quantum;
 	bool is_urgent;
+	int target_ms;
 };
 
 static const struct row_queue_params row_queues_def[] = {
-	{true, 10, true},	
-	{false, 1, false},	
-	{true, 100, true},	
-	{false, 1, false},	
-	{false, 1, false},	
-	{false, 1, false},	
-	{false, 1, false}	
+	{true, 10, true, 10},	
+	{false, 1, false, 20},	
+	{true, 100, true, 50},	
+	{false, 1, false, 100},	
+	{false, 1, false, 500},	
+	{false, 1, false, 1000},	
+	{false, 1, false, 2000}	
 };
 
+static const char * const row_queue_names[] = {
+	"hp_read", "hp_swrite", "rp_read", "rp_swrite", "rp_write",
+	"lp_read", "lp_swrite",
+};
+
+/* completion latency buckets: <1ms, <2ms, <4ms ... <512ms, >=512ms */
+#define ROW_LAT_BUCKETS	11
+
 #define ROW_IDLE_TIME_MSEC 5
 #define ROW_READ_FREQ_MSEC 5
 
@@ -77,6 +86,10 @@ struct row_queue {
 
 	
 	struct rowq_idling_data	idle_data;
+
+	int			target_latency_ms;
+	unsigned int		nr_expired;
+	unsigned int		lat_hist[ROW_LAT_BUCKETS];
 };
 
 struct idling_data {
@@ -110,9 +123,18 @@ struct row_data {
 	struct starvation_data		low_prio_starvation;
 
 	unsigned int			cycle_flags;
+
+	int				latency_mode;
 };
 
 #define RQ_ROWQ(rq) ((struct row_queue *) ((rq)->elv.priv[0]))
+/* insertion time in usecs, kept in the request for latency accounting */
+#define RQ_INSERT_US(rq) ((u32)(unsigned long)((rq)->elv.priv[1]))
+
+static inline u32 row_now_us(void)
+{
+	return (u32)ktime_to_us(ktime_get());
+}
 
 #define row_log(q, fmt, args...)   \
 	blk_add_trace_msg(q, "%s():" fmt , __func__, ##args)
@@ -220,6 +242,7 @@ static void row_add_request(struct request_queue *q,
 	rd->nr_reqs[rq_data_dir(rq)]++;
 	rqueue->nr_req++;
 	rq_set_fifo_time(rq, jiffies); 
+	rq->elv.priv[1] = (void *)(unsigned long)row_now_us();
 
 	if (rq->cmd_flags & REQ_URGENT) {
 		WARN_ON(1);
@@ -320,10 +343,20 @@ static int row_reinsert_req(struct request_queue *q,
 	return 0;
 }
 
+static void row_update_lat_hist(struct row_queue *rqueue, struct request *rq)
+{
+	u32 lat_ms = (row_now_us() - RQ_INSERT_US(rq)) / USEC_PER_MSEC;
+
+	rqueue->lat_hist[min_t(int, fls(lat_ms), ROW_LAT_BUCKETS - 1)]++;
+}
+
 static void row_completed_req(struct request_queue *q, struct request *rq)
 {
 	struct row_data *rd = q->elevator->elevator_data;
 
+	if (RQ_ROWQ(rq))
+		row_update_lat_hist(RQ_ROWQ(rq), rq);
+
 	 if (rq->cmd_flags & REQ_URGENT) {
 		if (!rd->urgent_in_flight) {
 			WARN_ON(1);
@@ -531,6 +564,40 @@ static int row_get_next_queue(struct request_queue *q, struct row_data *rd,
 	return ret;
 }
 
+/*
+ * Latency mode: serve the queue whose oldest request has the least time
+ * left before its target latency expires.  Ties go to the higher
+ * priority queue.
+ */
+static int row_get_next_queue_by_slack(struct row_data *rd)
+{
+	struct row_queue *rqueue;
+	struct request *rq;
+	u32 now = row_now_us();
+	s64 slack, min_slack = LLONG_MAX;
+	int i, ret = -EIO;
+
+	for (i = 0; i < ROWQ_MAX_PRIO; i++) {
+		rqueue = &rd->row_queues[i];
+		if (list_empty(&rqueue->fifo))
+			continue;
+		rq = rq_entry_fifo(rqueue->fifo.next);
+		slack = (s64)rqueue->target_latency_ms * USEC_PER_MSEC -
+			(u32)(now - RQ_INSERT_US(rq));
+		if (slack < min_slack) {
+			min_slack = slack;
+			ret = i;
+		}
+	}
+
+	if (ret >= 0 && min_slack < 0) {
+		rd->row_queues[ret].nr_expired++;
+		row_log_rowq(rd, ret, "expired by %lldus", -min_slack);
+	}
+
+	return ret;
+}
+
 static int row_dispatch_requests(struct request_queue *q, int force)
 {
 	struct row_data *rd = (struct row_data *)q->elevator->elevator_data;
@@ -552,6 +619,11 @@ static int row_dispatch_requests(struct request_queue *q, int force)
 		goto done;
 	}
 
+	if (rd->latency_mode) {
+		currq = row_get_next_queue_by_slack(rd);
+		goto dispatch;
+	}
+
 	ioprio_class_to_serve = row_get_ioprio_class_to_serve(rd, force);
 	row_log(rd->dispatch_queue, "Dispatching from %d priority class",
 		ioprio_class_to_serve);
@@ -579,7 +651,7 @@ static int row_dispatch_requests(struct request_queue *q, int force)
 
 	currq = row_get_next_queue(q, rd, start_idx, end_idx);
 
-	
+dispatch:
 	if (currq >= 0) {
 		row_dispatch_insert(rd,
 			rq_entry_fifo(rd->row_queues[currq].fifo.next));
@@ -604,6 +676,8 @@ static void *row_init_queue(struct request_queue *q)
 	for (i = 0; i < ROWQ_MAX_PRIO; i++) {
 		INIT_LIST_HEAD(&rdata->row_queues[i].fifo);
 		rdata->row_queues[i].disp_quantum = row_queues_def[i].quantum;
+		rdata->row_queues[i].target_latency_ms =
+			row_queues_def[i].target_ms;
 		rdata->row_queues[i].rdata = rdata;
 		rdata->row_queues[i].prio = i;
 		rdata->row_queues[i].idle_data.begin_idling = false;
@@ -759,6 +833,21 @@ SHOW_FUNCTION(row_reg_starv_limit_show,
 	rowd->reg_prio_starvation.starvation_limit);
 SHOW_FUNCTION(row_low_starv_limit_show,
 	rowd->low_prio_starvation.starvation_limit);
+SHOW_FUNCTION(row_latency_mode_show, rowd->latency_mode);
+SHOW_FUNCTION(row_hp_read_target_show,
+	rowd->row_queues[ROWQ_PRIO_HIGH_READ].target_latency_ms);
+SHOW_FUNCTION(row_hp_swrite_target_show,
+	rowd->row_queues[ROWQ_PRIO_HIGH_SWRITE].target_latency_ms);
+SHOW_FUNCTION(row_rp_read_target_show,
+	rowd->row_queues[ROWQ_PRIO_REG_READ].target_latency_ms);
+SHOW_FUNCTION(row_rp_swrite_target_show,
+	rowd->row_queues[ROWQ_PRIO_REG_SWRITE].target_latency_ms);
+SHOW_FUNCTION(row_rp_write_target_show,
+	rowd->row_queues[ROWQ_PRIO_REG_WRITE].target_latency_ms);
+SHOW_FUNCTION(row_lp_read_target_show,
+	rowd->row_queues[ROWQ_PRIO_LOW_READ].target_latency_ms);
+SHOW_FUNCTION(row_lp_swrite_target_show,
+	rowd->row_queues[ROWQ_PRIO_LOW_SWRITE].target_latency_ms);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX)			\
@@ -805,9 +894,80 @@ STORE_FUNCTION(row_reg_starv_limit_store,
 STORE_FUNCTION(row_low_starv_limit_store,
 			&rowd->low_prio_starvation.starvation_limit,
 			1, INT_MAX);
+STORE_FUNCTION(row_latency_mode_store, &rowd->latency_mode, 0, 1);
+STORE_FUNCTION(row_hp_read_target_store,
+			&rowd->row_queues[ROWQ_PRIO_HIGH_READ].target_latency_ms,
+			1, INT_MAX);
+STORE_FUNCTION(row_hp_swrite_target_store,
+		&rowd->row_queues[ROWQ_PRIO_HIGH_SWRITE].target_latency_ms,
+			1, INT_MAX);
+STORE_FUNCTION(row_rp_read_target_store,
+			&rowd->row_queues[ROWQ_PRIO_REG_READ].target_latency_ms,
+			1, INT_MAX);
+STORE_FUNCTION(row_rp_swrite_target_store,
+		&rowd->row_queues[ROWQ_PRIO_REG_SWRITE].target_latency_ms,
+			1, INT_MAX);
+STORE_FUNCTION(row_rp_write_target_store,
+			&rowd->row_queues[ROWQ_PRIO_REG_WRITE].target_latency_ms,
+			1, INT_MAX);
+STORE_FUNCTION(row_lp_read_target_store,
+			&rowd->row_queues[ROWQ_PRIO_LOW_READ].target_latency_ms,
+			1, INT_MAX);
+STORE_FUNCTION(row_lp_swrite_target_store,
+		&rowd->row_queues[ROWQ_PRIO_LOW_SWRITE].target_latency_ms,
+			1, INT_MAX);
 
 #undef STORE_FUNCTION
 
+static ssize_t row_latency_hist_show(struct elevator_queue *e, char *page)
+{
+	struct row_data *rowd = e->elevator_data;
+	struct row_queue *rqueue;
+	char label[12];
+	ssize_t len;
+	int i, j;
+
+	len = scnprintf(page, PAGE_SIZE, "%-10s", "queue(ms)");
+	for (j = 0; j < ROW_LAT_BUCKETS; j++) {
+		snprintf(label, sizeof(label), "%s%u",
+			 j < ROW_LAT_BUCKETS - 1 ? "<" : ">=",
+			 1 << min(j, ROW_LAT_BUCKETS - 2));
+		len += scnprintf(page + len, PAGE_SIZE - len, " %8s", label);
+	}
+	len += scnprintf(page + len, PAGE_SIZE - len, " %8s\n", "expired");
+
+	for (i = 0; i < ROWQ_MAX_PRIO; i++) {
+		rqueue = &rowd->row_queues[i];
+		len += scnprintf(page + len, PAGE_SIZE - len, "%-10s",
+				 row_queue_names[i]);
+		for (j = 0; j < ROW_LAT_BUCKETS; j++)
+			len += scnprintf(page + len, PAGE_SIZE - len, " %8u",
+					 rqueue->lat_hist[j]);
+		len += scnprintf(page + len, PAGE_SIZE - len, " %8u\n",
+				 rqueue->nr_expired);
+	}
+
+	return len;
+}
+
+static ssize_t row_latency_hist_store(struct elevator_queue *e,
+		const char *page, size_t count)
+{
+	struct row_data *rowd = e->elevator_data;
+	struct request_queue *q = rowd->dispatch_queue;
+	int i;
+
+	spin_lock_irq(q->queue_lock);
+	for (i = 0; i < ROWQ_MAX_PRIO; i++) {
+		memset(rowd->row_queues[i].lat_hist, 0,
+		       sizeof(rowd->row_queues[i].lat_hist));
+		rowd->row_queues[i].nr_expired = 0;
+	}
+	spin_unlock_irq(q->queue_lock);
+
+	return count;
+}
+
 #define ROW_ATTR(name) \
 	__ATTR(name, S_IRUGO|S_IWUSR, row_##name##_show, \
 				      row_##name##_store)
@@ -824,6 +984,15 @@ static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(rd_idle_data_freq),
 	ROW_ATTR(reg_starv_limit),
 	ROW_ATTR(low_starv_limit),
+	ROW_ATTR(latency_mode),
+	ROW_ATTR(hp_read_target),
+	ROW_ATTR(hp_swrite_target),
+	ROW_ATTR(rp_read_target),
+	ROW_ATTR(rp_swrite_target),
+	ROW_ATTR(rp_write_target),
+	ROW_ATTR(lp_read_target),
+	ROW_ATTR(lp_swrite_target),
+	ROW_ATTR(latency_hist),
 	__ATTR_NULL
 };
 
@@ -33,6 +33,9 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/fs.h>
+#include <linux/vmalloc.h>
+#include <linux/ktime.h>
 #include "tcrypt.h"
 #include "internal.h"
 
@@ -48,6 +51,8 @@ static u32 type;
 static u32 mask;
 static int mode;
 static char *tvmem[TVMEMSIZE];
+static char *comp_input;
+static unsigned int comp_pages = 1024;
 
 static char *check[] = {
 	"des", "md5", "des3_ede", "rot13", "sha1", "sha224", "sha256",
@@ -55,7 +60,7 @@ static char *check[] = {
 	"cast6", "arc4", "michael_mic", "deflate", "crc32c", "tea", "xtea",
 	"khazad", "wp512", "wp384", "wp256", "tnepres", "xeta",  "fcrypt",
 	"camellia", "seed", "salsa20", "rmd128", "rmd160", "rmd256", "rmd320",
-	"lzo", "cts", "zlib", NULL
+	"lzo", "cts", "zlib", "lz4", NULL
 };
 
 static int test_cipher_jiffies(struct blkcipher_desc *desc, int enc,
@@ -911,6 +916,131 @@ out:
 	crypto_free_ablkcipher(tfm);
 }
 
+static u8 *load_comp_input(unsigned int *npages)
+{
+	struct file *filp;
+	loff_t size;
+	u8 *buf;
+	int ret;
+
+	filp = filp_open(comp_input, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(filp)) {
+		printk(KERN_ERR "tcrypt: cannot open %s: %ld\n", comp_input,
+		       PTR_ERR(filp));
+		return NULL;
+	}
+
+	size = i_size_read(filp->f_mapping->host);
+	*npages = min_t(loff_t, size >> PAGE_SHIFT, comp_pages);
+	if (!*npages) {
+		printk(KERN_ERR "tcrypt: %s holds no full page\n", comp_input);
+		buf = NULL;
+		goto out;
+	}
+
+	buf = vmalloc(*npages << PAGE_SHIFT);
+	if (!buf)
+		goto out;
+
+	ret = kernel_read(filp, 0, buf, *npages << PAGE_SHIFT);
+	if (ret != *npages << PAGE_SHIFT) {
+		printk(KERN_ERR "tcrypt: short read from %s: %d\n",
+		       comp_input, ret);
+		vfree(buf);
+		buf = NULL;
+	}
+out:
+	filp_close(filp, NULL);
+	return buf;
+}
+
+static int test_comp_speed(const char *algo, const u8 *in,
+			   unsigned int npages)
+{
+	struct crypto_comp *tfm;
+	u8 *out, *dec;
+	unsigned int i, clen, dlen;
+	u64 orig, stored = 0, ctime = 0, dtime = 0;
+	ktime_t start;
+	int ret = -ENOMEM;
+
+	printk(KERN_INFO "\ntesting speed of %s on %u pages\n", algo, npages);
+
+	tfm = crypto_alloc_comp(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		printk(KERN_ERR "failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		return PTR_ERR(tfm);
+	}
+
+	out = kmalloc(2 * PAGE_SIZE, GFP_KERNEL);
+	dec = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!out || !dec)
+		goto out;
+
+	for (i = 0; i < npages; i++) {
+		const u8 *src = in + i * PAGE_SIZE;
+
+		clen = 2 * PAGE_SIZE;
+		start = ktime_get();
+		ret = crypto_comp_compress(tfm, src, PAGE_SIZE, out, &clen);
+		ctime += ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (ret) {
+			printk(KERN_ERR "%s: compression of page %u failed\n",
+			       algo, i);
+			goto out;
+		}
+
+		dlen = PAGE_SIZE;
+		start = ktime_get();
+		ret = crypto_comp_decompress(tfm, out, clen, dec, &dlen);
+		dtime += ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (ret || dlen != PAGE_SIZE || memcmp(dec, src, PAGE_SIZE)) {
+			printk(KERN_ERR "%s: page %u does not round-trip\n",
+			       algo, i);
+			ret = -EINVAL;
+			goto out;
+		}
+
+		stored += min_t(unsigned int, clen, PAGE_SIZE);
+	}
+
+	orig = (u64)npages << PAGE_SHIFT;
+	printk(KERN_INFO "%s: ratio %llu.%02llu, compress %llu MB/s, "
+	       "decompress %llu MB/s\n", algo,
+	       div64_u64(orig, stored), div64_u64(orig * 100, stored) % 100,
+	       div64_u64(orig * 1000, ctime ?: 1),
+	       div64_u64(orig * 1000, dtime ?: 1));
+
+out:
+	kfree(dec);
+	kfree(out);
+	crypto_free_comp(tfm);
+	return ret;
+}
+
+static int test_comp_speed_all(void)
+{
+	unsigned int npages;
+	u8 *in;
+	int ret = 0;
+
+	if (!comp_input) {
+		printk(KERN_ERR "tcrypt: comp_input= page dump required\n");
+		return -EINVAL;
+	}
+
+	in = load_comp_input(&npages);
+	if (!in)
+		return -EINVAL;
+
+	ret += test_comp_speed("lzo", in, npages);
+	ret += test_comp_speed("lz4", in, npages);
+
+	vfree(in);
+	return ret;
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -1144,6 +1274,10 @@ static int do_test(int m)
 		ret += tcrypt_test("rfc4309(ccm(aes))");
 		break;
 
+	case 46:
+		ret += tcrypt_test("lz4");
+		break;
+
 	case 100:
 		ret += tcrypt_test("hmac(md5)");
 		break;
@@ -1554,6 +1688,10 @@ static int do_test(int m)
 				   speed_template_32_64);
 		break;
 
+	case 600:
+		ret += test_comp_speed_all();
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -1611,6 +1749,10 @@ module_param(mode, int, 0);
 module_param(sec, uint, 0);
 MODULE_PARM_DESC(sec, "Length in seconds of speed tests "
 		      "(defaults to zero which uses CPU cycles instead)");
+module_param(comp_input, charp, 0);
+MODULE_PARM_DESC(comp_input, "Page dump used by the compression speed test");
+module_param(comp_pages, uint, 0);
+MODULE_PARM_DESC(comp_pages, "Maximum number of pages read from comp_input");
 
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Quick & dirty crypto testing module");
@@ -0,0 +1,495 @@
+/*
+ * Null block device driver.
+ *
+ * Completes every request without touching any data, so that the cost of
+ * the block layer and IO scheduler can be measured in isolation.
+ *
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/bio.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/llist.h>
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+
+struct nullb_cmd {
+	struct llist_node ll_list;
+	struct request *rq;
+	struct bio *bio;
+	unsigned int tag;
+	struct nullb_queue *nq;
+};
+
+struct nullb_queue {
+	unsigned long *tag_map;
+	wait_queue_head_t wait;
+	unsigned int queue_depth;
+	struct nullb_cmd *cmds;
+};
+
+struct nullb {
+	struct list_head list;
+	unsigned int index;
+	struct request_queue *q;
+	struct gendisk *disk;
+	struct nullb_queue nq;
+	spinlock_t lock;
+};
+
+struct completion_queue {
+	struct llist_head list;
+	struct hrtimer timer;
+};
+
+static LIST_HEAD(nullb_list);
+static DEFINE_MUTEX(nullb_lock);
+static int null_major;
+static unsigned int nullb_indexes;
+static struct completion_queue __percpu *cqs;
+
+enum {
+	NULL_IRQ_NONE		= 0,
+	NULL_IRQ_SOFTIRQ	= 1,
+	NULL_IRQ_TIMER		= 2,
+};
+
+enum {
+	NULL_Q_BIO		= 0,
+	NULL_Q_RQ		= 1,
+};
+
+static int queue_mode = NULL_Q_RQ;
+module_param(queue_mode, int, S_IRUGO);
+MODULE_PARM_DESC(queue_mode, "Block interface to use (0=bio,1=rq)");
+
+static int irqmode = NULL_IRQ_SOFTIRQ;
+module_param(irqmode, int, S_IRUGO);
+MODULE_PARM_DESC(irqmode, "IRQ completion handler. 0-none, 1-softirq, 2-timer");
+
+static int completion_nsec = 10000;
+module_param(completion_nsec, int, S_IRUGO);
+MODULE_PARM_DESC(completion_nsec, "Time in ns to complete a request in hardware. Default: 10,000ns");
+
+static int hw_queue_depth = 64;
+module_param(hw_queue_depth, int, S_IRUGO);
+MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each device. Default: 64");
+
+static int bs = 512;
+module_param(bs, int, S_IRUGO);
+MODULE_PARM_DESC(bs, "Block size (in bytes)");
+
+static int gb = 250;
+module_param(gb, int, S_IRUGO);
+MODULE_PARM_DESC(gb, "Size in GB");
+
+static int nr_devices = 2;
+module_param(nr_devices, int, S_IRUGO);
+MODULE_PARM_DESC(nr_devices, "Number of devices to register");
+
+static int sw_stage;
+module_param(sw_stage, int, S_IRUGO);
+MODULE_PARM_DESC(sw_stage, "Per-CPU submission stage batch size for queue_mode=1, 0 to disable");
+
+static unsigned int get_tag(struct nullb_queue *nq)
+{
+	unsigned int tag;
+
+	do {
+		tag = find_first_zero_bit(nq->tag_map, nq->queue_depth);
+		if (tag >= nq->queue_depth)
+			return -1U;
+	} while (test_and_set_bit_lock(tag, nq->tag_map));
+
+	return tag;
+}
+
+static void put_tag(struct nullb_queue *nq, unsigned int tag)
+{
+	clear_bit_unlock(tag, nq->tag_map);
+
+	if (waitqueue_active(&nq->wait))
+		wake_up(&nq->wait);
+}
+
+static struct nullb_cmd *__alloc_cmd(struct nullb_queue *nq)
+{
+	struct nullb_cmd *cmd;
+	unsigned int tag;
+
+	tag = get_tag(nq);
+	if (tag == -1U)
+		return NULL;
+
+	cmd = &nq->cmds[tag];
+	cmd->tag = tag;
+	cmd->nq = nq;
+	return cmd;
+}
+
+static struct nullb_cmd *alloc_cmd(struct nullb_queue *nq, int can_wait)
+{
+	struct nullb_cmd *cmd;
+	DEFINE_WAIT(wait);
+
+	cmd = __alloc_cmd(nq);
+	if (cmd || !can_wait)
+		return cmd;
+
+	do {
+		prepare_to_wait(&nq->wait, &wait, TASK_UNINTERRUPTIBLE);
+		cmd = __alloc_cmd(nq);
+		if (cmd)
+			break;
+
+		io_schedule();
+	} while (1);
+
+	finish_wait(&nq->wait, &wait);
+	return cmd;
+}
+
+static void end_cmd(struct nullb_cmd *cmd)
+{
+	struct nullb *nullb = container_of(cmd->nq, struct nullb, nq);
+	struct request_queue *q = nullb->q;
+	unsigned long flags;
+
+	if (queue_mode == NULL_Q_BIO) {
+		bio_endio(cmd->bio, 0);
+		put_tag(cmd->nq, cmd->tag);
+		return;
+	}
+
+	blk_end_request_all(cmd->rq, 0);
+	put_tag(cmd->nq, cmd->tag);
+
+	/* a tag is free again, restart the queue if prep ran out */
+	smp_mb__after_clear_bit();
+	if (unlikely(blk_queue_stopped(q))) {
+		spin_lock_irqsave(q->queue_lock, flags);
+		if (blk_queue_stopped(q)) {
+			queue_flag_clear(QUEUE_FLAG_STOPPED, q);
+			blk_run_queue_async(q);
+		}
+		spin_unlock_irqrestore(q->queue_lock, flags);
+	}
+}
+
+static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
+{
+	struct completion_queue *cq;
+	struct llist_node *entry;
+	struct nullb_cmd *cmd;
+
+	cq = container_of(timer, struct completion_queue, timer);
+
+	entry = llist_del_all(&cq->list);
+	while (entry) {
+		cmd = llist_entry(entry, struct nullb_cmd, ll_list);
+		entry = entry->next;
+		end_cmd(cmd);
+	}
+
+	return HRTIMER_NORESTART;
+}
+
+static void null_cmd_end_timer(struct nullb_cmd *cmd)
+{
+	struct completion_queue *cq;
+
+	cq = get_cpu_ptr(cqs);
+	cmd->ll_list.next = NULL;
+	if (llist_add(&cmd->ll_list, &cq->list))
+		hrtimer_start(&cq->timer, ktime_set(0, completion_nsec),
+			      HRTIMER_MODE_REL_PINNED);
+	put_cpu_ptr(cqs);
+}
+
+static void null_softirq_done_fn(struct request *rq)
+{
+	end_cmd(rq->special);
+}
+
+static void null_handle_cmd(struct nullb_cmd *cmd)
+{
+	switch (irqmode) {
+	case NULL_IRQ_SOFTIRQ:
+		/* bios carry no submitting cpu to complete on */
+		if (queue_mode == NULL_Q_RQ) {
+			blk_complete_request(cmd->rq);
+			break;
+		}
+		/* fall through */
+	case NULL_IRQ_NONE:
+		end_cmd(cmd);
+		break;
+	case NULL_IRQ_TIMER:
+		null_cmd_end_timer(cmd);
+		break;
+	}
+}
+
+static void null_queue_bio(struct request_queue *q, struct bio *bio)
+{
+	struct nullb *nullb = q->queuedata;
+	struct nullb_cmd *cmd;
+
+	cmd = alloc_cmd(&nullb->nq, 1);
+	cmd->bio = bio;
+
+	null_handle_cmd(cmd);
+}
+
+static int null_rq_prep_fn(struct request_queue *q, struct request *rq)
+{
+	struct nullb *nullb = q->queuedata;
+	struct nullb_cmd *cmd;
+
+	cmd = alloc_cmd(&nullb->nq, 0);
+	if (!cmd) {
+		blk_stop_queue(q);
+
+		/* pairs with the barrier in end_cmd() */
+		smp_mb();
+		cmd = alloc_cmd(&nullb->nq, 0);
+		if (!cmd)
+			return BLKPREP_DEFER;
+		queue_flag_clear(QUEUE_FLAG_STOPPED, q);
+	}
+
+	cmd->rq = rq;
+	rq->special = cmd;
+	rq->cmd_flags |= REQ_DONTPREP;
+	return BLKPREP_OK;
+}
+
+static void null_request_fn(struct request_queue *q)
+{
+	struct request *rq;
+
+	while ((rq = blk_fetch_request(q)) != NULL) {
+		struct nullb_cmd *cmd = rq->special;
+
+		spin_unlock_irq(q->queue_lock);
+		null_handle_cmd(cmd);
+		spin_lock_irq(q->queue_lock);
+	}
+}
+
+static const struct block_device_operations null_fops = {
+	.owner		= THIS_MODULE,
+};
+
+static int setup_queue(struct nullb_queue *nq)
+{
+	nq->cmds = kcalloc(hw_queue_depth, sizeof(*nq->cmds), GFP_KERNEL);
+	if (!nq->cmds)
+		return -ENOMEM;
+
+	nq->tag_map = kcalloc(BITS_TO_LONGS(hw_queue_depth),
+			      sizeof(unsigned long), GFP_KERNEL);
+	if (!nq->tag_map) {
+		kfree(nq->cmds);
+		return -ENOMEM;
+	}
+
+	init_waitqueue_head(&nq->wait);
+	nq->queue_depth = hw_queue_depth;
+	return 0;
+}
+
+static void cleanup_queue(struct nullb_queue *nq)
+{
+	kfree(nq->tag_map);
+	kfree(nq->cmds);
+}
+
+static void null_del_dev(struct nullb *nullb)
+{
+	list_del_init(&nullb->list);
+
+	del_gendisk(nullb->disk);
+	blk_cleanup_queue(nullb->q);
+	put_disk(nullb->disk);
+	cleanup_queue(&nullb->nq);
+	kfree(nullb);
+}
+
+static int null_add_dev(void)
+{
+	struct gendisk *disk;
+	struct nullb *nullb;
+	sector_t size;
+
+	nullb = kzalloc(sizeof(*nullb), GFP_KERNEL);
+	if (!nullb)
+		return -ENOMEM;
+
+	spin_lock_init(&nullb->lock);
+
+	if (setup_queue(&nullb->nq))
+		goto out_free_nullb;
+
+	if (queue_mode == NULL_Q_BIO) {
+		nullb->q = blk_alloc_queue(GFP_KERNEL);
+		if (!nullb->q)
+			goto out_cleanup_queue;
+		blk_queue_make_request(nullb->q, null_queue_bio);
+	} else {
+		nullb->q = blk_init_queue(null_request_fn, &nullb->lock);
+		if (!nullb->q)
+			goto out_cleanup_queue;
+		blk_queue_prep_rq(nullb->q, null_rq_prep_fn);
+		blk_queue_softirq_done(nullb->q, null_softirq_done_fn);
+		if (sw_stage)
+			blk_queue_enable_sw_stage(nullb->q, sw_stage);
+	}
+
+	nullb->q->queuedata = nullb;
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, nullb->q);
+	blk_queue_logical_block_size(nullb->q, bs);
+	blk_queue_physical_block_size(nullb->q, bs);
+
+	disk = nullb->disk = alloc_disk(1);
+	if (!disk)
+		goto out_cleanup_blk_queue;
+
+	mutex_lock(&nullb_lock);
+	list_add_tail(&nullb->list, &nullb_list);
+	nullb->index = nullb_indexes++;
+	mutex_unlock(&nullb_lock);
+
+	size = (sector_t)gb * 1024 * 1024 * 1024;
+	sector_div(size, bs);
+	set_capacity(disk, size * (bs >> 9));
+
+	disk->flags |= GENHD_FL_EXT_DEVT | GENHD_FL_SUPPRESS_PARTITION_INFO;
+	disk->major		= null_major;
+	disk->first_minor	= nullb->index;
+	disk->fops		= &null_fops;
+	disk->private_data	= nullb;
+	disk->queue		= nullb->q;
+	sprintf(disk->disk_name, "nullb%d", nullb->index);
+	add_disk(disk);
+	return 0;
+
+out_cleanup_blk_queue:
+	blk_cleanup_queue(nullb->q);
+out_cleanup_queue:
+	cleanup_queue(&nullb->nq);
+out_free_nullb:
+	kfree(nullb);
+	return -ENOMEM;
+}
+
+static int __init null_init(void)
+{
+	unsigned int i;
+
+	if (queue_mode != NULL_Q_BIO && queue_mode != NULL_Q_RQ) {
+		pr_warn("null_blk: invalid queue_mode %d, using rq\n",
+			queue_mode);
+		queue_mode = NULL_Q_RQ;
+	}
+
+	if (irqmode < NULL_IRQ_NONE || irqmode > NULL_IRQ_TIMER) {
+		pr_warn("null_blk: invalid irqmode %d, using softirq\n",
+			irqmode);
+		irqmode = NULL_IRQ_SOFTIRQ;
+	}
+
+	if (bs > PAGE_SIZE) {
+		pr_warn("null_blk: invalid block size\n");
+		pr_warn("null_blk: defaults block size to %lu\n", PAGE_SIZE);
+		bs = PAGE_SIZE;
+	}
+	if (bs < 512 || !is_power_of_2(bs))
+		bs = 512;
+
+	if (hw_queue_depth < 1)
+		hw_queue_depth = 1;
+	if (nr_devices < 1 || gb < 1)
+		return -EINVAL;
+
+	if (irqmode == NULL_IRQ_TIMER) {
+		cqs = alloc_percpu(struct completion_queue);
+		if (!cqs)
+			return -ENOMEM;
+
+		for_each_possible_cpu(i) {
+			struct completion_queue *cq = per_cpu_ptr(cqs, i);
+
+			init_llist_head(&cq->list);
+			hrtimer_init(&cq->timer, CLOCK_MONOTONIC,
+				     HRTIMER_MODE_REL);
+			cq->timer.function = null_cmd_timer_expired;
+		}
+	}
+
+	null_major = register_blkdev(0, "nullb");
+	if (null_major < 0) {
+		free_percpu(cqs);
+		return null_major;
+	}
+
+	for (i = 0; i < nr_devices; i++) {
+		if (null_add_dev()) {
+			struct nullb *nullb, *next;
+
+			mutex_lock(&nullb_lock);
+			list_for_each_entry_safe(nullb, next, &nullb_list, list)
+				null_del_dev(nullb);
+			mutex_unlock(&nullb_lock);
+			unregister_blkdev(null_major, "nullb");
+			free_percpu(cqs);
+			return -EINVAL;
+		}
+	}
+
+	pr_info("null_blk: module loaded\n");
+	return 0;
+}
+
+static void __exit null_exit(void)
+{
+	struct nullb *nullb, *next;
+
+	mutex_lock(&nullb_lock);
+	list_for_each_entry_safe(nullb, next, &nullb_list, list)
+		null_del_dev(nullb);
+	mutex_unlock(&nullb_lock);
+
+	unregister_blkdev(null_major, "nullb");
+
+	if (cqs) {
+		unsigned int i;
+
+		for_each_possible_cpu(i)
+			hrtimer_cancel(&per_cpu_ptr(cqs, i)->timer);
+		free_percpu(cqs);
+	}
+}
+
+module_init(null_init);
+module_exit(null_exit);
+
+MODULE_DESCRIPTION("Null block device driver");
+MODULE_LICENSE("GPL v2");
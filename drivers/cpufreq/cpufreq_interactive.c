@@ -30,6 +30,7 @@
 #include <linux/kthread.h>
 #include <linux/slab.h>
 #include <linux/kernel_stat.h>
+#include <linux/irq_work.h>
 #include <asm/cputime.h>
 
 #define CREATE_TRACE_POINTS
@@ -54,6 +55,13 @@ struct cpufreq_interactive_cpuinfo {
 	struct rw_semaphore enable_sem;
 	int governor_enabled;
 	int prev_load;
+	int pred_load;
+	int cpu;
+	bool sched_util;
+	bool sched_idle;
+	u64 last_eval_time;
+	struct update_util_data update_util;
+	struct irq_work irq_work;
 };
 
 static DEFINE_PER_CPU(struct cpufreq_interactive_cpuinfo, cpuinfo);
@@ -104,6 +112,13 @@ static unsigned int up_threshold_any_cpu_load;
 static unsigned int sync_freq;
 static unsigned int up_threshold_any_cpu_freq;
 
+static bool predict_load;
+#define DEFAULT_HEAVY_TASK_US (4 * USEC_PER_MSEC)
+static unsigned int heavy_task_us = DEFAULT_HEAVY_TASK_US;
+#define MAX_PRED_LOAD 1000
+
+static bool use_sched_util;
+
 static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		unsigned int event);
 
@@ -176,11 +191,23 @@ static void cpufreq_interactive_timer_resched(
 	spin_unlock_irqrestore(&pcpu->load_lock, flags);
 }
 
+static void cpufreq_interactive_load_reset(int cpu)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+	unsigned long flags;
+
+	spin_lock_irqsave(&pcpu->load_lock, flags);
+	pcpu->time_in_idle =
+		get_cpu_idle_time(cpu, &pcpu->time_in_idle_timestamp);
+	pcpu->cputime_speedadj = 0;
+	pcpu->cputime_speedadj_timestamp = pcpu->time_in_idle_timestamp;
+	spin_unlock_irqrestore(&pcpu->load_lock, flags);
+}
+
 static void cpufreq_interactive_timer_start(int cpu)
 {
 	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
 	unsigned long expires = jiffies + usecs_to_jiffies(timer_rate);
-	unsigned long flags;
 
 	pcpu->cpu_timer.expires = expires;
 	add_timer_on(&pcpu->cpu_timer, cpu);
@@ -190,12 +217,7 @@ static void cpufreq_interactive_timer_start(int cpu)
 		add_timer_on(&pcpu->cpu_slack_timer, cpu);
 	}
 
-	spin_lock_irqsave(&pcpu->load_lock, flags);
-	pcpu->time_in_idle =
-		get_cpu_idle_time(cpu, &pcpu->time_in_idle_timestamp);
-	pcpu->cputime_speedadj = 0;
-	pcpu->cputime_speedadj_timestamp = pcpu->time_in_idle_timestamp;
-	spin_unlock_irqrestore(&pcpu->load_lock, flags);
+	cpufreq_interactive_load_reset(cpu);
 }
 
 static unsigned int freq_to_above_hispeed_delay(unsigned int freq)
@@ -356,6 +378,14 @@ static void cpufreq_interactive_timer(unsigned long data)
 	do_div(cputime_speedadj, delta_time);
 	loadadjfreq = (unsigned int)cputime_speedadj * 100;
 	cpu_load = loadadjfreq / pcpu->target_freq;
+	if (predict_load || pcpu->sched_util) {
+		int pred_load = xchg(&pcpu->pred_load, 0);
+
+		if (pred_load > cpu_load) {
+			cpu_load = pred_load;
+			loadadjfreq = pred_load * pcpu->target_freq;
+		}
+	}
 	pcpu->prev_load = cpu_load;
 	boosted = boost_val || now < boostpulse_endtime;
 
@@ -449,11 +479,13 @@ static void cpufreq_interactive_timer(unsigned long data)
 	wake_up_process(speedchange_task);
 
 rearm_if_notmax:
-	if (pcpu->target_freq == pcpu->policy->max)
+	if (pcpu->target_freq == pcpu->policy->max && !pcpu->sched_util)
 		goto exit;
 
 rearm:
-	if (!timer_pending(&pcpu->cpu_timer))
+	if (pcpu->sched_util)
+		cpufreq_interactive_load_reset(data);
+	else if (!timer_pending(&pcpu->cpu_timer))
 		cpufreq_interactive_timer_resched(pcpu);
 
 exit:
@@ -461,6 +493,78 @@ exit:
 	return;
 }
 
+static void cpufreq_interactive_irq_work(struct irq_work *work)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		container_of(work, struct cpufreq_interactive_cpuinfo,
+			     irq_work);
+
+	cpufreq_interactive_timer(pcpu->cpu);
+}
+
+/*
+ * Called by the scheduler with the run queue lock held.  Record the
+ * utilization as a load floor for the next evaluation, and evaluate
+ * right away if it calls for a higher speed, otherwise at most once per
+ * timer_rate.  Updates for a remote CPU's run queue are ignored: the
+ * irq_work would run the evaluation here, concurrently with that CPU's
+ * own.
+ */
+static void cpufreq_interactive_update_util(struct update_util_data *data,
+		u64 time, unsigned long util, unsigned long max)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu =
+		container_of(data, struct cpufreq_interactive_cpuinfo,
+			     update_util);
+	int load;
+
+	if (pcpu->cpu != smp_processor_id())
+		return;
+
+	load = util * 100 / max;
+	if (load > pcpu->pred_load)
+		pcpu->pred_load = load;
+
+	if (time - pcpu->last_eval_time < (u64)timer_rate * NSEC_PER_USEC &&
+	    (pcpu->target_freq == pcpu->policy->max ||
+	     load * pcpu->policy->cur <=
+	     freq_to_targetload(pcpu->target_freq) * pcpu->target_freq))
+		return;
+
+	pcpu->last_eval_time = time;
+	irq_work_queue(&pcpu->irq_work);
+}
+
+/* Called with enable_sem held for writing. */
+static void cpufreq_interactive_start_cpu(int cpu)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+
+	pcpu->sched_util = use_sched_util;
+	if (pcpu->sched_util) {
+		pcpu->sched_idle = false;
+		pcpu->last_eval_time = 0;
+		cpufreq_interactive_load_reset(cpu);
+		cpufreq_set_update_util_data(cpu, &pcpu->update_util);
+	} else {
+		cpufreq_interactive_timer_start(cpu);
+	}
+}
+
+static void cpufreq_interactive_stop_cpu(int cpu)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+
+	if (pcpu->sched_util) {
+		cpufreq_set_update_util_data(cpu, NULL);
+		synchronize_sched();
+		irq_work_sync(&pcpu->irq_work);
+	} else {
+		del_timer_sync(&pcpu->cpu_timer);
+		del_timer_sync(&pcpu->cpu_slack_timer);
+	}
+}
+
 static void cpufreq_interactive_idle_start(void)
 {
 	struct cpufreq_interactive_cpuinfo *pcpu =
@@ -475,6 +579,12 @@ static void cpufreq_interactive_idle_start(void)
 		return;
 	}
 
+	if (pcpu->sched_util) {
+		pcpu->sched_idle = true;
+		up_read(&pcpu->enable_sem);
+		return;
+	}
+
 	pending = timer_pending(&pcpu->cpu_timer);
 
 	if (pcpu->target_freq != pcpu->policy->min) {
@@ -506,6 +616,12 @@ static void cpufreq_interactive_idle_end(void)
 		return;
 	}
 
+	if (pcpu->sched_util) {
+		pcpu->sched_idle = false;
+		up_read(&pcpu->enable_sem);
+		return;
+	}
+
 	
 	if (!timer_pending(&pcpu->cpu_timer)) {
 		cpufreq_interactive_timer_resched(pcpu);
@@ -561,6 +677,9 @@ static int cpufreq_interactive_speedchange_task(void *data)
 				struct cpufreq_interactive_cpuinfo *pjcpu =
 					&per_cpu(cpuinfo, j);
 
+				if (j != cpu && pjcpu->sched_util &&
+				    pjcpu->sched_idle)
+					continue;
 				if (pjcpu->target_freq > max_freq)
 					max_freq = pjcpu->target_freq;
 			}
@@ -611,6 +730,64 @@ static void cpufreq_interactive_boost(void)
 		wake_up_process(speedchange_task);
 }
 
+static void cpufreq_interactive_update_heavy_task(void)
+{
+	sched_heavy_task_ns = (predict_load && active_count) ?
+		heavy_task_us * NSEC_PER_USEC : 0;
+}
+
+static int cpufreq_interactive_heavy_wakeup(
+	struct notifier_block *nb, unsigned long cpu, void *data)
+{
+	struct task_struct *p = data;
+	struct cpufreq_interactive_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+	unsigned int new_freq, old_freq;
+	unsigned long flags;
+	u64 load;
+	u64 now;
+
+	if (!predict_load || p == speedchange_task)
+		return NOTIFY_OK;
+	if (!down_read_trylock(&pcpu->enable_sem))
+		return NOTIFY_OK;
+	if (!pcpu->governor_enabled)
+		goto exit;
+
+	load = div64_u64((u64)p->burst_avg * 100, timer_rate * NSEC_PER_USEC);
+	load += pcpu->prev_load;
+	if (load > MAX_PRED_LOAD)
+		load = MAX_PRED_LOAD;
+	if ((int)load > pcpu->pred_load)
+		pcpu->pred_load = load;
+
+	new_freq = choose_freq(pcpu, (unsigned int)load * pcpu->policy->cur);
+	if (new_freq < hispeed_freq)
+		new_freq = hispeed_freq;
+	if (new_freq <= pcpu->target_freq)
+		goto exit;
+
+	now = ktime_to_us(ktime_get());
+	spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+	old_freq = pcpu->target_freq;
+	pcpu->target_freq = new_freq;
+	pcpu->floor_freq = new_freq;
+	pcpu->floor_validate_time = now;
+	pcpu->hispeed_validate_time = now;
+	cpumask_set_cpu(cpu, &speedchange_cpumask);
+	spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+	trace_cpufreq_interactive_target(cpu, (int)load, old_freq,
+					 pcpu->policy->cur, new_freq);
+	wake_up_process(speedchange_task);
+exit:
+	up_read(&pcpu->enable_sem);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_interactive_heavy_wakeup_nb = {
+	.notifier_call = cpufreq_interactive_heavy_wakeup,
+};
+
 static int cpufreq_interactive_notifier(
 	struct notifier_block *nb, unsigned long val, void *data)
 {
@@ -1087,6 +1264,89 @@ static struct global_attr up_threshold_any_cpu_freq_attr =
 		show_up_threshold_any_cpu_freq,
 				store_up_threshold_any_cpu_freq);
 
+static ssize_t show_predict_load(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", predict_load);
+}
+
+static ssize_t store_predict_load(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	predict_load = !!val;
+	cpufreq_interactive_update_heavy_task();
+	return count;
+}
+
+static struct global_attr predict_load_attr = __ATTR(predict_load, 0644,
+		show_predict_load, store_predict_load);
+
+static ssize_t show_heavy_task_us(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", heavy_task_us);
+}
+
+static ssize_t store_heavy_task_us(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (!val)
+		return -EINVAL;
+	/* sched_heavy_task_ns is an unsigned int */
+	heavy_task_us = min(val, (unsigned long)(UINT_MAX / NSEC_PER_USEC));
+	cpufreq_interactive_update_heavy_task();
+	return count;
+}
+
+static struct global_attr heavy_task_us_attr = __ATTR(heavy_task_us, 0644,
+		show_heavy_task_us, store_heavy_task_us);
+
+static ssize_t show_use_sched_util(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", use_sched_util);
+}
+
+static ssize_t store_use_sched_util(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	struct cpufreq_interactive_cpuinfo *pcpu;
+	unsigned long val;
+	int ret, cpu;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	use_sched_util = !!val;
+
+	for_each_possible_cpu(cpu) {
+		pcpu = &per_cpu(cpuinfo, cpu);
+		down_write(&pcpu->enable_sem);
+		if (pcpu->governor_enabled &&
+		    pcpu->sched_util != use_sched_util) {
+			cpufreq_interactive_stop_cpu(cpu);
+			cpufreq_interactive_start_cpu(cpu);
+		}
+		up_write(&pcpu->enable_sem);
+	}
+	return count;
+}
+
+static struct global_attr use_sched_util_attr = __ATTR(use_sched_util, 0644,
+		show_use_sched_util, store_use_sched_util);
+
 static struct attribute *interactive_attributes[] = {
 	&target_loads_attr.attr,
 	&above_hispeed_delay_attr.attr,
@@ -1103,6 +1363,9 @@ static struct attribute *interactive_attributes[] = {
 	&sync_freq_attr.attr,
 	&up_threshold_any_cpu_load_attr.attr,
 	&up_threshold_any_cpu_freq_attr.attr,
+	&predict_load_attr.attr,
+	&heavy_task_us_attr.attr,
+	&use_sched_util_attr.attr,
 	NULL,
 };
 
@@ -1162,7 +1425,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			pcpu->hispeed_validate_time =
 				pcpu->floor_validate_time;
 			down_write(&pcpu->enable_sem);
-			cpufreq_interactive_timer_start(j);
+			cpufreq_interactive_start_cpu(j);
 			pcpu->governor_enabled = 1;
 			up_write(&pcpu->enable_sem);
 		}
@@ -1182,6 +1445,9 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		idle_notifier_register(&cpufreq_interactive_idle_nb);
 		cpufreq_register_notifier(
 			&cpufreq_notifier_block, CPUFREQ_TRANSITION_NOTIFIER);
+		atomic_notifier_chain_register(&heavy_wakeup_notifier_head,
+			&cpufreq_interactive_heavy_wakeup_nb);
+		cpufreq_interactive_update_heavy_task();
 		mutex_unlock(&gov_lock);
 		break;
 
@@ -1191,8 +1457,7 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			pcpu = &per_cpu(cpuinfo, j);
 			down_write(&pcpu->enable_sem);
 			pcpu->governor_enabled = 0;
-			del_timer_sync(&pcpu->cpu_timer);
-			del_timer_sync(&pcpu->cpu_slack_timer);
+			cpufreq_interactive_stop_cpu(j);
 			up_write(&pcpu->enable_sem);
 		}
 
@@ -1201,6 +1466,9 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			return 0;
 		}
 
+		cpufreq_interactive_update_heavy_task();
+		atomic_notifier_chain_unregister(&heavy_wakeup_notifier_head,
+			&cpufreq_interactive_heavy_wakeup_nb);
 		cpufreq_unregister_notifier(
 			&cpufreq_notifier_block, CPUFREQ_TRANSITION_NOTIFIER);
 		idle_notifier_unregister(&cpufreq_interactive_idle_nb);
@@ -1233,9 +1501,11 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 			else if (policy->min > pcpu->target_freq)
 				pcpu->target_freq = policy->min;
 
-			del_timer_sync(&pcpu->cpu_timer);
-			del_timer_sync(&pcpu->cpu_slack_timer);
-			cpufreq_interactive_timer_start(j);
+			if (!pcpu->sched_util) {
+				del_timer_sync(&pcpu->cpu_timer);
+				del_timer_sync(&pcpu->cpu_slack_timer);
+				cpufreq_interactive_timer_start(j);
+			}
 			up_write(&pcpu->enable_sem);
 		}
 		break;
@@ -1263,6 +1533,9 @@ static int __init cpufreq_interactive_init(void)
 		pcpu->cpu_slack_timer.function = cpufreq_interactive_nop_timer;
 		spin_lock_init(&pcpu->load_lock);
 		init_rwsem(&pcpu->enable_sem);
+		pcpu->cpu = i;
+		pcpu->update_util.func = cpufreq_interactive_update_util;
+		init_irq_work(&pcpu->irq_work, cpufreq_interactive_irq_work);
 	}
 
 	spin_lock_init(&target_loads_lock);
@@ -1556,6 +1556,14 @@ static int ion_debug_heap_show(struct seq_file *s, void *unused)
 	seq_printf(s, "%16.s %16u\n", "total orphaned",
 		   total_orphaned_size);
 	seq_printf(s, "%16.s %16u\n", "total ", total_size);
+	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE) {
+		seq_printf(s, "%16.s %16u\n", "deferred free",
+			   ion_heap_freelist_size(heap));
+		seq_printf(s, "%16.s %16u\n", "deferred peak",
+			   heap->free_list_peak);
+		seq_printf(s, "%16.s %16lu\n", "throttled",
+			   heap->free_throttled);
+	}
 	seq_printf(s, "----------------------------------------------------\n");
 
 	if (heap->debug_show)
@@ -1732,6 +1740,8 @@ int ion_secure_heap(struct ion_device *dev, int heap_id, int version,
 			continue;
 		if (ION_HEAP(heap->id) != heap_id)
 			continue;
+		if (heap->flags & ION_HEAP_FLAG_DEFER_FREE)
+			ion_heap_freelist_drain(heap, 0);
 		if (heap->ops->secure_heap)
 			ret_val = heap->ops->secure_heap(heap, version, data);
 		else
@@ -1773,6 +1783,8 @@ int ion_unsecure_heap(struct ion_device *dev, int heap_id, int version,
 			continue;
 		if (ION_HEAP(heap->id) != heap_id)
 			continue;
+		if (heap->flags & ION_HEAP_FLAG_DEFER_FREE)
+			ion_heap_freelist_drain(heap, 0);
 		if (heap->ops->secure_heap)
 			ret_val = heap->ops->unsecure_heap(heap, version, data);
 		else
@@ -222,6 +222,7 @@ struct ion_heap *ion_cma_heap_create(struct ion_platform_heap *data)
 	heap->ops = &ion_cma_ops;
 	heap->priv = data->priv;
 	heap->type = ION_HEAP_TYPE_DMA;
+	heap->flags = ION_HEAP_FLAG_DEFER_FREE;
 	cma_heap_has_outer_cache = data->has_outer_cache;
 	return heap;
 }
@@ -587,6 +587,7 @@ struct ion_heap *ion_secure_cma_heap_create(struct ion_platform_heap *data)
 	mutex_init(&sheap->alloc_lock);
 	sheap->heap.ops = &ion_secure_cma_ops;
 	sheap->heap.type = ION_HEAP_TYPE_SECURE_DMA;
+	sheap->heap.flags = ION_HEAP_FLAG_DEFER_FREE;
 	sheap->npages = data->size >> PAGE_SHIFT;
 	sheap->base = data->base;
 	sheap->heap_size = data->size;
@@ -20,6 +20,7 @@
 #include <linux/ion.h>
 #include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/rtmutex.h>
 #include <linux/sched.h>
 #include <linux/scatterlist.h>
@@ -28,6 +29,9 @@
 #include <linux/highmem.h>
 #include "ion_priv.h"
 
+static unsigned int deferred_free_max_kb = 65536;
+module_param(deferred_free_max_kb, uint, S_IRUGO | S_IWUSR);
+
 void *ion_heap_map_kernel(struct ion_heap *heap,
 			  struct ion_buffer *buffer)
 {
@@ -102,10 +106,39 @@ int ion_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 
 #define MAX_VMAP_RETRIES 10
 
+void ion_heap_pages_inv(struct page **pages, int num_pages)
+{
+	int i, n;
+
+	for (i = 0; i < num_pages; i += n) {
+		struct page *page = pages[i];
+		phys_addr_t phys = page_to_phys(page);
+		void *p;
+
+		if (PageHighMem(page)) {
+			p = kmap_atomic(page);
+			dmac_inv_range(p, p + PAGE_SIZE);
+			outer_inv_range(phys, phys + PAGE_SIZE);
+			kunmap_atomic(p);
+			n = 1;
+			continue;
+		}
+
+		for (n = 1; i + n < num_pages; n++) {
+			if (PageHighMem(pages[i + n]) ||
+			    page_to_pfn(pages[i + n]) != page_to_pfn(page) + n)
+				break;
+		}
+		p = page_address(page);
+		dmac_inv_range(p, p + n * PAGE_SIZE);
+		outer_inv_range(phys, phys + n * PAGE_SIZE);
+	}
+}
+
 int ion_heap_pages_zero(struct page **pages, int num_pages,
 				bool should_invalidate)
 {
-	int i, j, k, npages_to_vmap;
+	int i, j, npages_to_vmap;
 	void *ptr = NULL;
 	pgprot_t pgprot = pgprot_writecombine(pgprot_kernel);
 
@@ -126,17 +159,8 @@ int ion_heap_pages_zero(struct page **pages, int num_pages,
 			return -ENOMEM;
 
 		memset(ptr, 0, npages_to_vmap * PAGE_SIZE);
-		if (should_invalidate) {
-			for (k = 0; k < npages_to_vmap; k++) {
-				void *p = kmap_atomic(pages[i + k]);
-				phys_addr_t phys = page_to_phys(
-							pages[i + k]);
-
-				dmac_inv_range(p, p + PAGE_SIZE);
-				outer_inv_range(phys, phys + PAGE_SIZE);
-				kunmap_atomic(p);
-			}
-		}
+		if (should_invalidate)
+			ion_heap_pages_inv(&pages[i], npages_to_vmap);
 		vunmap(ptr);
 	}
 
@@ -275,8 +299,18 @@ void ion_heap_free_page(struct ion_buffer *buffer, struct page *page,
 void ion_heap_freelist_add(struct ion_heap *heap, struct ion_buffer * buffer)
 {
 	rt_mutex_lock(&heap->lock);
-	list_add(&buffer->list, &heap->free_list);
+	if (deferred_free_max_kb &&
+	    heap->free_list_size + buffer->size >
+	    (size_t)deferred_free_max_kb << 10) {
+		heap->free_throttled++;
+		rt_mutex_unlock(&heap->lock);
+		ion_buffer_destroy(buffer);
+		return;
+	}
+	list_add_tail(&buffer->list, &heap->free_list);
 	heap->free_list_size += buffer->size;
+	if (heap->free_list_size > heap->free_list_peak)
+		heap->free_list_peak = heap->free_list_size;
 	rt_mutex_unlock(&heap->lock);
 	wake_up(&heap->waitqueue);
 }
@@ -301,6 +335,13 @@ static size_t _ion_heap_freelist_drain(struct ion_heap *heap, size_t size,
 	if (ion_heap_freelist_size(heap) == 0)
 		return 0;
 
+	if (skip_pools) {
+		if (!rt_mutex_trylock(&heap->free_batch_lock))
+			return 0;
+	} else {
+		rt_mutex_lock(&heap->free_batch_lock);
+	}
+
 	rt_mutex_lock(&heap->lock);
 	if (size == 0)
 		size = heap->free_list_size;
@@ -316,6 +357,7 @@ static size_t _ion_heap_freelist_drain(struct ion_heap *heap, size_t size,
 		ion_buffer_destroy(buffer);
 	}
 	rt_mutex_unlock(&heap->lock);
+	rt_mutex_unlock(&heap->free_batch_lock);
 
 	return total_drained;
 }
@@ -335,22 +377,28 @@ int ion_heap_deferred_free(void *data)
 	struct ion_heap *heap = data;
 
 	while (true) {
-		struct ion_buffer *buffer;
+		struct ion_buffer *buffer, *tmp;
+		LIST_HEAD(batch);
 
 		wait_event_freezable(heap->waitqueue,
 				     ion_heap_freelist_size(heap) > 0);
 
+		rt_mutex_lock(&heap->free_batch_lock);
 		rt_mutex_lock(&heap->lock);
-		if (list_empty(&heap->free_list)) {
+		list_splice_init(&heap->free_list, &batch);
+		rt_mutex_unlock(&heap->lock);
+
+		list_for_each_entry_safe(buffer, tmp, &batch, list) {
+			size_t size = buffer->size;
+
+			list_del(&buffer->list);
+			ion_buffer_destroy(buffer);
+
+			rt_mutex_lock(&heap->lock);
+			heap->free_list_size -= size;
 			rt_mutex_unlock(&heap->lock);
-			continue;
 		}
-		buffer = list_first_entry(&heap->free_list, struct ion_buffer,
-					  list);
-		list_del(&buffer->list);
-		heap->free_list_size -= buffer->size;
-		rt_mutex_unlock(&heap->lock);
-		ion_buffer_destroy(buffer);
+		rt_mutex_unlock(&heap->free_batch_lock);
 	}
 
 	return 0;
@@ -363,6 +411,7 @@ int ion_heap_init_deferred_free(struct ion_heap *heap)
 	INIT_LIST_HEAD(&heap->free_list);
 	heap->free_list_size = 0;
 	rt_mutex_init(&heap->lock);
+	rt_mutex_init(&heap->free_batch_lock);
 	init_waitqueue_head(&heap->waitqueue);
 	heap->task = kthread_run(ion_heap_deferred_free, heap,
 				 "%s", heap->name);
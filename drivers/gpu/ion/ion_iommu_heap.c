@@ -134,7 +134,7 @@ static struct page_info *alloc_largest_available(struct ion_iommu_heap *heap,
 static int ion_iommu_buffer_zero(struct ion_iommu_priv_data *data,
 				bool is_cached)
 {
-	int i, j, k;
+	int i, j;
 	unsigned int npages_to_vmap;
 	unsigned int total_pages;
 	void *ptr = NULL;
@@ -158,17 +158,8 @@ static int ion_iommu_buffer_zero(struct ion_iommu_priv_data *data,
 			return -ENOMEM;
 
 		memset(ptr, 0, npages_to_vmap * PAGE_SIZE);
-		if (is_cached) {
-			for (k = 0; k < npages_to_vmap; k++) {
-				void *p = kmap_atomic(data->pages[i + k]);
-				phys_addr_t phys = page_to_phys(
-							data->pages[i + k]);
-
-				dmac_inv_range(p, p + PAGE_SIZE);
-				outer_inv_range(phys, phys + PAGE_SIZE);
-				kunmap_atomic(p);
-			}
-		}
+		if (is_cached)
+			ion_heap_pages_inv(&data->pages[i], npages_to_vmap);
 		vunmap(ptr);
 	}
 
@@ -193,8 +184,9 @@ static int ion_iommu_heap_allocate(struct ion_heap *heap,
 		int j;
 		unsigned int num_large_pages = 0;
 		unsigned long size_remaining = PAGE_ALIGN(size);
-		unsigned int max_order = ION_IS_CACHED(flags) ? 0 : orders[0];
+		unsigned int max_order = orders[0];
 		unsigned int page_tbl_size;
+		bool split_pages = ion_buffer_fault_user_mappings(buffer);
 
 		data = kmalloc(sizeof(*data), GFP_KERNEL);
 		if (!data)
@@ -244,7 +236,8 @@ static int ion_iommu_heap_allocate(struct ion_heap *heap,
 			ret = -ENOMEM;
 			goto err1;
 		}
-		ret = sg_alloc_table(table, num_large_pages, GFP_KERNEL);
+		ret = sg_alloc_table(table, split_pages ? data->nrpages :
+				     num_large_pages, GFP_KERNEL);
 		if (ret)
 			goto err2;
 
@@ -252,9 +245,21 @@ static int ion_iommu_heap_allocate(struct ion_heap *heap,
 		sg = table->sgl;
 		list_for_each_entry_safe(info, tmp_info, &pages_list, list) {
 			struct page *page = info->page;
-			sg_set_page(sg, page, order_to_size(info->order), 0);
-			sg_dma_address(sg) = sg_phys(sg);
-			sg = sg_next(sg);
+
+			if (split_pages) {
+				split_page(page, info->order);
+				for (j = 0; j < (1 << info->order); ++j) {
+					sg_set_page(sg, nth_page(page, j),
+						    PAGE_SIZE, 0);
+					sg_dma_address(sg) = sg_phys(sg);
+					sg = sg_next(sg);
+				}
+			} else {
+				sg_set_page(sg, page,
+					    order_to_size(info->order), 0);
+				sg_dma_address(sg) = sg_phys(sg);
+				sg = sg_next(sg);
+			}
 			for (j = 0; j < (1 << info->order); ++j)
 				data->pages[i++] = nth_page(page, j);
 			list_del(&info->list);
@@ -492,6 +497,7 @@ struct ion_heap *ion_iommu_heap_create(struct ion_platform_heap *heap_data)
 
 	iommu_heap->heap.ops = &iommu_heap_ops;
 	iommu_heap->heap.type = ION_HEAP_TYPE_IOMMU;
+	iommu_heap->heap.flags = ION_HEAP_FLAG_DEFER_FREE;
 	iommu_heap->uncached_pools = kzalloc(
 			      sizeof(struct ion_page_pool *) * num_orders,
 			      GFP_KERNEL);
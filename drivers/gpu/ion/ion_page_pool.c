@@ -30,21 +30,22 @@ struct ion_page_pool_item {
 };
 
 
-static void *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
+static void *__ion_page_pool_alloc_pages(struct ion_page_pool *pool,
+					 gfp_t gfp_mask)
 {
 	struct page *page;
 	struct scatterlist sg;
 	const bool high_order = pool->order > 4;
 
 	if (high_order)
-		page = alloc_pages(pool->gfp_mask & ~__GFP_ZERO, pool->order);
+		page = alloc_pages(gfp_mask & ~__GFP_ZERO, pool->order);
 	else
-		page = alloc_pages(pool->gfp_mask, pool->order);
+		page = alloc_pages(gfp_mask, pool->order);
 
 	if (!page)
 		return NULL;
 
-	if ((pool->gfp_mask & __GFP_ZERO) && high_order)
+	if ((gfp_mask & __GFP_ZERO) && high_order)
 		if (ion_heap_high_order_page_zero(
 				page, pool->order, pool->should_invalidate))
 			goto error_free_pages;
@@ -61,6 +62,11 @@ error_free_pages:
 	return NULL;
 }
 
+static void *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
+{
+	return __ion_page_pool_alloc_pages(pool, pool->gfp_mask);
+}
+
 static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 				     struct page *page)
 {
@@ -123,6 +129,10 @@ void *ion_page_pool_alloc(struct ion_page_pool *pool)
 		page = ion_page_pool_remove(pool, true);
 	else if (pool->low_count)
 		page = ion_page_pool_remove(pool, false);
+	if (page)
+		pool->hits++;
+	else
+		pool->misses++;
 	mutex_unlock(&pool->mutex);
 
 	if (!page)
@@ -149,6 +159,36 @@ static int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 	return total;
 }
 
+int ion_page_pool_count(struct ion_page_pool *pool)
+{
+	return (pool->high_count + pool->low_count) << pool->order;
+}
+
+int ion_page_pool_refill(struct ion_page_pool *pool, int nr_pages)
+{
+	gfp_t gfp_mask = (pool->gfp_mask | __GFP_NOWARN | __GFP_NORETRY |
+			  __GFP_NOMEMALLOC | __GFP_NO_KSWAPD) & ~__GFP_WAIT;
+	struct page *page;
+	int nr_added = 0;
+
+	while (nr_added < nr_pages) {
+		page = __ion_page_pool_alloc_pages(pool, gfp_mask);
+		if (!page)
+			break;
+		if (ion_page_pool_add(pool, page)) {
+			ion_page_pool_free_pages(pool, page);
+			break;
+		}
+		nr_added += 1 << pool->order;
+	}
+
+	mutex_lock(&pool->mutex);
+	pool->refilled += nr_added >> pool->order;
+	mutex_unlock(&pool->mutex);
+
+	return nr_added;
+}
+
 int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 				int nr_to_scan)
 {
@@ -190,6 +230,9 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
 		return NULL;
 	pool->high_count = 0;
 	pool->low_count = 0;
+	pool->hits = 0;
+	pool->misses = 0;
+	pool->refilled = 0;
 	INIT_LIST_HEAD(&pool->low_items);
 	INIT_LIST_HEAD(&pool->high_items);
 	pool->gfp_mask = gfp_mask;
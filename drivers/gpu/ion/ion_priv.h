@@ -98,7 +98,10 @@ struct ion_heap {
 	void *priv;
 	struct list_head free_list;
 	size_t free_list_size;
+	size_t free_list_peak;
+	unsigned long free_throttled;
 	struct rt_mutex lock;
+	struct rt_mutex free_batch_lock;
 	wait_queue_head_t waitqueue;
 	struct task_struct *task;
 	int (*debug_show)(struct ion_heap *heap, struct seq_file *, void *);
@@ -131,6 +134,7 @@ int ion_heap_pages_zero(struct page **pages, int num_pages,
 int ion_heap_buffer_zero(struct ion_buffer *buffer);
 int ion_heap_high_order_page_zero(struct page *page,
 				int order, bool should_invalidate);
+void ion_heap_pages_inv(struct page **pages, int num_pages);
 
 int ion_heap_init_deferred_free(struct ion_heap *heap);
 
@@ -175,6 +179,9 @@ struct ion_page_pool {
 	unsigned int order;
 	struct plist_node list;
 	bool should_invalidate;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long refilled;
 };
 
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
@@ -185,6 +192,8 @@ void ion_page_pool_free(struct ion_page_pool *, struct page *);
 
 int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 			  int nr_to_scan);
+int ion_page_pool_count(struct ion_page_pool *pool);
+int ion_page_pool_refill(struct ion_page_pool *pool, int nr_pages);
 
 int ion_walk_heaps(struct ion_client *client, int heap_id, void *data,
 			int (*f)(struct ion_heap *heap, void *data));
@@ -19,8 +19,12 @@
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
 #include <linux/highmem.h>
+#include <linux/freezer.h>
 #include <linux/ion.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/sched.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
@@ -51,10 +55,29 @@ static unsigned int order_to_size(int order)
 	return PAGE_SIZE << order;
 }
 
+static unsigned int uncached_pool_low_kb;
+module_param(uncached_pool_low_kb, uint, S_IRUGO | S_IWUSR);
+static unsigned int uncached_pool_high_kb;
+module_param(uncached_pool_high_kb, uint, S_IRUGO | S_IWUSR);
+static unsigned int cached_pool_low_kb;
+module_param(cached_pool_low_kb, uint, S_IRUGO | S_IWUSR);
+static unsigned int cached_pool_high_kb;
+module_param(cached_pool_high_kb, uint, S_IRUGO | S_IWUSR);
+
+#define ION_POOL_REFILL_PENDING		0
+
 struct ion_system_heap {
 	struct ion_heap heap;
 	struct ion_page_pool **uncached_pools;
 	struct ion_page_pool **cached_pools;
+	struct task_struct *refill_task;
+	wait_queue_head_t refill_wait;
+	unsigned long refill_flags;
+	unsigned long shrink_stamp;
+	unsigned long refill_runs;
+	unsigned long refill_pages;
+	u64 refill_ns;
+	u64 refill_max_ns;
 };
 
 struct page_info {
@@ -63,6 +86,85 @@ struct page_info {
 	struct list_head list;
 };
 
+static int ion_system_heap_pool_pages(struct ion_page_pool **pools)
+{
+	int i, total = 0;
+
+	for (i = 0; i < num_orders; i++)
+		total += ion_page_pool_count(pools[i]);
+	return total;
+}
+
+static bool ion_system_heap_pools_low(struct ion_page_pool **pools,
+				      unsigned int low_kb)
+{
+	return low_kb &&
+		ion_system_heap_pool_pages(pools) < low_kb >> (PAGE_SHIFT - 10);
+}
+
+static int ion_system_heap_refill_pools(struct ion_page_pool **pools,
+					unsigned int high_kb)
+{
+	int target = high_kb >> (PAGE_SHIFT - 10);
+	int nr_added = 0;
+	int i, nr;
+
+	for (i = 0; i < num_orders; i++) {
+		nr = target - ion_system_heap_pool_pages(pools);
+		nr &= ~((1 << orders[i]) - 1);
+		if (nr <= 0)
+			continue;
+		nr_added += ion_page_pool_refill(pools[i], nr);
+	}
+	return nr_added;
+}
+
+static int ion_system_heap_refill_thread(void *data)
+{
+	struct ion_system_heap *heap = data;
+	ktime_t start;
+	u64 ns;
+	int nr;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		wait_event_freezable(heap->refill_wait,
+			test_bit(ION_POOL_REFILL_PENDING, &heap->refill_flags) ||
+			kthread_should_stop());
+
+		clear_bit(ION_POOL_REFILL_PENDING, &heap->refill_flags);
+		if (time_before(jiffies, heap->shrink_stamp + HZ))
+			continue;
+
+		start = ktime_get();
+		nr = ion_system_heap_refill_pools(heap->uncached_pools,
+						  uncached_pool_high_kb);
+		nr += ion_system_heap_refill_pools(heap->cached_pools,
+						   cached_pool_high_kb);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		heap->refill_runs++;
+		heap->refill_pages += nr;
+		heap->refill_ns += ns;
+		if (ns > heap->refill_max_ns)
+			heap->refill_max_ns = ns;
+	}
+	return 0;
+}
+
+static void ion_system_heap_check_refill(struct ion_system_heap *heap)
+{
+	if (!heap->refill_task)
+		return;
+	if (!ion_system_heap_pools_low(heap->uncached_pools,
+				       uncached_pool_low_kb) &&
+	    !ion_system_heap_pools_low(heap->cached_pools,
+				       cached_pool_low_kb))
+		return;
+	if (!test_and_set_bit(ION_POOL_REFILL_PENDING, &heap->refill_flags))
+		wake_up(&heap->refill_wait);
+}
+
 static struct page *alloc_buffer_page(struct ion_system_heap *heap,
 				      struct ion_buffer *buffer,
 				      unsigned long order)
@@ -202,6 +304,7 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	}
 
 	buffer->priv_virt = table;
+	ion_system_heap_check_refill(sys_heap);
 	return 0;
 err1:
 	kfree(table);
@@ -273,6 +376,7 @@ static int ion_system_heap_shrink(struct shrinker *shrinker,
 	if (sc->nr_to_scan == 0)
 		goto end;
 
+	sys_heap->shrink_stamp = jiffies;
 	nr_freed += ion_heap_freelist_drain_from_shrinker(
 		heap, sc->nr_to_scan * PAGE_SIZE) / PAGE_SIZE;
 
@@ -323,6 +427,9 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 			pool->low_count, pool->order,
 			(1 << pool->order) * PAGE_SIZE * pool->low_count);
 		total_pages += (1 << pool->order) * (pool->high_count + pool->low_count);
+		seq_printf(s,
+			"order %u uncached pool: %lu hits %lu misses %lu refilled\n",
+			pool->order, pool->hits, pool->misses, pool->refilled);
 	}
 
 	for (i = 0; i < num_orders; i++) {
@@ -336,12 +443,21 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 			pool->low_count, pool->order,
 			(1 << pool->order) * PAGE_SIZE * pool->low_count);
 		total_pages += (1 << pool->order) * (pool->high_count + pool->low_count);
+		seq_printf(s,
+			"order %u cached pool: %lu hits %lu misses %lu refilled\n",
+			pool->order, pool->hits, pool->misses, pool->refilled);
 	}
 
 	seq_printf(s,
 		"Total: %lu pages with %lu bytes in page pools and %u bytes in free list\n",
 		total_pages, total_pages * PAGE_SIZE,
 		ion_heap_freelist_size(heap));
+	seq_printf(s,
+		"Refill: %lu runs, %lu pages, %llu ns avg, %llu ns max\n",
+		sys_heap->refill_runs, sys_heap->refill_pages,
+		sys_heap->refill_runs ?
+		div64_u64(sys_heap->refill_ns, sys_heap->refill_runs) : 0,
+		sys_heap->refill_max_ns);
 
 	return 0;
 }
@@ -379,6 +495,7 @@ err_create_pool:
 
 struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 {
+	struct sched_param param = { .sched_priority = 0 };
 	struct ion_system_heap *heap;
 	int pools_size = sizeof(struct ion_page_pool *) * num_orders;
 
@@ -408,6 +525,17 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 	heap->heap.shrinker.batch = 0;
 	register_shrinker(&heap->heap.shrinker);
 	heap->heap.debug_show = ion_system_heap_debug_show;
+
+	init_waitqueue_head(&heap->refill_wait);
+	heap->refill_task = kthread_run(ion_system_heap_refill_thread, heap,
+					"ion_pool_refill");
+	if (IS_ERR(heap->refill_task)) {
+		pr_err("%s: creating thread for pool refill failed\n",
+		       __func__);
+		heap->refill_task = NULL;
+	} else {
+		sched_setscheduler(heap->refill_task, SCHED_IDLE, &param);
+	}
 	return &heap->heap;
 
 err_create_cached_pools:
@@ -427,6 +555,9 @@ void ion_system_heap_destroy(struct ion_heap *heap)
 							struct ion_system_heap,
 							heap);
 
+	if (sys_heap->refill_task)
+		kthread_stop(sys_heap->refill_task);
+	unregister_shrinker(&heap->shrinker);
 	ion_system_heap_destroy_pools(sys_heap->uncached_pools);
 	ion_system_heap_destroy_pools(sys_heap->cached_pools);
 	kfree(sys_heap->uncached_pools);
@@ -538,6 +669,7 @@ struct ion_heap *ion_system_contig_heap_create(struct ion_platform_heap *unused)
 		return ERR_PTR(-ENOMEM);
 	heap->ops = &kmalloc_ops;
 	heap->type = ION_HEAP_TYPE_SYSTEM_CONTIG;
+	heap->flags = ION_HEAP_FLAG_DEFER_FREE;
 	return heap;
 }
 
@@ -11,14 +11,19 @@
  *
  */
 
+#include <linux/debugfs.h>
 #include <linux/dma-buf.h>
 #include <linux/export.h>
+#include <linux/init.h>
 #include <linux/iommu.h>
 #include <linux/ion.h>
 #include <linux/kernel.h>
 #include <linux/kref.h>
+#include <linux/sched.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 
 #include <mach/iommu_domains.h>
 
@@ -59,6 +64,28 @@ struct ion_iommu_meta {
 static struct rb_root iommu_root;
 DEFINE_MUTEX(msm_iommu_map_mutex);
 
+enum {
+	MAP_CHUNK_4K,
+	MAP_CHUNK_64K,
+	MAP_CHUNK_1M,
+	MAP_CHUNK_16M,
+	MAP_CHUNK_MAX,
+};
+
+static const unsigned long map_chunk_sizes[MAP_CHUNK_MAX] = {
+	SZ_4K, SZ_64K, SZ_1M, SZ_16M,
+};
+
+static struct ion_iommu_map_stats {
+	unsigned long maps;
+	unsigned long bytes;
+	unsigned long coalesced;
+	u64 map_ns;
+	u64 map_max_ns;
+	unsigned long chunks[MAP_CHUNK_MAX];
+} map_stats;
+static DEFINE_SPINLOCK(map_stats_lock);
+
 static void ion_iommu_meta_add(struct ion_iommu_meta *meta)
 {
 	struct rb_root *root = &iommu_root;
@@ -166,6 +193,87 @@ static struct ion_iommu_map *ion_iommu_lookup(
 	return NULL;
 }
 
+static int ion_iommu_coalesce_table(struct sg_table *table,
+				    struct sg_table *out)
+{
+	struct scatterlist *sg, *osg = NULL;
+	int i, nents = 0, ret;
+
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		if (!i || sg_phys(sg) != sg_phys(osg) + osg->length)
+			nents++;
+		osg = sg;
+	}
+	if (nents == table->nents)
+		return 0;
+
+	ret = sg_alloc_table(out, nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	osg = NULL;
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		if (osg && sg_phys(sg) == sg_phys(osg) + osg->length) {
+			osg->length += sg->length;
+			continue;
+		}
+		osg = osg ? sg_next(osg) : out->sgl;
+		sg_set_page(osg, sg_page(sg), sg->length, sg->offset);
+		sg_dma_address(osg) = sg_phys(sg);
+	}
+	return 1;
+}
+
+static unsigned long ion_iommu_map_align(struct scatterlist *sg)
+{
+	phys_addr_t pa = sg_phys(sg);
+	int i;
+
+	for (i = MAP_CHUNK_MAX - 1; i > 0; i--)
+		if (sg->length >= map_chunk_sizes[i] &&
+		    IS_ALIGNED(pa, map_chunk_sizes[i]))
+			return map_chunk_sizes[i];
+	return SZ_4K;
+}
+
+static void ion_iommu_map_account(struct sg_table *table, unsigned long va,
+				  bool coalesced, u64 ns)
+{
+	unsigned long chunks[MAP_CHUNK_MAX] = { 0 };
+	unsigned long bytes = 0;
+	struct scatterlist *sg;
+	int i, c;
+
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		phys_addr_t pa = sg_phys(sg);
+		unsigned long left = sg->length;
+
+		while (left) {
+			for (c = MAP_CHUNK_MAX - 1; c > 0; c--)
+				if (left >= map_chunk_sizes[c] &&
+				    IS_ALIGNED(va, map_chunk_sizes[c]) &&
+				    IS_ALIGNED(pa, map_chunk_sizes[c]))
+					break;
+			chunks[c]++;
+			va += map_chunk_sizes[c];
+			pa += map_chunk_sizes[c];
+			left -= map_chunk_sizes[c];
+		}
+		bytes += sg->length;
+	}
+
+	spin_lock(&map_stats_lock);
+	map_stats.maps++;
+	map_stats.bytes += bytes;
+	map_stats.coalesced += coalesced;
+	map_stats.map_ns += ns;
+	if (ns > map_stats.map_max_ns)
+		map_stats.map_max_ns = ns;
+	for (c = 0; c < MAP_CHUNK_MAX; c++)
+		map_stats.chunks[c] += chunks[c];
+	spin_unlock(&map_stats_lock);
+}
+
 static int ion_iommu_map_iommu(struct ion_iommu_meta *meta,
 					struct ion_iommu_map *data,
 					unsigned int domain_num,
@@ -177,8 +285,10 @@ static int ion_iommu_map_iommu(struct ion_iommu_meta *meta,
 	struct iommu_domain *domain;
 	int ret = 0;
 	unsigned long extra, size;
-	struct sg_table *table;
+	struct sg_table *table, coalesced;
 	int prot = IOMMU_WRITE | IOMMU_READ;
+	u64 start;
+	int merged;
 
 
 	size = meta->size;
@@ -186,8 +296,14 @@ static int ion_iommu_map_iommu(struct ion_iommu_meta *meta,
 	extra = iova_length - size;
 	table = meta->table;
 
-	if (sg_dma_len(table->sgl) > align)
-		align = sg_dma_len(table->sgl);
+	merged = ion_iommu_coalesce_table(table, &coalesced);
+	if (merged < 0)
+		return merged;
+	if (merged)
+		table = &coalesced;
+
+	if (ion_iommu_map_align(table->sgl) > align)
+		align = ion_iommu_map_align(table->sgl);
 
 	ret = msm_allocate_iova_address(domain_num, partition_num,
 						data->mapped_size, align,
@@ -203,6 +319,7 @@ static int ion_iommu_map_iommu(struct ion_iommu_meta *meta,
 		goto out1;
 	}
 
+	start = sched_clock();
 	ret = iommu_map_range(domain, data->iova_addr,
 			      table->sgl,
 			      size, prot);
@@ -211,6 +328,8 @@ static int ion_iommu_map_iommu(struct ion_iommu_meta *meta,
 			__func__, data->iova_addr, domain);
 		goto out1;
 	}
+	ion_iommu_map_account(table, data->iova_addr, merged,
+			      sched_clock() - start);
 
 	if (extra) {
 		unsigned long extra_iova_addr = data->iova_addr + size;
@@ -220,6 +339,8 @@ static int ion_iommu_map_iommu(struct ion_iommu_meta *meta,
 		if (ret)
 			goto out2;
 	}
+	if (merged)
+		sg_free_table(&coalesced);
 	return ret;
 
 out2:
@@ -229,7 +350,8 @@ out1:
 				size);
 
 out:
-
+	if (merged)
+		sg_free_table(&coalesced);
 	return ret;
 }
 
@@ -517,4 +639,54 @@ out:
 }
 EXPORT_SYMBOL(ion_unmap_iommu);
 
+static int ion_iommu_map_stats_show(struct seq_file *s, void *unused)
+{
+	struct ion_iommu_map_stats stats;
+	int c;
+
+	spin_lock(&map_stats_lock);
+	stats = map_stats;
+	spin_unlock(&map_stats_lock);
+
+	seq_printf(s, "maps: %lu\n", stats.maps);
+	seq_printf(s, "bytes: %lu\n", stats.bytes);
+	seq_printf(s, "coalesced: %lu\n", stats.coalesced);
+	seq_printf(s, "map_ns_avg: %llu\n",
+		   stats.maps ? div64_u64(stats.map_ns, stats.maps) : 0);
+	seq_printf(s, "map_ns_max: %llu\n", stats.map_max_ns);
+	for (c = 0; c < MAP_CHUNK_MAX; c++)
+		seq_printf(s, "entries_%luk: %lu\n",
+			   map_chunk_sizes[c] >> 10, stats.chunks[c]);
+	return 0;
+}
 
+static int ion_iommu_map_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ion_iommu_map_stats_show, inode->i_private);
+}
+
+static ssize_t ion_iommu_map_stats_write(struct file *file,
+					 const char __user *buf,
+					 size_t count, loff_t *ppos)
+{
+	spin_lock(&map_stats_lock);
+	memset(&map_stats, 0, sizeof(map_stats));
+	spin_unlock(&map_stats_lock);
+	return count;
+}
+
+static const struct file_operations ion_iommu_map_stats_fops = {
+	.open = ion_iommu_map_stats_open,
+	.read = seq_read,
+	.write = ion_iommu_map_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init ion_iommu_map_debugfs_init(void)
+{
+	debugfs_create_file("ion_iommu_map_stats", 0644, NULL, NULL,
+			    &ion_iommu_map_stats_fops);
+	return 0;
+}
+late_initcall(ion_iommu_map_debugfs_init);
@@ -37,6 +37,7 @@
 #include "kgsl_cffdump.h"
 #include "kgsl_log.h"
 #include "kgsl_sharedmem.h"
+#include "kgsl_pool.h"
 #include "kgsl_device.h"
 #include "kgsl_trace.h"
 #include "kgsl_sync.h"
@@ -3643,13 +3644,16 @@ static void kgsl_core_exit(void)
 	}
 
 	kgsl_memfree_hist_exit();
+	kgsl_pool_exit();
 	unregister_chrdev_region(kgsl_driver.major, KGSL_DEVICE_MAX);
 }
 
 static int __init kgsl_core_init(void)
 {
 	int result = 0;
-	
+
+	kgsl_pool_init();
+
 	result = alloc_chrdev_region(&kgsl_driver.major, 0, KGSL_DEVICE_MAX,
 				  KGSL_NAME);
 	if (result < 0) {
@@ -314,6 +314,12 @@ struct kgsl_process_private {
 		unsigned int cur;
 		unsigned int max;
 	} stats[KGSL_MEM_ENTRY_MAX];
+
+	struct {
+		unsigned int count;
+		u64 total_ns;
+		u64 max_ns;
+	} alloc_stats;
 };
 
 enum kgsl_process_priv_flags {
@@ -0,0 +1,184 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/highmem.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/spinlock.h>
+#include <asm/cacheflush.h>
+
+#include "kgsl_pool.h"
+
+struct kgsl_page_pool {
+	unsigned int order;
+	int count;
+	spinlock_t lock;
+	struct list_head items;
+};
+
+static struct kgsl_page_pool kgsl_pools[] = {
+	{ .order = 0 },
+	{ .order = 4 },
+};
+
+static atomic_t kgsl_pool_pages = ATOMIC_INIT(0);
+static size_t kgsl_pool_max = 16 << 20;
+
+static struct kgsl_page_pool *kgsl_pool_find(unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools); i++)
+		if (kgsl_pools[i].order == order)
+			return &kgsl_pools[i];
+	return NULL;
+}
+
+static void kgsl_pool_zero_page(struct page *page, unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < (1 << order); i++) {
+		struct page *p = nth_page(page, i);
+		void *addr = kmap_atomic(p);
+
+		memset(addr, 0, PAGE_SIZE);
+		dmac_flush_range(addr, addr + PAGE_SIZE);
+		kunmap_atomic(addr);
+	}
+	outer_flush_range(page_to_phys(page),
+			  page_to_phys(page) + (PAGE_SIZE << order));
+}
+
+struct page *kgsl_pool_alloc_page(unsigned int order)
+{
+	struct kgsl_page_pool *pool = kgsl_pool_find(order);
+	struct page *page = NULL;
+
+	if (pool == NULL)
+		return NULL;
+
+	spin_lock(&pool->lock);
+	if (pool->count) {
+		page = list_first_entry(&pool->items, struct page, lru);
+		list_del(&page->lru);
+		pool->count--;
+	}
+	spin_unlock(&pool->lock);
+
+	if (page)
+		atomic_sub(1 << order, &kgsl_pool_pages);
+	return page;
+}
+
+void kgsl_pool_free_page(struct page *page, unsigned int order)
+{
+	struct kgsl_page_pool *pool = kgsl_pool_find(order);
+
+	if (pool == NULL || ((size_t)atomic_read(&kgsl_pool_pages) +
+			     (1 << order)) << PAGE_SHIFT > kgsl_pool_max) {
+		__free_pages(page, order);
+		return;
+	}
+
+	kgsl_pool_zero_page(page, order);
+
+	spin_lock(&pool->lock);
+	list_add_tail(&page->lru, &pool->items);
+	pool->count++;
+	spin_unlock(&pool->lock);
+	atomic_add(1 << order, &kgsl_pool_pages);
+}
+
+static int kgsl_pool_drain(struct kgsl_page_pool *pool, int nr_pages)
+{
+	struct page *page;
+	int freed = 0;
+
+	while (freed < nr_pages) {
+		spin_lock(&pool->lock);
+		if (!pool->count) {
+			spin_unlock(&pool->lock);
+			break;
+		}
+		page = list_first_entry(&pool->items, struct page, lru);
+		list_del(&page->lru);
+		pool->count--;
+		spin_unlock(&pool->lock);
+
+		atomic_sub(1 << pool->order, &kgsl_pool_pages);
+		__free_pages(page, pool->order);
+		freed += 1 << pool->order;
+	}
+	return freed;
+}
+
+static int kgsl_pool_shrink(struct shrinker *shrinker,
+			    struct shrink_control *sc)
+{
+	int i, freed = 0;
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools) && freed < sc->nr_to_scan; i++)
+		freed += kgsl_pool_drain(&kgsl_pools[i],
+					 sc->nr_to_scan - freed);
+
+	return atomic_read(&kgsl_pool_pages);
+}
+
+static struct shrinker kgsl_pool_shrinker = {
+	.shrink = kgsl_pool_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+size_t kgsl_pool_size(void)
+{
+	return (size_t)atomic_read(&kgsl_pool_pages) << PAGE_SHIFT;
+}
+
+size_t kgsl_pool_max_size(void)
+{
+	return kgsl_pool_max;
+}
+
+void kgsl_pool_set_max_size(size_t size)
+{
+	int i;
+
+	kgsl_pool_max = size;
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools) &&
+	     kgsl_pool_size() > kgsl_pool_max; i++)
+		kgsl_pool_drain(&kgsl_pools[i],
+			(kgsl_pool_size() - kgsl_pool_max) >> PAGE_SHIFT);
+}
+
+void kgsl_pool_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools); i++) {
+		spin_lock_init(&kgsl_pools[i].lock);
+		INIT_LIST_HEAD(&kgsl_pools[i].items);
+	}
+
+	register_shrinker(&kgsl_pool_shrinker);
+}
+
+void kgsl_pool_exit(void)
+{
+	int i;
+
+	unregister_shrinker(&kgsl_pool_shrinker);
+
+	for (i = 0; i < ARRAY_SIZE(kgsl_pools); i++)
+		kgsl_pool_drain(&kgsl_pools[i], INT_MAX);
+}
@@ -0,0 +1,28 @@
+/* Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#ifndef __KGSL_POOL_H
+#define __KGSL_POOL_H
+
+#include <linux/mm_types.h>
+
+struct page *kgsl_pool_alloc_page(unsigned int order);
+void kgsl_pool_free_page(struct page *page, unsigned int order);
+
+size_t kgsl_pool_size(void);
+size_t kgsl_pool_max_size(void);
+void kgsl_pool_set_max_size(size_t size);
+
+void kgsl_pool_init(void);
+void kgsl_pool_exit(void);
+
+#endif /* __KGSL_POOL_H */
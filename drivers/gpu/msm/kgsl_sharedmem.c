@@ -12,6 +12,7 @@
  */
 
 #include <linux/export.h>
+#include <linux/ktime.h>
 #include <linux/vmalloc.h>
 #include <linux/memory_alloc.h>
 #include <asm/cacheflush.h>
@@ -22,6 +23,7 @@
 
 #include "kgsl.h"
 #include "kgsl_sharedmem.h"
+#include "kgsl_pool.h"
 #include "kgsl_cffdump.h"
 #include "kgsl_device.h"
 
@@ -94,6 +96,35 @@ mem_entry_max_show(struct kgsl_process_private *priv, int type, char *buf)
 }
 
 
+enum {
+	ALLOC_STAT_COUNT,
+	ALLOC_STAT_AVG_US,
+	ALLOC_STAT_MAX_US,
+};
+
+static ssize_t
+alloc_stat_show(struct kgsl_process_private *priv, int type, char *buf)
+{
+	u64 val = 0;
+
+	switch (type) {
+	case ALLOC_STAT_COUNT:
+		val = priv->alloc_stats.count;
+		break;
+	case ALLOC_STAT_AVG_US:
+		if (priv->alloc_stats.count)
+			val = div_u64(priv->alloc_stats.total_ns,
+				      priv->alloc_stats.count);
+		do_div(val, NSEC_PER_USEC);
+		break;
+	case ALLOC_STAT_MAX_US:
+		val = priv->alloc_stats.max_ns;
+		do_div(val, NSEC_PER_USEC);
+		break;
+	}
+	return snprintf(buf, PAGE_SIZE, "%llu\n", val);
+}
+
 static void mem_entry_sysfs_release(struct kobject *kobj)
 {
 }
@@ -139,6 +170,14 @@ static struct mem_entry_stats mem_stats[] = {
 #endif
 };
 
+static struct kgsl_mem_entry_attribute alloc_stats[] = {
+	__MEM_ENTRY_ATTR(ALLOC_STAT_COUNT, alloc_count, alloc_stat_show),
+	__MEM_ENTRY_ATTR(ALLOC_STAT_AVG_US, alloc_latency_avg_us,
+		alloc_stat_show),
+	__MEM_ENTRY_ATTR(ALLOC_STAT_MAX_US, alloc_latency_max_us,
+		alloc_stat_show),
+};
+
 void
 kgsl_process_uninit_sysfs(struct kgsl_process_private *private)
 {
@@ -150,6 +189,9 @@ kgsl_process_uninit_sysfs(struct kgsl_process_private *private)
 			&mem_stats[i].max_attr.attr);
 	}
 
+	for (i = 0; i < ARRAY_SIZE(alloc_stats); i++)
+		sysfs_remove_file(&private->kobj, &alloc_stats[i].attr);
+
 	kobject_put(&private->kobj);
 }
 
@@ -175,6 +217,9 @@ kgsl_process_init_sysfs(struct kgsl_device *device,
 		ret = sysfs_create_file(&private->kobj,
 			&mem_stats[i].max_attr.attr);
 	}
+
+	for (i = 0; i < ARRAY_SIZE(alloc_stats); i++)
+		ret = sysfs_create_file(&private->kobj, &alloc_stats[i].attr);
 	return ret;
 }
 
@@ -242,6 +287,34 @@ static int kgsl_drv_full_cache_threshold_show(struct device *dev,
 			kgsl_driver.full_cache_threshold);
 }
 
+static int kgsl_drv_page_pool_show(struct device *dev,
+				   struct device_attribute *attr,
+				   char *buf)
+{
+	size_t val;
+
+	if (!strcmp(attr->attr.name, "page_pool_max"))
+		val = kgsl_pool_max_size();
+	else
+		val = kgsl_pool_size();
+
+	return snprintf(buf, PAGE_SIZE, "%zu\n", val);
+}
+
+static int kgsl_drv_page_pool_max_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	unsigned int size;
+
+	if (sscanf(buf, "%u", &size) != 1)
+		return -EINVAL;
+
+	kgsl_pool_set_max_size(size);
+
+	return count;
+}
+
 static int kgsl_alloc_show(struct device *dev,
 					struct device_attribute *attr,
 					char *buf)
@@ -263,6 +336,9 @@ DEVICE_ATTR(full_cache_threshold, 0644,
 		kgsl_drv_full_cache_threshold_show,
 		kgsl_drv_full_cache_threshold_store);
 DEVICE_ATTR(kgsl_alloc, 0444, kgsl_alloc_show, NULL);
+DEVICE_ATTR(page_pool, 0444, kgsl_drv_page_pool_show, NULL);
+DEVICE_ATTR(page_pool_max, 0644, kgsl_drv_page_pool_show,
+		kgsl_drv_page_pool_max_store);
 
 static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_vmalloc,
@@ -276,6 +352,8 @@ static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_histogram,
 	&dev_attr_full_cache_threshold,
 	&dev_attr_kgsl_alloc,
+	&dev_attr_page_pool,
+	&dev_attr_page_pool_max,
 	NULL
 };
 
@@ -387,7 +465,7 @@ static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 			size = 1 << get_order(sg->length);
 			for (j = 0; j < size; j++)
 				ClearPageKgsl(nth_page(sg_page(sg), j));
-			__free_pages(sg_page(sg), get_order(sg->length));
+			kgsl_pool_free_page(sg_page(sg), get_order(sg->length));
 		}
 
 	if (priv)
@@ -601,29 +679,33 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 		else
 			gfp_mask |= GFP_KERNEL;
 
-		page = alloc_pages(gfp_mask, get_order(page_size));
-
+		page = kgsl_pool_alloc_page(get_order(page_size));
 		if (page == NULL) {
-			if (page_size != PAGE_SIZE) {
-				page_size = PAGE_SIZE;
-				continue;
-			}
+			page = alloc_pages(gfp_mask, get_order(page_size));
+
+			if (page == NULL) {
+				if (page_size != PAGE_SIZE) {
+					page_size = PAGE_SIZE;
+					continue;
+				}
 
-			memdesc->sglen = sglen;
-			memdesc->size = (size - len);
+				memdesc->sglen = sglen;
+				memdesc->size = (size - len);
 
-			KGSL_CORE_ERR(
-				"Out of memory: only allocated %dKB of %dKB requested\n",
-				(size - len) >> 10, size >> 10);
+				KGSL_CORE_ERR(
+					"Out of memory: only allocated %dKB of %dKB requested\n",
+					(size - len) >> 10, size >> 10);
 
-			ret = -ENOMEM;
-			goto done;
+				ret = -ENOMEM;
+				goto done;
+			}
+
+			for (j = 0; j < page_size >> PAGE_SHIFT; j++)
+				pages[pcount++] = nth_page(page, j);
 		}
 
-		for (j = 0; j < page_size >> PAGE_SHIFT; j++) {
-			pages[pcount++] = nth_page(page, j);
+		for (j = 0; j < page_size >> PAGE_SHIFT; j++)
 			SetPageKgsl(nth_page(page, j));
-		}
 
 		sg_set_page(&memdesc->sg[sglen++], page, page_size, 0);
 		len -= page_size;
@@ -657,8 +739,9 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 		}
 	}
 
-	outer_cache_range_op_sg(memdesc->sg, memdesc->sglen,
-				KGSL_CACHE_OP_FLUSH);
+	if (pcount)
+		outer_cache_range_op_sg(memdesc->sg, memdesc->sglen,
+					KGSL_CACHE_OP_FLUSH);
 
 	order = get_order(size);
 
@@ -707,15 +790,24 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 {
 	int ret = 0;
 	struct kgsl_process_private *priv = memdesc->private;
+	ktime_t start;
+	u64 ns;
 
 	size = PAGE_ALIGN(size);
 	if (size == 0)
 		return -EINVAL;
 
+	start = ktime_get();
 	ret = _kgsl_sharedmem_page_alloc(memdesc, pagetable, size);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 
-	if (!ret && priv)
+	if (!ret && priv) {
 		kgsl_process_add_stats(priv, KGSL_MEM_ENTRY_PAGE_ALLOC, size);
+		priv->alloc_stats.count++;
+		priv->alloc_stats.total_ns += ns;
+		if (ns > priv->alloc_stats.max_ns)
+			priv->alloc_stats.max_ns = ns;
+	}
 	return ret;
 }
 EXPORT_SYMBOL(kgsl_sharedmem_page_alloc_user);
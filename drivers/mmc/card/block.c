@@ -68,6 +68,7 @@ MODULE_ALIAS("mmc:block");
 			(req->cmd_flags & REQ_META)) && \
 			(rq_data_dir(req) == WRITE))
 #define PACKED_CMD_VER		0x01
+#define PACKED_CMD_RD		0x01
 #define PACKED_CMD_WR		0x02
 #define PACKED_TRIGGER_MAX_ELEMENTS	5000
 #define MMC_BLK_UPDATE_STOP_REASON(stats, reason)			\
@@ -1366,7 +1367,8 @@ static int mmc_blk_err_check(struct mmc_card *card,
 		return MMC_BLK_ABORT;
 	}
 
-	if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ) {
+	if (!mmc_host_is_spi(card->host) && (rq_data_dir(req) != READ ||
+			mq_mrq->packed_cmd == MMC_PACKED_WR_HDR)) {
 		u32 status;
 		unsigned long timeout;
 
@@ -1814,6 +1816,36 @@ void mmc_blk_init_packed_statistics(struct mmc_card *card)
 }
 EXPORT_SYMBOL(mmc_blk_init_packed_statistics);
 
+struct mmc_wr_pack_stats *mmc_blk_get_rd_packed_statistics(
+		struct mmc_card *card)
+{
+	if (!card)
+		return NULL;
+
+	return &card->rd_pack_stats;
+}
+EXPORT_SYMBOL(mmc_blk_get_rd_packed_statistics);
+
+void mmc_blk_init_rd_packed_statistics(struct mmc_card *card)
+{
+	int max_num_of_packed_reqs = 0;
+
+	if (!card || !card->rd_pack_stats.packing_events)
+		return;
+
+	max_num_of_packed_reqs = card->ext_csd.max_packed_reads;
+
+	spin_lock(&card->rd_pack_stats.lock);
+	memset(card->rd_pack_stats.packing_events, 0,
+		(max_num_of_packed_reqs + 1) *
+	       sizeof(*card->rd_pack_stats.packing_events));
+	memset(&card->rd_pack_stats.pack_stop_reason, 0,
+		sizeof(card->rd_pack_stats.pack_stop_reason));
+	card->rd_pack_stats.enabled = true;
+	spin_unlock(&card->rd_pack_stats.lock);
+}
+EXPORT_SYMBOL(mmc_blk_init_rd_packed_statistics);
+
 static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 {
 	struct request_queue *q = mq->queue;
@@ -1834,12 +1866,17 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 			!card->ext_csd.packed_event_en)
 		goto no_packed;
 
-	if (!mq->wr_packing_enabled)
-		goto no_packed;
+	if (rq_data_dir(cur) == READ) {
+		if (card->host->caps2 & MMC_CAP2_PACKED_RD)
+			max_packed_rw = card->ext_csd.max_packed_reads;
+		stats = &card->rd_pack_stats;
+	} else {
+		if (!mq->wr_packing_enabled)
+			goto no_packed;
 
-	if ((rq_data_dir(cur) == WRITE) &&
-			(card->host->caps2 & MMC_CAP2_PACKED_WR))
-		max_packed_rw = card->ext_csd.max_packed_writes;
+		if (card->host->caps2 & MMC_CAP2_PACKED_WR)
+			max_packed_rw = card->ext_csd.max_packed_writes;
+	}
 
 	if (max_packed_rw == 0)
 		goto no_packed;
@@ -1930,7 +1967,7 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 			break;
 		}
 
-		if (mq->no_pack_for_random) {
+		if (mq->no_pack_for_random && rq_data_dir(next) == WRITE) {
 			if ((blk_rq_pos(cur) + blk_rq_sectors(cur)) !=
 			    blk_rq_pos(next)) {
 				MMC_BLK_UPDATE_STOP_REASON(stats, RANDOM);
@@ -1957,7 +1994,7 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 	}
 
 	if (stats->enabled) {
-		if (reqs + 1 <= card->ext_csd.max_packed_writes)
+		if (reqs + 1 <= max_packed_rw)
 			stats->packing_events[reqs + 1]++;
 		if (reqs + 1 == max_packed_rw)
 			MMC_BLK_UPDATE_STOP_REASON(stats, THRESHOLD);
@@ -1987,15 +2024,17 @@ static void mmc_blk_packed_hdr_wrq_prep(struct mmc_queue_req *mqrq,
 	struct mmc_blk_data *md = mq->data;
 	bool do_rel_wr, do_data_tag;
 	u32 *packed_cmd_hdr = mqrq->packed_cmd_hdr;
+	bool is_read = rq_data_dir(req) == READ;
 	u8 i = 1;
 
-	mqrq->packed_cmd = MMC_PACKED_WRITE;
+	mqrq->packed_cmd = is_read ? MMC_PACKED_WR_HDR : MMC_PACKED_WRITE;
 	mqrq->packed_blocks = 0;
 	mqrq->packed_fail_idx = MMC_PACKED_N_IDX;
 
 	memset(packed_cmd_hdr, 0, sizeof(mqrq->packed_cmd_hdr));
 	packed_cmd_hdr[0] = (mqrq->packed_num << 16) |
-		(PACKED_CMD_WR << 8) | PACKED_CMD_VER;
+		((is_read ? PACKED_CMD_RD : PACKED_CMD_WR) << 8) |
+		PACKED_CMD_VER;
 
 	list_for_each_entry(prq, &mqrq->packed_list, queuelist) {
 		do_rel_wr = mmc_req_rel_wr(prq) && (md->flags & MMC_BLK_REL_WR);
@@ -2023,8 +2062,10 @@ static void mmc_blk_packed_hdr_wrq_prep(struct mmc_queue_req *mqrq,
 	brq->mrq.sbc = &brq->sbc;
 	brq->mrq.stop = &brq->stop;
 
+	/* a packed read writes only the header block here */
 	brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
-	brq->sbc.arg = MMC_CMD23_ARG_PACKED | (mqrq->packed_blocks + 1);
+	brq->sbc.arg = MMC_CMD23_ARG_PACKED |
+		(is_read ? 1 : mqrq->packed_blocks + 1);
 	brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
 
 	brq->cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
@@ -2034,7 +2075,7 @@ static void mmc_blk_packed_hdr_wrq_prep(struct mmc_queue_req *mqrq,
 	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
 
 	brq->data.blksz = 512;
-	brq->data.blocks = mqrq->packed_blocks + 1;
+	brq->data.blocks = is_read ? 1 : mqrq->packed_blocks + 1;
 	brq->data.flags |= MMC_DATA_WRITE;
 	brq->data.fault_injected = false;
 
@@ -2066,6 +2107,54 @@ static void mmc_blk_packed_hdr_wrq_prep(struct mmc_queue_req *mqrq,
 	mmc_queue_bounce_pre(mqrq);
 }
 
+static void mmc_blk_packed_rrq_prep(struct mmc_queue_req *mqrq,
+				    struct mmc_card *card,
+				    struct mmc_queue *mq)
+{
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct request *req = mqrq->req;
+
+	mqrq->packed_cmd = MMC_PACKED_READ;
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+	brq->mrq.sbc = &brq->sbc;
+	brq->mrq.stop = &brq->stop;
+
+	brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+	brq->sbc.arg = mqrq->packed_blocks;
+	brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+
+	brq->cmd.opcode = MMC_READ_MULTIPLE_BLOCK;
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	brq->data.blksz = 512;
+	brq->data.blocks = mqrq->packed_blocks;
+	brq->data.flags |= MMC_DATA_READ;
+	brq->data.fault_injected = false;
+
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
+
+	mqrq->mmc_active.mrq = &brq->mrq;
+	mqrq->mmc_active.cmd_flags = req->cmd_flags;
+
+	if (mq->err_check_fn)
+		mqrq->mmc_active.err_check = mq->err_check_fn;
+	else
+		mqrq->mmc_active.err_check = mmc_blk_packed_err_check;
+}
+
 static int mmc_blk_cmd_err(struct mmc_blk_data *md, struct mmc_card *card,
 			   struct mmc_blk_request *brq, struct request *req,
 			   int ret)
@@ -2160,6 +2249,60 @@ static void mmc_blk_revert_packed_req(struct mmc_queue *mq,
 	mmc_blk_clear_packed(mq_rq);
 }
 
+static void mmc_blk_packed_rd_xfer(struct mmc_queue *mq,
+				   struct mmc_queue_req *mq_rq)
+{
+	if (mq->packed_rd_sim_fn)
+		mq->packed_rd_sim_fn(mq, mq_rq);
+	else
+		mmc_wait_for_req(mq->card->host, &mq_rq->brq.mrq);
+}
+
+/*
+ * A packed read is two transfers: the header is written first and the
+ * data of all packed requests is then read back in one go.  It is issued
+ * synchronously, like a flush.  Returns 0 when every request of the pack
+ * has completed, or 1 when the remaining requests have been put back and
+ * mq_rq->req is to be issued on its own.
+ */
+static int mmc_blk_issue_packed_rd(struct mmc_queue *mq,
+				   struct mmc_queue_req *mq_rq)
+{
+	struct mmc_card *card = mq->card;
+	int status;
+
+	mmc_blk_packed_hdr_wrq_prep(mq_rq, card, mq);
+	mmc_blk_packed_rd_xfer(mq, mq_rq);
+	status = mq_rq->mmc_active.err_check(card, &mq_rq->mmc_active);
+	if (status != MMC_BLK_SUCCESS) {
+		mq_rq->packed_fail_idx = MMC_PACKED_N_ZERO;
+		goto fallback;
+	}
+
+	mmc_blk_packed_rrq_prep(mq_rq, card, mq);
+	mmc_blk_packed_rd_xfer(mq, mq_rq);
+	mmc_queue_bounce_post(mq_rq);
+	status = mq_rq->mmc_active.err_check(card, &mq_rq->mmc_active);
+	if (status == MMC_BLK_SUCCESS) {
+		mmc_blk_end_packed_req(mq_rq);
+		return 0;
+	}
+
+	if (status != MMC_BLK_PARTIAL ||
+	    mq_rq->packed_fail_idx == MMC_PACKED_N_IDX)
+		mq_rq->packed_fail_idx = MMC_PACKED_N_ZERO;
+
+fallback:
+	pr_debug("%s: packed read failed (%d), fail idx %d\n",
+		 mq_rq->req->rq_disk->disk_name, status,
+		 mq_rq->packed_fail_idx);
+	if (mmc_blk_end_packed_req(mq_rq)) {
+		mmc_blk_revert_packed_req(mq, mq_rq);
+		return 1;
+	}
+	return 0;
+}
+
 static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 {
 	struct mmc_blk_data *md = mq->data;
@@ -2181,6 +2324,14 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 		if ((card->ext_csd.bkops_en) && (rq_data_dir(rqc) == WRITE))
 			card->bkops_info.sectors_changed += blk_rq_sectors(rqc);
 		reqs = mmc_blk_prep_packed_list(mq, rqc);
+		if (reqs >= packed_num && rq_data_dir(rqc) == READ) {
+			if (card->host->areq)
+				mmc_blk_issue_rw_rq(mq, NULL);
+			if (!mmc_blk_issue_packed_rd(mq, mq->mqrq_cur))
+				return 1;
+			rqc = mq->mqrq_cur->req;
+			reqs = 0;
+		}
 	}
 
 	do {
@@ -59,6 +59,7 @@
 #define SANITIZE_TEST_TIMEOUT 240000
 #define NEW_REQ_TEST_SLEEP_TIME 1
 #define NEW_REQ_TEST_NUM_BIOS 64
+#define SIM_MAX_PACKED_READS 16
 #define TEST_REQUEST_NUM_OF_BIOS	3
 
 #define CHECK_BKOPS_STATS(stats, exp_bkops, exp_hpi, exp_suspend)	\
@@ -144,6 +145,12 @@ enum mmc_block_test_testcases {
 	TEST_LONG_SEQUENTIAL_WRITE,
 
 	TEST_NEW_REQ_NOTIFICATION,
+
+	SEND_READ_PACKING_MIN_TESTCASE,
+	TEST_PACKED_READ = SEND_READ_PACKING_MIN_TESTCASE,
+	TEST_PACKED_READ_HDR_ERR,
+	TEST_PACKED_READ_PARTIAL,
+	SEND_READ_PACKING_MAX_TESTCASE = TEST_PACKED_READ_PARTIAL,
 };
 
 enum mmc_block_test_group {
@@ -155,6 +162,7 @@ enum mmc_block_test_group {
 	TEST_PACKING_CONTROL_GROUP,
 	TEST_BKOPS_GROUP,
 	TEST_NEW_NOTIFICATION_GROUP,
+	TEST_SEND_READ_PACKING_GROUP,
 };
 
 enum bkops_test_stages {
@@ -175,6 +183,7 @@ struct mmc_block_test_debug {
 	struct dentry *long_sequential_read_test;
 	struct dentry *long_sequential_write_test;
 	struct dentry *new_req_notification_test;
+	struct dentry *send_read_packing_test;
 };
 
 struct mmc_block_test_data {
@@ -204,6 +213,12 @@ struct mmc_block_test_data {
 	wait_queue_head_t bkops_wait_q;
 	
 	unsigned int completed_req_count;
+
+	/* card and host state replaced while simulating packed reads */
+	unsigned int saved_caps2;
+	u8 saved_max_packed_reads;
+	u8 saved_packed_event_en;
+	u32 *sim_rd_packing_events;
 };
 
 static struct mmc_block_test_data *mbtd;
@@ -476,6 +491,22 @@ static int test_err_check(struct mmc_card *card, struct mmc_async_req *areq)
 		}
 		mq->err_check_fn = NULL;
 		break;
+	case TEST_PACKED_READ_HDR_ERR:
+		test_pr_info("%s: fail the packed read header", __func__);
+		mq->err_check_fn = NULL;
+		ret = MMC_BLK_ABORT;
+		break;
+	case TEST_PACKED_READ_PARTIAL:
+		if (mq_rq->packed_cmd == MMC_PACKED_WR_HDR)
+			break;
+		test_pr_info("%s: return partial for the packed read",
+			     __func__);
+		mq_rq->packed_fail_idx = (mbtd->num_requests / 2);
+		test_pr_info("%s: packed_fail_idx = %d"
+			, __func__, mq_rq->packed_fail_idx);
+		mq->err_check_fn = NULL;
+		ret = MMC_BLK_PARTIAL;
+		break;
 	default:
 		test_pr_err("%s: unexpected testcase %d",
 			__func__, mbtd->test_info.testcase);
@@ -590,6 +621,12 @@ switch (td->test_info.testcase) {
 		return "\"long sequential write\"";
 	case TEST_NEW_REQ_NOTIFICATION:
 		return "\"new request notification test\"";
+	case TEST_PACKED_READ:
+		return "\"packed read\"";
+	case TEST_PACKED_READ_HDR_ERR:
+		return "\"packed read - header error\"";
+	case TEST_PACKED_READ_PARTIAL:
+		return "\"packed read - return partial\"";
 	default:
 		return " Unknown testcase";
 	}
@@ -734,6 +771,60 @@ cancel_round:
 	return 0;
 }
 
+static int check_rd_packing_statistics(struct test_data *td)
+{
+	struct mmc_queue *mq = td->req_q->queuedata;
+	struct mmc_card *card = mq->card;
+	struct mmc_wr_pack_stats *stats;
+	struct mmc_wr_pack_stats *expected_stats = &mbtd->exp_packed_stats;
+	int max_packed_reqs = card->ext_csd.max_packed_reads;
+	int i;
+	int ret = 0;
+
+	stats = mmc_blk_get_rd_packed_statistics(card);
+	if (!stats || !stats->packing_events) {
+		test_pr_err("%s: NULL read packing statistics", __func__);
+		return -EINVAL;
+	}
+
+	spin_lock(&stats->lock);
+
+	if (!stats->enabled) {
+		test_pr_err("%s read packing statistics are not enabled",
+			     __func__);
+		ret = -EINVAL;
+		goto exit;
+	}
+
+	for (i = 1; i <= max_packed_reqs; ++i) {
+		if (stats->packing_events[i] !=
+		    expected_stats->packing_events[i]) {
+			test_pr_err(
+			"%s: Wrong pack stats in index %d, got %d, expected %d",
+			__func__, i, stats->packing_events[i],
+			       expected_stats->packing_events[i]);
+			ret = -EINVAL;
+			goto exit;
+		}
+	}
+
+	for (i = 0; i < MAX_REASONS; ++i) {
+		if (stats->pack_stop_reason[i] !=
+		    expected_stats->pack_stop_reason[i]) {
+			test_pr_err(
+			"%s: Wrong pack stop reason %d, got %d, expected %d",
+			__func__, i, stats->pack_stop_reason[i],
+			       expected_stats->pack_stop_reason[i]);
+			ret = -EINVAL;
+			goto exit;
+		}
+	}
+
+exit:
+	spin_unlock(&stats->lock);
+	return ret;
+}
+
 static unsigned int pseudo_random_seed(unsigned int *seed_number,
 				       unsigned int min_val,
 				       unsigned int max_val)
@@ -934,6 +1025,128 @@ static int prepare_packed_requests(struct test_data *td, int is_err_expected,
 	return 0;
 }
 
+/*
+ * Stand-in for the host during packed read tests: complete both the
+ * header write and the data read without sending anything to the card,
+ * so the packing and error handling paths can be tested on any eMMC.
+ */
+static void test_packed_rd_sim(struct mmc_queue *mq,
+			       struct mmc_queue_req *mq_rq)
+{
+	struct mmc_blk_request *brq = &mq_rq->brq;
+
+	brq->sbc.error = 0;
+	brq->cmd.error = 0;
+	brq->cmd.resp[0] = 0;
+	brq->stop.error = 0;
+	brq->data.error = 0;
+	brq->data.bytes_xfered = brq->data.blksz * brq->data.blocks;
+}
+
+static int test_packed_rd_sim_start(struct mmc_card *card)
+{
+	struct mmc_wr_pack_stats *stats = &card->rd_pack_stats;
+	u8 max_packed_reads = card->ext_csd.max_packed_reads;
+	u32 *events = NULL;
+
+	if (!max_packed_reads)
+		max_packed_reads = SIM_MAX_PACKED_READS;
+
+	if (!stats->packing_events) {
+		events = kzalloc((max_packed_reads + 1) * sizeof(*events),
+				 GFP_KERNEL);
+		if (!events)
+			return -ENOMEM;
+	}
+
+	mbtd->saved_caps2 = card->host->caps2;
+	mbtd->saved_max_packed_reads = card->ext_csd.max_packed_reads;
+	mbtd->saved_packed_event_en = card->ext_csd.packed_event_en;
+	mbtd->sim_rd_packing_events = events;
+
+	mmc_claim_host(card->host);
+	card->host->caps2 |= MMC_CAP2_PACKED_RD;
+	card->ext_csd.max_packed_reads = max_packed_reads;
+	card->ext_csd.packed_event_en = 1;
+	if (events) {
+		spin_lock(&stats->lock);
+		stats->packing_events = events;
+		spin_unlock(&stats->lock);
+	}
+	mmc_release_host(card->host);
+
+	return 0;
+}
+
+static void test_packed_rd_sim_stop(struct mmc_card *card)
+{
+	struct mmc_wr_pack_stats *stats = &card->rd_pack_stats;
+
+	mmc_claim_host(card->host);
+	card->host->caps2 = mbtd->saved_caps2;
+	card->ext_csd.max_packed_reads = mbtd->saved_max_packed_reads;
+	card->ext_csd.packed_event_en = mbtd->saved_packed_event_en;
+	if (mbtd->sim_rd_packing_events) {
+		spin_lock(&stats->lock);
+		stats->packing_events = NULL;
+		stats->enabled = false;
+		spin_unlock(&stats->lock);
+	}
+	mmc_release_host(card->host);
+
+	kfree(mbtd->sim_rd_packing_events);
+	mbtd->sim_rd_packing_events = NULL;
+}
+
+static int prepare_packed_read_requests(struct test_data *td,
+					int num_requests)
+{
+	struct mmc_queue *mq = td->req_q->queuedata;
+	int max_packed_reqs = mq->card->ext_csd.max_packed_reads;
+	unsigned int start_sec = td->start_sector;
+	int rest = 0;
+	int ret;
+	int i;
+
+	test_pr_info("%s: Adding %d read requests, first req_id=%d", __func__,
+		     num_requests, td->wr_rd_next_req_id);
+
+	for (i = 0; i < num_requests; i++) {
+		ret = test_iosched_add_wr_rd_test_req(0, READ, start_sec, 1,
+						      TEST_NO_PATTERN, NULL);
+		if (ret) {
+			test_pr_err("%s: failed to add a read request",
+				    __func__);
+			return ret;
+		}
+		start_sec += NUM_OF_SECTORS_PER_BIO;
+	}
+
+	memset((void *)mbtd->exp_packed_stats.pack_stop_reason, 0,
+		sizeof(mbtd->exp_packed_stats.pack_stop_reason));
+	memset(mbtd->exp_packed_stats.packing_events, 0,
+		(max_packed_reqs + 1) * sizeof(u32));
+	mbtd->exp_packed_stats.packing_events[num_requests] = 1;
+	mbtd->exp_packed_stats.pack_stop_reason[EMPTY_QUEUE] = 1;
+
+	/*
+	 * The failed request is reissued on its own and the ones after it
+	 * are put back, so they are packed again.
+	 */
+	if (td->test_info.testcase == TEST_PACKED_READ_HDR_ERR)
+		rest = num_requests - 1;
+	else if (td->test_info.testcase == TEST_PACKED_READ_PARTIAL)
+		rest = num_requests - (num_requests / 2) - 1;
+
+	if (rest > 0) {
+		mbtd->exp_packed_stats.packing_events[rest]++;
+		mbtd->exp_packed_stats.pack_stop_reason[EMPTY_QUEUE]++;
+	}
+	mbtd->num_requests = num_requests;
+
+	return 0;
+}
+
 static int prepare_packed_control_tests_requests(struct test_data *td,
 			int is_err_expected, int num_requests, int is_random)
 {
@@ -1177,6 +1390,8 @@ static int get_num_requests(struct test_data *td)
 	}
 
 	max_num_requests = mq->card->ext_csd.max_packed_writes;
+	if (mbtd->test_group == TEST_SEND_READ_PACKING_GROUP)
+		max_num_requests = mq->card->ext_csd.max_packed_reads;
 	num_requests = max_num_requests - 2;
 	test_packed_trigger = mq->num_wr_reqs_to_start_packing;
 
@@ -1286,6 +1501,12 @@ static int prepare_test(struct test_data *td)
 	if (mbtd->test_group == TEST_ERR_CHECK_GROUP)
 		mq->err_check_fn = test_err_check;
 
+	if (mbtd->test_group == TEST_SEND_READ_PACKING_GROUP) {
+		mq->packed_rd_sim_fn = test_packed_rd_sim;
+		if (td->test_info.testcase != TEST_PACKED_READ)
+			mq->err_check_fn = test_err_check;
+	}
+
 	switch (td->test_info.testcase) {
 	case TEST_STOP_DUE_TO_FLUSH:
 	case TEST_STOP_DUE_TO_READ:
@@ -1361,6 +1582,11 @@ static int prepare_test(struct test_data *td)
 	case TEST_LONG_SEQUENTIAL_READ:
 		ret = prepare_long_read_test_requests(td);
 		break;
+	case TEST_PACKED_READ:
+	case TEST_PACKED_READ_HDR_ERR:
+	case TEST_PACKED_READ_PARTIAL:
+		ret = prepare_packed_read_requests(td, num_requests);
+		break;
 	default:
 		test_pr_info("%s: Invalid test case...", __func__);
 		ret = -EINVAL;
@@ -1403,6 +1629,16 @@ static int run_packed_test(struct test_data *td)
 	return 0;
 }
 
+static int run_packed_read_test(struct test_data *td)
+{
+	struct mmc_queue *mq = td->req_q->queuedata;
+
+	mmc_blk_init_rd_packed_statistics(mq->card);
+	__blk_run_queue(td->req_q);
+
+	return 0;
+}
+
 static int post_test(struct test_data *td)
 {
 	struct mmc_queue *mq;
@@ -1419,6 +1655,7 @@ static int post_test(struct test_data *td)
 
 	mq->packed_test_fn = NULL;
 	mq->err_check_fn = NULL;
+	mq->packed_rd_sim_fn = NULL;
 
 	return 0;
 }
@@ -2881,6 +3118,119 @@ const struct file_operations new_req_notification_test_ops = {
 	.read = new_req_notification_test_read,
 };
 
+static ssize_t send_read_packing_test_write(struct file *file,
+				const char __user *buf,
+				size_t count,
+				loff_t *ppos)
+{
+	struct request_queue *req_q = test_iosched_get_req_queue();
+	struct mmc_queue *mq;
+	int ret = 0;
+	int i = 0;
+	int number = -1;
+	int j = 0;
+
+	test_pr_info("%s: -- send_read_packing TEST --", __func__);
+
+	sscanf(buf, "%d", &number);
+
+	if (number <= 0)
+		number = 1;
+
+	mbtd->test_group = TEST_SEND_READ_PACKING_GROUP;
+
+	if (!req_q || !req_q->queuedata) {
+		test_pr_err("%s: NULL request queue", __func__);
+		test_iosched_set_test_result(TEST_FAILED);
+		return count;
+	}
+	mq = req_q->queuedata;
+
+	if (!(mq->card->host->caps & MMC_CAP_CMD23)) {
+		test_pr_err("%s: packing needs CMD23, exit test", __func__);
+		test_iosched_set_test_result(TEST_NOT_SUPPORTED);
+		return count;
+	}
+
+	if (test_packed_rd_sim_start(mq->card)) {
+		test_pr_err("%s: failed to set up read packing", __func__);
+		test_iosched_set_test_result(TEST_FAILED);
+		return count;
+	}
+
+	if (mbtd->random_test_seed > 0)
+		test_pr_info("%s: Test seed: %d", __func__,
+			      mbtd->random_test_seed);
+
+	memset(&mbtd->test_info, 0, sizeof(struct test_info));
+
+	mbtd->test_info.data = mbtd;
+	mbtd->test_info.prepare_test_fn = prepare_test;
+	mbtd->test_info.run_test_fn = run_packed_read_test;
+	mbtd->test_info.check_test_result_fn = check_rd_packing_statistics;
+	mbtd->test_info.get_test_case_str_fn = get_test_case_str;
+	mbtd->test_info.post_test_fn = post_test;
+
+	for (i = 0; i < number; ++i) {
+		test_pr_info("%s: Cycle # %d / %d", __func__, i+1, number);
+		test_pr_info("%s: ====================", __func__);
+
+		for (j = SEND_READ_PACKING_MIN_TESTCASE;
+		      j <= SEND_READ_PACKING_MAX_TESTCASE; j++) {
+
+			mbtd->test_info.testcase = j;
+			mbtd->is_random = RANDOM_TEST;
+			ret = test_iosched_start_test(&mbtd->test_info);
+			if (ret)
+				break;
+			msleep(1000);
+			mbtd->test_info.testcase = j;
+			mbtd->is_random = NON_RANDOM_TEST;
+			ret = test_iosched_start_test(&mbtd->test_info);
+			if (ret)
+				break;
+			msleep(1000);
+		}
+	}
+
+	test_packed_rd_sim_stop(mq->card);
+	test_pr_info("%s: Completed all the test cases.", __func__);
+
+	return count;
+}
+
+static ssize_t send_read_packing_test_read(struct file *file,
+			       char __user *buffer,
+			       size_t count,
+			       loff_t *offset)
+{
+	memset((void *)buffer, 0, count);
+
+	snprintf(buffer, count,
+		 "\nsend_read_packing_test\n"
+		 "=========\n"
+		 "Description:\n"
+		 "This test checks the following scenarios\n"
+		 "- Pack reads until the queue is empty\n"
+		 "- Fail the packed read header, expect a fallback\n"
+		 "- Return PARTIAL for the packed read\n"
+		 "The host side of the packed transfers is simulated, so the\n"
+		 "card and host need not support packed reads.\n");
+
+	if (message_repeat == 1) {
+		message_repeat = 0;
+		return strnlen(buffer, count);
+	} else {
+		return 0;
+	}
+}
+
+const struct file_operations send_read_packing_test_ops = {
+	.open = test_open,
+	.write = send_read_packing_test_write,
+	.read = send_read_packing_test_read,
+};
+
 static void mmc_block_test_debugfs_cleanup(void)
 {
 	debugfs_remove(mbtd->debug.random_test_seed);
@@ -2893,6 +3243,7 @@ static void mmc_block_test_debugfs_cleanup(void)
 	debugfs_remove(mbtd->debug.long_sequential_read_test);
 	debugfs_remove(mbtd->debug.long_sequential_write_test);
 	debugfs_remove(mbtd->debug.new_req_notification_test);
+	debugfs_remove(mbtd->debug.send_read_packing_test);
 }
 
 static int mmc_block_test_debugfs_init(void)
@@ -3005,6 +3356,16 @@ static int mmc_block_test_debugfs_init(void)
 	if (!mbtd->debug.long_sequential_write_test)
 		goto err_nomem;
 
+	mbtd->debug.send_read_packing_test =
+		debugfs_create_file("send_read_packing_test",
+				    S_IRUGO | S_IWUGO,
+				    tests_root,
+				    NULL,
+				    &send_read_packing_test_ops);
+
+	if (!mbtd->debug.send_read_packing_test)
+		goto err_nomem;
+
 	return 0;
 
 err_nomem:
@@ -3029,7 +3390,8 @@ static void mmc_block_test_probe(void)
 		return;
 	}
 
-	max_packed_reqs = mq->card->ext_csd.max_packed_writes;
+	max_packed_reqs = max(mq->card->ext_csd.max_packed_writes,
+			      mq->card->ext_csd.max_packed_reads);
 	mbtd->exp_packed_stats.packing_events =
 			kzalloc((max_packed_reqs + 1) *
 				sizeof(*mbtd->exp_packed_stats.packing_events),
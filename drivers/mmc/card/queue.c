@@ -514,7 +514,7 @@ static unsigned int mmc_queue_packed_map_sg(struct mmc_queue *mq,
 
 	cmd = mqrq->packed_cmd;
 
-	if (cmd == MMC_PACKED_WRITE) {
+	if (cmd == MMC_PACKED_WRITE || cmd == MMC_PACKED_WR_HDR) {
 		__sg = sg;
 		sg_set_buf(__sg, mqrq->packed_cmd_hdr,
 				sizeof(mqrq->packed_cmd_hdr));
@@ -522,6 +522,12 @@ static unsigned int mmc_queue_packed_map_sg(struct mmc_queue *mq,
 		__sg->page_link &= ~0x02;
 	}
 
+	/* the header of a packed read is sent on its own */
+	if (cmd == MMC_PACKED_WR_HDR) {
+		sg_mark_end(sg);
+		return sg_len;
+	}
+
 	__sg = sg + sg_len;
 	list_for_each_entry(req, &mqrq->packed_list, queuelist) {
 		sg_len += blk_rq_map_sg(mq->queue, req, __sg);
@@ -569,7 +575,8 @@ void mmc_queue_bounce_pre(struct mmc_queue_req *mqrq)
 	if (!mqrq->bounce_buf)
 		return;
 
-	if (rq_data_dir(mqrq->req) != WRITE)
+	if (rq_data_dir(mqrq->req) != WRITE &&
+	    mqrq->packed_cmd != MMC_PACKED_WR_HDR)
 		return;
 
 	sg_copy_to_buffer(mqrq->bounce_sg, mqrq->bounce_sg_len,
@@ -581,7 +588,8 @@ void mmc_queue_bounce_post(struct mmc_queue_req *mqrq)
 	if (!mqrq->bounce_buf)
 		return;
 
-	if (rq_data_dir(mqrq->req) != READ)
+	if (rq_data_dir(mqrq->req) != READ ||
+	    mqrq->packed_cmd == MMC_PACKED_WR_HDR)
 		return;
 
 	sg_copy_from_buffer(mqrq->bounce_sg, mqrq->bounce_sg_len,
@@ -15,6 +15,8 @@ struct mmc_blk_request {
 enum mmc_packed_cmd {
 	MMC_PACKED_NONE = 0,
 	MMC_PACKED_WRITE,
+	MMC_PACKED_WR_HDR,
+	MMC_PACKED_READ,
 };
 
 struct mmc_queue_req {
@@ -55,6 +57,7 @@ struct mmc_queue {
 	bool			no_pack_for_random;
 	int (*err_check_fn) (struct mmc_card *, struct mmc_async_req *);
 	void (*packed_test_fn) (struct request_queue *, struct mmc_queue_req *);
+	void (*packed_rd_sim_fn) (struct mmc_queue *, struct mmc_queue_req *);
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
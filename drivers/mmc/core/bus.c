@@ -315,6 +315,7 @@ struct mmc_card *mmc_alloc_card(struct mmc_host *host, struct device_type *type)
 
 	spin_lock_init(&card->bkops_info.bkops_stats.lock);
 	spin_lock_init(&card->wr_pack_stats.lock);
+	spin_lock_init(&card->rd_pack_stats.lock);
 
 	return card;
 }
@@ -448,6 +449,7 @@ void mmc_remove_card(struct mmc_card *card)
 	}
 
 	kfree(card->wr_pack_stats.packing_events);
+	kfree(card->rd_pack_stats.packing_events);
 	kfree(card->cached_ext_csd);
 
 	put_device(&card->dev);
@@ -378,44 +378,36 @@ static int mmc_wr_pack_stats_open(struct inode *inode, struct file *filp)
 }
 
 #define TEMP_BUF_SIZE 256
-static ssize_t mmc_wr_pack_stats_read(struct file *filp, char __user *ubuf,
-				size_t cnt, loff_t *ppos)
+static ssize_t mmc_pack_stats_read(struct mmc_card *card,
+				   struct mmc_wr_pack_stats *pack_stats,
+				   int max_num_of_packed_reqs, const char *dir,
+				   char __user *ubuf, size_t cnt)
 {
-	struct mmc_card *card = filp->private_data;
-	struct mmc_wr_pack_stats *pack_stats;
 	int i;
-	int max_num_of_packed_reqs = 0;
 	char *temp_buf;
 
-	if (!card)
-		return cnt;
-
-	if (!card->wr_pack_stats.print_in_read)
+	if (!pack_stats->print_in_read)
 		return 0;
 
-	if (!card->wr_pack_stats.enabled) {
-		pr_info("%s: write packing statistics are disabled\n",
-			 mmc_hostname(card->host));
+	if (!pack_stats->enabled) {
+		pr_info("%s: %s packing statistics are disabled\n",
+			 mmc_hostname(card->host), dir);
 		goto exit;
 	}
 
-	pack_stats = &card->wr_pack_stats;
-
 	if (!pack_stats->packing_events) {
 		pr_info("%s: NULL packing_events\n", mmc_hostname(card->host));
 		goto exit;
 	}
 
-	max_num_of_packed_reqs = card->ext_csd.max_packed_writes;
-
 	temp_buf = kmalloc(TEMP_BUF_SIZE, GFP_KERNEL);
 	if (!temp_buf)
 		goto exit;
 
 	spin_lock(&pack_stats->lock);
 
-	snprintf(temp_buf, TEMP_BUF_SIZE, "%s: write packing statistics:\n",
-		mmc_hostname(card->host));
+	snprintf(temp_buf, TEMP_BUF_SIZE, "%s: %s packing statistics:\n",
+		mmc_hostname(card->host), dir);
 	strlcat(ubuf, temp_buf, cnt);
 
 	for (i = 1 ; i <= max_num_of_packed_reqs ; ++i) {
@@ -512,14 +504,27 @@ static ssize_t mmc_wr_pack_stats_read(struct file *filp, char __user *ubuf,
 	pr_info("%s", ubuf);
 
 exit:
-	if (card->wr_pack_stats.print_in_read == 1) {
-		card->wr_pack_stats.print_in_read = 0;
+	if (pack_stats->print_in_read == 1) {
+		pack_stats->print_in_read = 0;
 		return strnlen(ubuf, cnt);
 	}
 
 	return 0;
 }
 
+static ssize_t mmc_wr_pack_stats_read(struct file *filp, char __user *ubuf,
+				size_t cnt, loff_t *ppos)
+{
+	struct mmc_card *card = filp->private_data;
+
+	if (!card)
+		return cnt;
+
+	return mmc_pack_stats_read(card, &card->wr_pack_stats,
+				   card->ext_csd.max_packed_writes, "write",
+				   ubuf, cnt);
+}
+
 static ssize_t mmc_wr_pack_stats_write(struct file *filp,
 				       const char __user *ubuf, size_t cnt,
 				       loff_t *ppos)
@@ -548,6 +553,56 @@ static const struct file_operations mmc_dbg_wr_pack_stats_fops = {
 	.write		= mmc_wr_pack_stats_write,
 };
 
+static int mmc_rd_pack_stats_open(struct inode *inode, struct file *filp)
+{
+	struct mmc_card *card = inode->i_private;
+
+	filp->private_data = card;
+	card->rd_pack_stats.print_in_read = 1;
+	return 0;
+}
+
+static ssize_t mmc_rd_pack_stats_read(struct file *filp, char __user *ubuf,
+				size_t cnt, loff_t *ppos)
+{
+	struct mmc_card *card = filp->private_data;
+
+	if (!card)
+		return cnt;
+
+	return mmc_pack_stats_read(card, &card->rd_pack_stats,
+				   card->ext_csd.max_packed_reads, "read",
+				   ubuf, cnt);
+}
+
+static ssize_t mmc_rd_pack_stats_write(struct file *filp,
+				       const char __user *ubuf, size_t cnt,
+				       loff_t *ppos)
+{
+	struct mmc_card *card = filp->private_data;
+	int value;
+
+	if (!card)
+		return cnt;
+
+	sscanf(ubuf, "%d", &value);
+	if (value) {
+		mmc_blk_init_rd_packed_statistics(card);
+	} else {
+		spin_lock(&card->rd_pack_stats.lock);
+		card->rd_pack_stats.enabled = false;
+		spin_unlock(&card->rd_pack_stats.lock);
+	}
+
+	return cnt;
+}
+
+static const struct file_operations mmc_dbg_rd_pack_stats_fops = {
+	.open		= mmc_rd_pack_stats_open,
+	.read		= mmc_rd_pack_stats_read,
+	.write		= mmc_rd_pack_stats_write,
+};
+
 static int mmc_bkops_stats_open(struct inode *inode, struct file *filp)
 {
 	struct mmc_card *card = inode->i_private;
@@ -694,6 +749,12 @@ void mmc_add_card_debugfs(struct mmc_card *card)
 					 &mmc_dbg_wr_pack_stats_fops))
 			goto err;
 
+	if (mmc_card_mmc(card) && (card->ext_csd.rev >= 6) &&
+	    (card->host->caps2 & MMC_CAP2_PACKED_RD))
+		if (!debugfs_create_file("rd_pack_stats", S_IRUSR, root, card,
+					 &mmc_dbg_rd_pack_stats_fops))
+			goto err;
+
 	if (mmc_card_mmc(card) && (card->ext_csd.rev >= 5) &&
 	    card->ext_csd.bkops_en)
 		if (!debugfs_create_file("bkops_stats", S_IRUSR, root, card,
@@ -1396,6 +1396,16 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 				goto free_card;
 		}
 
+		if ((host->caps2 & MMC_CAP2_PACKED_RD) &&
+		    (card->ext_csd.max_packed_reads > 0)) {
+			card->rd_pack_stats.packing_events = kzalloc(
+				(card->ext_csd.max_packed_reads + 1) *
+				sizeof(*card->rd_pack_stats.packing_events),
+				GFP_KERNEL);
+			if (!card->rd_pack_stats.packing_events)
+				goto free_card;
+		}
+
 		if (card->ext_csd.bkops_en) {
 			INIT_DELAYED_WORK(&card->bkops_info.dw,
 					  mmc_start_idle_time_bkops);
@@ -27,6 +27,8 @@
 #include <linux/personality.h>
 #include <linux/bitops.h>
 #include <linux/mutex.h>
+#include <linux/rbtree.h>
+#include <linux/spinlock.h>
 #include <linux/shmem_fs.h>
 #include <linux/ashmem.h>
 #include <asm/cacheflush.h>
@@ -37,7 +39,8 @@
 
 struct ashmem_area {
 	char name[ASHMEM_FULL_NAME_LEN]; 
-	struct list_head unpinned_list;	 
+	struct mutex mutex;		 
+	struct rb_root unpinned_root;	 
 	struct file *file;		 
 	size_t size;			 
 	unsigned long vm_start;		 
@@ -46,7 +49,7 @@ struct ashmem_area {
 
 struct ashmem_range {
 	struct list_head lru;		
-	struct list_head unpinned;	
+	struct rb_node node;		
 	struct ashmem_area *asma;	
 	size_t pgstart;			
 	size_t pgend;			
@@ -54,10 +57,11 @@ struct ashmem_range {
 };
 
 static LIST_HEAD(ashmem_lru_list);
+static DEFINE_SPINLOCK(ashmem_lru_lock);
 
-static unsigned long lru_count;
+static atomic_long_t lru_count = ATOMIC_LONG_INIT(0);
 
-static DEFINE_MUTEX(ashmem_mutex);
+#define ASHMEM_SHRINK_BUSY_MAX	16
 
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
@@ -88,18 +92,67 @@ static struct kmem_cache *ashmem_range_cachep __read_mostly;
 
 static inline void lru_add(struct ashmem_range *range)
 {
+	spin_lock(&ashmem_lru_lock);
 	list_add_tail(&range->lru, &ashmem_lru_list);
-	lru_count += range_size(range);
+	spin_unlock(&ashmem_lru_lock);
+	atomic_long_add(range_size(range), &lru_count);
 }
 
 static inline void lru_del(struct ashmem_range *range)
 {
+	spin_lock(&ashmem_lru_lock);
 	list_del(&range->lru);
-	lru_count -= range_size(range);
+	spin_unlock(&ashmem_lru_lock);
+	atomic_long_sub(range_size(range), &lru_count);
 }
 
-static int range_alloc(struct ashmem_area *asma,
-		       struct ashmem_range *prev_range, unsigned int purged,
+static struct ashmem_range *range_first_overlap(struct ashmem_area *asma,
+						size_t pgstart, size_t pgend)
+{
+	struct rb_node *n = asma->unpinned_root.rb_node;
+	struct ashmem_range *range, *found = NULL;
+
+	while (n) {
+		range = rb_entry(n, struct ashmem_range, node);
+		if (range_before_page(range, pgstart)) {
+			n = n->rb_right;
+		} else {
+			found = range;
+			n = n->rb_left;
+		}
+	}
+
+	if (found && found->pgstart > pgend)
+		return NULL;
+	return found;
+}
+
+static inline struct ashmem_range *range_next(struct ashmem_range *range)
+{
+	struct rb_node *n = rb_next(&range->node);
+
+	return n ? rb_entry(n, struct ashmem_range, node) : NULL;
+}
+
+static void range_insert(struct ashmem_area *asma, struct ashmem_range *range)
+{
+	struct rb_node **p = &asma->unpinned_root.rb_node;
+	struct rb_node *parent = NULL;
+	struct ashmem_range *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct ashmem_range, node);
+		if (range->pgstart < entry->pgstart)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&range->node, parent, p);
+	rb_insert_color(&range->node, &asma->unpinned_root);
+}
+
+static int range_alloc(struct ashmem_area *asma, unsigned int purged,
 		       size_t start, size_t end)
 {
 	struct ashmem_range *range;
@@ -117,7 +170,7 @@ static int range_alloc(struct ashmem_area *asma,
 	range->pgend = end;
 	range->purged = purged;
 
-	list_add_tail(&range->unpinned, &prev_range->unpinned);
+	range_insert(asma, range);
 
 	if (range_on_lru(range))
 		lru_add(range);
@@ -127,7 +180,7 @@ static int range_alloc(struct ashmem_area *asma,
 
 static void range_del(struct ashmem_range *range)
 {
-	list_del(&range->unpinned);
+	rb_erase(&range->node, &range->asma->unpinned_root);
 	if (range_on_lru(range))
 		lru_del(range);
 	kmem_cache_free(ashmem_range_cachep, range);
@@ -142,7 +195,7 @@ static inline void range_shrink(struct ashmem_range *range,
 	range->pgend = end;
 
 	if (range_on_lru(range))
-		lru_count -= pre - range_size(range);
+		atomic_long_sub(pre - range_size(range), &lru_count);
 }
 
 static int ashmem_open(struct inode *inode, struct file *file)
@@ -162,7 +215,8 @@ static int ashmem_open(struct inode *inode, struct file *file)
 		return -ENOMEM;
 	}
 
-	INIT_LIST_HEAD(&asma->unpinned_list);
+	mutex_init(&asma->mutex);
+	asma->unpinned_root = RB_ROOT;
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -173,12 +227,12 @@ static int ashmem_open(struct inode *inode, struct file *file)
 static int ashmem_release(struct inode *ignored, struct file *file)
 {
 	struct ashmem_area *asma = file->private_data;
-	struct ashmem_range *range, *next;
+	struct rb_node *n;
 
-	mutex_lock(&ashmem_mutex);
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
-		range_del(range);
-	mutex_unlock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
+	while ((n = rb_first(&asma->unpinned_root)))
+		range_del(rb_entry(n, struct ashmem_range, node));
+	mutex_unlock(&asma->mutex);
 
 	if (asma->file)
 		fput(asma->file);
@@ -193,7 +247,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	
 	if (asma->size == 0)
@@ -212,7 +266,7 @@ static ssize_t ashmem_read(struct file *file, char __user *buf,
 	asma->file->f_pos = *pos;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -221,7 +275,7 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	struct ashmem_area *asma = file->private_data;
 	int ret;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	if (asma->size == 0) {
 		ret = -EINVAL;
@@ -241,7 +295,7 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	file->f_pos = asma->file->f_pos;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -257,7 +311,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	
 	if (unlikely(!asma->size)) {
@@ -301,41 +355,76 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	asma->vm_start = vma->vm_start;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
+static size_t ashmem_purge_range(struct ashmem_range *range)
+{
+	struct inode *inode = range->asma->file->f_dentry->d_inode;
+	loff_t start = range->pgstart * PAGE_SIZE;
+	loff_t end = (range->pgend + 1) * PAGE_SIZE - 1;
+
+	vmtruncate_range(inode, start, end);
+	range->purged = ASHMEM_WAS_PURGED;
+	lru_del(range);
+
+	return range_size(range);
+}
+
+static long ashmem_purge_area(struct ashmem_area *asma,
+			      struct ashmem_range *first, long nr_to_scan)
+{
+	struct ashmem_range *range;
+	struct rb_node *n;
+	long purged;
+
+	purged = ashmem_purge_range(first);
+	for (n = rb_first(&asma->unpinned_root); n && purged < nr_to_scan;
+	     n = rb_next(n)) {
+		range = rb_entry(n, struct ashmem_range, node);
+		if (range_on_lru(range))
+			purged += ashmem_purge_range(range);
+	}
+
+	return purged;
+}
+
 static int ashmem_shrink(struct shrinker *s, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
+	struct ashmem_area *asma;
+	long nr_to_scan = sc->nr_to_scan;
+	int busy = 0;
 
 	
 	if (sc->nr_to_scan && !(sc->gfp_mask & __GFP_FS))
 		return -1;
 	if (!sc->nr_to_scan)
-		return lru_count;
-
-	
-	if (!mutex_trylock(&ashmem_mutex)) {
-		return -1;
-	}
-
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		struct inode *inode = range->asma->file->f_dentry->d_inode;
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE - 1;
+		return atomic_long_read(&lru_count);
+
+	spin_lock(&ashmem_lru_lock);
+	while (nr_to_scan > 0 && !list_empty(&ashmem_lru_list)) {
+		range = list_first_entry(&ashmem_lru_list,
+					 struct ashmem_range, lru);
+		asma = range->asma;
+
+		if (!mutex_trylock(&asma->mutex)) {
+			list_move_tail(&range->lru, &ashmem_lru_list);
+			if (++busy > ASHMEM_SHRINK_BUSY_MAX)
+				break;
+			continue;
+		}
+		spin_unlock(&ashmem_lru_lock);
 
-		vmtruncate_range(inode, start, end);
-		range->purged = ASHMEM_WAS_PURGED;
-		lru_del(range);
+		nr_to_scan -= ashmem_purge_area(asma, range, nr_to_scan);
+		mutex_unlock(&asma->mutex);
 
-		sc->nr_to_scan -= range_size(range);
-		if (sc->nr_to_scan <= 0)
-			break;
+		spin_lock(&ashmem_lru_lock);
 	}
-	mutex_unlock(&ashmem_mutex);
+	spin_unlock(&ashmem_lru_lock);
 
-	return lru_count;
+	return atomic_long_read(&lru_count);
 }
 
 static struct shrinker ashmem_shrinker = {
@@ -347,7 +436,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	
 	if (unlikely((asma->prot_mask & prot) != prot)) {
@@ -362,7 +451,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 	asma->prot_mask = prot;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 	return ret;
 }
 
@@ -370,7 +459,7 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	
 	if (unlikely(asma->file)) {
@@ -384,7 +473,7 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 	asma->name[ASHMEM_FULL_NAME_LEN-1] = '\0';
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	return ret;
 }
@@ -393,7 +482,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 	if (asma->name[ASHMEM_NAME_PREFIX_LEN] != '\0') {
 		size_t len;
 
@@ -406,7 +495,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 					  sizeof(ASHMEM_NAME_DEF))))
 			ret = -EFAULT;
 	}
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	return ret;
 }
@@ -416,37 +505,24 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 	struct ashmem_range *range, *next;
 	int ret = ASHMEM_NOT_PURGED;
 
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		
-		if (range_before_page(range, pgstart))
-			break;
-
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret |= range->purged;
-
-			
-			if (page_range_subsumes_range(range, pgstart, pgend)) {
-				range_del(range);
-				continue;
-			}
+	range = range_first_overlap(asma, pgstart, pgend);
+	while (range && range->pgstart <= pgend) {
+		next = range_next(range);
+		ret |= range->purged;
 
-			
-			if (range->pgstart >= pgstart) {
-				range_shrink(range, pgend + 1, range->pgend);
-				continue;
-			}
-
-			
-			if (range->pgend <= pgend) {
-				range_shrink(range, range->pgstart, pgstart-1);
-				continue;
-			}
-
-			range_alloc(asma, range, range->purged,
+		if (page_range_subsumes_range(range, pgstart, pgend)) {
+			range_del(range);
+		} else if (range->pgstart >= pgstart) {
+			range_shrink(range, pgend + 1, range->pgend);
+		} else if (range->pgend <= pgend) {
+			range_shrink(range, range->pgstart, pgstart - 1);
+		} else {
+			range_alloc(asma, range->purged,
 				    pgend + 1, range->pgend);
 			range_shrink(range, range->pgstart, pgstart - 1);
 			break;
 		}
+		range = next;
 	}
 
 	return ret;
@@ -457,42 +533,29 @@ static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 	struct ashmem_range *range, *next;
 	unsigned int purged = ASHMEM_NOT_PURGED;
 
-restart:
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		
-		if (range_before_page(range, pgstart))
-			break;
+	range = range_first_overlap(asma, pgstart, pgend);
+	while (range && range->pgstart <= pgend) {
+		next = range_next(range);
 
 		if (page_range_subsumed_by_range(range, pgstart, pgend))
 			return 0;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			pgstart = min_t(size_t, range->pgstart, pgstart),
-			pgend = max_t(size_t, range->pgend, pgend);
-			purged |= range->purged;
-			range_del(range);
-			goto restart;
-		}
+
+		pgstart = min_t(size_t, range->pgstart, pgstart);
+		pgend = max_t(size_t, range->pgend, pgend);
+		purged |= range->purged;
+		range_del(range);
+		range = next;
 	}
 
-	return range_alloc(asma, range, purged, pgstart, pgend);
+	return range_alloc(asma, purged, pgstart, pgend);
 }
 
 static int ashmem_get_pin_status(struct ashmem_area *asma, size_t pgstart,
 				 size_t pgend)
 {
-	struct ashmem_range *range;
-	int ret = ASHMEM_IS_PINNED;
-
-	list_for_each_entry(range, &asma->unpinned_list, unpinned) {
-		if (range_before_page(range, pgstart))
-			break;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret = ASHMEM_IS_UNPINNED;
-			break;
-		}
-	}
-
-	return ret;
+	if (range_first_overlap(asma, pgstart, pgend))
+		return ASHMEM_IS_UNPINNED;
+	return ASHMEM_IS_PINNED;
 }
 
 static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
@@ -524,7 +587,7 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 	pgstart = pin.offset / PAGE_SIZE;
 	pgend = pgstart + (pin.len / PAGE_SIZE) - 1;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->mutex);
 
 	switch (cmd) {
 	case ASHMEM_PIN:
@@ -538,7 +601,7 @@ static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
 		break;
 	}
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->mutex);
 
 	return ret;
 }
@@ -649,10 +712,12 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		break;
 	case ASHMEM_SET_SIZE:
 		ret = -EINVAL;
+		mutex_lock(&asma->mutex);
 		if (!asma->file) {
 			ret = 0;
 			asma->size = (size_t) arg;
 		}
+		mutex_unlock(&asma->mutex);
 		break;
 	case ASHMEM_GET_SIZE:
 		ret = asma->size;
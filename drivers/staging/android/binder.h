@@ -37,6 +37,7 @@ enum {
 enum {
 	FLAT_BINDER_FLAG_PRIORITY_MASK = 0xff,
 	FLAT_BINDER_FLAG_ACCEPTS_FDS = 0x100,
+	FLAT_BINDER_FLAG_INHERIT_RT = 0x800,
 };
 
 struct flat_binder_object {
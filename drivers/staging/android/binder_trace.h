@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2012 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM binder
+
+#if !defined(_BINDER_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _BINDER_TRACE_H
+
+#include <linux/tracepoint.h>
+
+struct binder_buffer;
+struct binder_node;
+struct binder_proc;
+struct binder_thread;
+struct binder_transaction;
+
+TRACE_EVENT(binder_lock_wait,
+	TP_PROTO(int class, u64 wait_ns),
+	TP_ARGS(class, wait_ns),
+	TP_STRUCT__entry(
+		__field(int, class)
+		__field(u64, wait_ns)
+	),
+	TP_fast_assign(
+		__entry->class = class;
+		__entry->wait_ns = wait_ns;
+	),
+	TP_printk("class=%d wait_ns=%llu",
+		  __entry->class, __entry->wait_ns)
+);
+
+TRACE_EVENT(binder_wait_for_work,
+	TP_PROTO(bool proc_work, bool transaction_stack, bool thread_todo),
+	TP_ARGS(proc_work, transaction_stack, thread_todo),
+	TP_STRUCT__entry(
+		__field(bool, proc_work)
+		__field(bool, transaction_stack)
+		__field(bool, thread_todo)
+	),
+	TP_fast_assign(
+		__entry->proc_work = proc_work;
+		__entry->transaction_stack = transaction_stack;
+		__entry->thread_todo = thread_todo;
+	),
+	TP_printk("proc_work=%d transaction_stack=%d thread_todo=%d",
+		  __entry->proc_work, __entry->transaction_stack,
+		  __entry->thread_todo)
+);
+
+TRACE_EVENT(binder_transaction,
+	TP_PROTO(bool reply, struct binder_transaction *t,
+		 struct binder_node *target_node),
+	TP_ARGS(reply, t, target_node),
+	TP_STRUCT__entry(
+		__field(int, debug_id)
+		__field(int, target_node)
+		__field(int, to_proc)
+		__field(int, to_thread)
+		__field(int, reply)
+		__field(unsigned int, code)
+		__field(unsigned int, flags)
+	),
+	TP_fast_assign(
+		__entry->debug_id = t->debug_id;
+		__entry->target_node = target_node ? target_node->debug_id : 0;
+		__entry->to_proc = t->to_proc->pid;
+		__entry->to_thread = t->to_thread ? t->to_thread->pid : 0;
+		__entry->reply = reply;
+		__entry->code = t->code;
+		__entry->flags = t->flags;
+	),
+	TP_printk("transaction=%d dest_node=%d dest_proc=%d dest_thread=%d reply=%d flags=0x%x code=0x%x",
+		  __entry->debug_id, __entry->target_node,
+		  __entry->to_proc, __entry->to_thread,
+		  __entry->reply, __entry->flags, __entry->code)
+);
+
+TRACE_EVENT(binder_transaction_alloc_buf,
+	TP_PROTO(struct binder_buffer *buf, u64 alloc_ns),
+	TP_ARGS(buf, alloc_ns),
+	TP_STRUCT__entry(
+		__field(int, debug_id)
+		__field(size_t, data_size)
+		__field(size_t, offsets_size)
+		__field(u64, alloc_ns)
+	),
+	TP_fast_assign(
+		__entry->debug_id = buf->debug_id;
+		__entry->data_size = buf->data_size;
+		__entry->offsets_size = buf->offsets_size;
+		__entry->alloc_ns = alloc_ns;
+	),
+	TP_printk("transaction=%d data_size=%zd offsets_size=%zd alloc_ns=%llu",
+		  __entry->debug_id, __entry->data_size,
+		  __entry->offsets_size, __entry->alloc_ns)
+);
+
+TRACE_EVENT(binder_transaction_received,
+	TP_PROTO(struct binder_transaction *t, u64 wait_ns),
+	TP_ARGS(t, wait_ns),
+	TP_STRUCT__entry(
+		__field(int, debug_id)
+		__field(u64, wait_ns)
+	),
+	TP_fast_assign(
+		__entry->debug_id = t->debug_id;
+		__entry->wait_ns = wait_ns;
+	),
+	TP_printk("transaction=%d wait_ns=%llu",
+		  __entry->debug_id, __entry->wait_ns)
+);
+
+TRACE_EVENT(binder_transaction_round_trip,
+	TP_PROTO(struct binder_transaction *t, int from_proc, int to_proc,
+		 u64 latency_ns),
+	TP_ARGS(t, from_proc, to_proc, latency_ns),
+	TP_STRUCT__entry(
+		__field(int, debug_id)
+		__field(int, from_proc)
+		__field(int, to_proc)
+		__field(u64, latency_ns)
+	),
+	TP_fast_assign(
+		__entry->debug_id = t->debug_id;
+		__entry->from_proc = from_proc;
+		__entry->to_proc = to_proc;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk("transaction=%d from_proc=%d to_proc=%d latency_ns=%llu",
+		  __entry->debug_id, __entry->from_proc,
+		  __entry->to_proc, __entry->latency_ns)
+);
+
+#endif /* _BINDER_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE binder_trace
+#include <trace/define_trace.h>
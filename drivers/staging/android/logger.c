@@ -25,6 +25,9 @@
 #include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/time.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
 #include "logger.h"
 
 #include <asm/ioctls.h>
@@ -33,31 +36,36 @@
 #define CONFIG_LOGCAT_SIZE 256
 #endif
 
+#define LOGGER_RING_MIN_SIZE	(16 * 1024)
+
+struct logger_ring {
+	struct logger_ring_control	*ctl;
+	unsigned char			*data;
+	u32				size;
+	u32				flush;
+};
+
 struct logger_log {
-	unsigned char		*buffer;
-	struct miscdevice	misc;	
-	wait_queue_head_t	wq;	
-	struct list_head	readers; 
-	struct mutex		mutex;	
-	size_t			w_off;	
-	size_t			head;	
-	size_t			size;	
+	void			*area;
+	struct logger_ring	*rings;
+	int			nr_rings;
+	struct miscdevice	misc;
+	wait_queue_head_t	wq;
+	struct mutex		mutex;
+	unsigned int		flush_seq;
+	size_t			ring_size;
+	size_t			size;
 };
 
 struct logger_reader {
-	struct logger_log	*log;	
-	struct list_head	list;	
-	size_t			r_off;	
-	bool			r_all;	
-	int			r_ver;	
+	struct logger_log	*log;
+	struct mutex		mutex;
+	u32			*r_pos;
+	unsigned int		flush_seq;
+	bool			r_all;
+	int			r_ver;
 };
 
-size_t logger_offset(struct logger_log *log, size_t n)
-{
-	return n & (log->size-1);
-}
-
-
 static inline struct logger_log *file_get_log(struct file *file)
 {
 	if (file->f_mode & FMODE_READ) {
@@ -67,27 +75,183 @@ static inline struct logger_log *file_get_log(struct file *file)
 		return file->private_data;
 }
 
-static struct logger_entry *get_entry_header(struct logger_log *log,
-		size_t off, struct logger_entry *scratch)
+static inline struct logger_record *logger_ring_rec(struct logger_ring *ring,
+						    u32 pos)
+{
+	return (struct logger_record *)(ring->data + (pos & (ring->size - 1)));
+}
+
+static inline bool logger_ring_valid(struct logger_ring *ring, u32 pos)
 {
-	size_t len = min(sizeof(struct logger_entry), log->size - off);
-	if (len != sizeof(struct logger_entry)) {
-		memcpy(((void *) scratch), log->buffer + off, len);
-		memcpy(((void *) scratch) + len, log->buffer,
-			sizeof(struct logger_entry) - len);
-		return scratch;
+	smp_rmb();
+	return (s32)(pos - ACCESS_ONCE(ring->ctl->tail)) >= 0;
+}
+
+static bool logger_ring_make_room(struct logger_ring *ring, u32 next)
+{
+	u32 tail = ring->ctl->tail;
+
+	while (next - tail > ring->size) {
+		struct logger_record *rec = logger_ring_rec(ring, tail);
+
+		if (!(ACCESS_ONCE(rec->flags) & LOGGER_RECORD_COMMITTED))
+			return false;
+		tail += rec->len;
+	}
+
+	ACCESS_ONCE(ring->ctl->tail) = tail;
+	smp_wmb();
+	return true;
+}
+
+static struct logger_record *logger_ring_reserve(struct logger_ring *ring,
+						 u32 len,
+						 struct logger_entry *header)
+{
+	struct logger_record *rec;
+	u32 head = ring->ctl->head;
+	u32 off = head & (ring->size - 1);
+	u32 pad = 0;
+
+	if (off + len > ring->size)
+		pad = ring->size - off;
+
+	if (!logger_ring_make_room(ring, head + pad + len)) {
+		ring->ctl->dropped++;
+		return NULL;
+	}
+
+	if (pad) {
+		rec = logger_ring_rec(ring, head);
+		rec->len = pad;
+		rec->flags = LOGGER_RECORD_COMMITTED | LOGGER_RECORD_PADDING;
+		head += pad;
 	}
 
-	return (struct logger_entry *) (log->buffer + off);
+	rec = logger_ring_rec(ring, head);
+	rec->len = len;
+	rec->flags = 0;
+	rec->ts = ktime_to_ns(ktime_get());
+	rec->entry = *header;
+
+	smp_wmb();
+	ACCESS_ONCE(ring->ctl->head) = head + len;
+	return rec;
+}
+
+static void logger_ring_commit(struct logger_record *rec, u32 flags)
+{
+	smp_wmb();
+	ACCESS_ONCE(rec->flags) = LOGGER_RECORD_COMMITTED | flags;
 }
 
-static __u32 get_entry_msg_len(struct logger_log *log, size_t off)
+static bool logger_ring_peek(struct logger_ring *ring, u32 *pos,
+			     bool all, uid_t euid, struct logger_record *out)
 {
-	struct logger_entry scratch;
-	struct logger_entry *entry;
+	struct logger_record *rec;
+	u32 head, tail, len, flags;
+
+	for (;;) {
+		tail = ACCESS_ONCE(ring->ctl->tail);
+		smp_rmb();
+		head = ACCESS_ONCE(ring->ctl->head);
+
+		if (*pos - tail > head - tail)
+			*pos = tail;
+		if (*pos == head)
+			return false;
+
+		smp_rmb();
+		rec = logger_ring_rec(ring, *pos);
+		len = ACCESS_ONCE(rec->len);
+		flags = ACCESS_ONCE(rec->flags);
+		if (!logger_ring_valid(ring, *pos))
+			continue;
+
+		if (len < LOGGER_RECORD_ALIGN || len > ring->size ||
+		    !IS_ALIGNED(len, LOGGER_RECORD_ALIGN)) {
+			*pos = tail;
+			continue;
+		}
+		if (!(flags & LOGGER_RECORD_COMMITTED))
+			return false;
+		if (flags & (LOGGER_RECORD_PADDING | LOGGER_RECORD_DISCARD)) {
+			*pos += len;
+			continue;
+		}
+
+		memcpy(out, rec, sizeof(*out));
+		if (!logger_ring_valid(ring, *pos))
+			continue;
+		if (sizeof(*out) + out->entry.len > len) {
+			*pos = tail;
+			continue;
+		}
 
-	entry = get_entry_header(log, off, &scratch);
-	return entry->len;
+		if (all || out->entry.euid == euid)
+			return true;
+		*pos += len;
+	}
+}
+
+static void logger_reader_sync_flush(struct logger_reader *reader)
+{
+	struct logger_log *log = reader->log;
+	int i;
+
+	if (likely(ACCESS_ONCE(log->flush_seq) == reader->flush_seq))
+		return;
+
+	mutex_lock(&log->mutex);
+	for (i = 0; i < log->nr_rings; i++)
+		if ((s32)(reader->r_pos[i] - log->rings[i].flush) < 0)
+			reader->r_pos[i] = log->rings[i].flush;
+	reader->flush_seq = log->flush_seq;
+	mutex_unlock(&log->mutex);
+}
+
+static int logger_reader_next(struct logger_reader *reader,
+			      struct logger_record *rec)
+{
+	struct logger_log *log = reader->log;
+	struct logger_record tmp;
+	uid_t euid = current_euid();
+	int i, best = -1;
+
+	logger_reader_sync_flush(reader);
+
+	for (i = 0; i < log->nr_rings; i++) {
+		if (!logger_ring_peek(&log->rings[i], &reader->r_pos[i],
+				      reader->r_all, euid, &tmp))
+			continue;
+		if (best < 0 || tmp.ts < rec->ts) {
+			best = i;
+			*rec = tmp;
+		}
+	}
+
+	return best;
+}
+
+static bool logger_reader_ready(struct logger_reader *reader)
+{
+	struct logger_log *log = reader->log;
+	struct logger_record tmp;
+	uid_t euid = current_euid();
+	int i;
+
+	for (i = 0; i < log->nr_rings; i++) {
+		u32 pos = ACCESS_ONCE(reader->r_pos[i]);
+		u32 flush = ACCESS_ONCE(log->rings[i].flush);
+
+		if ((s32)(pos - flush) < 0)
+			pos = flush;
+		if (logger_ring_peek(&log->rings[i], &pos, reader->r_all,
+				     euid, &tmp))
+			return true;
+	}
+
+	return false;
 }
 
 static size_t get_user_hdr_len(int ver)
@@ -122,59 +286,6 @@ static ssize_t copy_header_to_user(int ver, struct logger_entry *entry,
 	return copy_to_user(buf, hdr, hdr_len);
 }
 
-static ssize_t do_read_log_to_user(struct logger_log *log,
-				   struct logger_reader *reader,
-				   char __user *buf,
-				   size_t count)
-{
-	struct logger_entry scratch;
-	struct logger_entry *entry;
-	size_t len;
-	size_t msg_start;
-
-	entry = get_entry_header(log, reader->r_off, &scratch);
-	if (copy_header_to_user(reader->r_ver, entry, buf))
-		return -EFAULT;
-
-	count -= get_user_hdr_len(reader->r_ver);
-	buf += get_user_hdr_len(reader->r_ver);
-	msg_start = logger_offset(log,
-		reader->r_off + sizeof(struct logger_entry));
-
-	len = min(count, log->size - msg_start);
-	if (copy_to_user(buf, log->buffer + msg_start, len))
-		return -EFAULT;
-
-	if (count != len)
-		if (copy_to_user(buf + len, log->buffer, count - len))
-			return -EFAULT;
-
-	reader->r_off = logger_offset(log, reader->r_off +
-		sizeof(struct logger_entry) + count);
-
-	return count + get_user_hdr_len(reader->r_ver);
-}
-
-static size_t get_next_entry_by_uid(struct logger_log *log,
-		size_t off, uid_t euid)
-{
-	while (off != log->w_off) {
-		struct logger_entry *entry;
-		struct logger_entry scratch;
-		size_t next_len;
-
-		entry = get_entry_header(log, off, &scratch);
-
-		if (entry->euid == euid)
-			return off;
-
-		next_len = sizeof(struct logger_entry) + entry->len;
-		off = logger_offset(log, off + next_len);
-	}
-
-	return off;
-}
-
 /*
  * logger_read - our log's read() method
  *
@@ -182,7 +293,8 @@ static size_t get_next_entry_by_uid(struct logger_log *log,
  *
  *	- O_NONBLOCK works
  *	- If there are no log entries to read, blocks until log is written to
- *	- Atomically reads exactly one log entry
+ *	- Atomically reads exactly one log entry, the oldest one across all
+ *	  of the per-cpu rings
  *
  * Will set errno to EINVAL if read
  * buffer is insufficient to hold next entry.
@@ -192,148 +304,65 @@ static ssize_t logger_read(struct file *file, char __user *buf,
 {
 	struct logger_reader *reader = file->private_data;
 	struct logger_log *log = reader->log;
+	struct logger_record rec;
+	struct logger_ring *ring;
+	size_t hdr_len;
 	ssize_t ret;
-	DEFINE_WAIT(wait);
+	int i;
 
-start:
+	mutex_lock(&reader->mutex);
 	while (1) {
-		mutex_lock(&log->mutex);
+		i = logger_reader_next(reader, &rec);
+		if (i < 0) {
+			mutex_unlock(&reader->mutex);
 
-		prepare_to_wait(&log->wq, &wait, TASK_INTERRUPTIBLE);
+			if (file->f_flags & O_NONBLOCK)
+				return -EAGAIN;
 
-		ret = (log->w_off == reader->r_off);
-		mutex_unlock(&log->mutex);
-		if (!ret)
-			break;
+			if (wait_event_interruptible(log->wq,
+					logger_reader_ready(reader)))
+				return -EINTR;
 
-		if (file->f_flags & O_NONBLOCK) {
-			ret = -EAGAIN;
-			break;
+			mutex_lock(&reader->mutex);
+			continue;
 		}
 
-		if (signal_pending(current)) {
-			ret = -EINTR;
+		ring = &log->rings[i];
+		hdr_len = get_user_hdr_len(reader->r_ver);
+		ret = hdr_len + rec.entry.len;
+		if (count < ret) {
+			ret = -EINVAL;
 			break;
 		}
 
-		schedule();
-	}
-
-	finish_wait(&log->wq, &wait);
-	if (ret)
-		return ret;
-
-	mutex_lock(&log->mutex);
-
-	if (!reader->r_all)
-		reader->r_off = get_next_entry_by_uid(log,
-			reader->r_off, current_euid());
+		if (copy_header_to_user(reader->r_ver, &rec.entry, buf) ||
+		    copy_to_user(buf + hdr_len,
+				 logger_ring_rec(ring, reader->r_pos[i]) + 1,
+				 rec.entry.len)) {
+			ret = -EFAULT;
+			break;
+		}
 
-	
-	if (unlikely(log->w_off == reader->r_off)) {
-		mutex_unlock(&log->mutex);
-		goto start;
-	}
+		if (!logger_ring_valid(ring, reader->r_pos[i]))
+			continue;
 
-	
-	ret = get_user_hdr_len(reader->r_ver) +
-		get_entry_msg_len(log, reader->r_off);
-	if (count < ret) {
-		ret = -EINVAL;
-		goto out;
+		reader->r_pos[i] += rec.len;
+		break;
 	}
-
-	
-	ret = do_read_log_to_user(log, reader, buf, ret);
-
-out:
-	mutex_unlock(&log->mutex);
+	mutex_unlock(&reader->mutex);
 
 	return ret;
 }
 
-static size_t get_next_entry(struct logger_log *log, size_t off, size_t len)
-{
-	size_t count = 0;
-
-	do {
-		size_t nr = sizeof(struct logger_entry) +
-			get_entry_msg_len(log, off);
-		off = logger_offset(log, off + nr);
-		count += nr;
-	} while (count < len);
-
-	return off;
-}
-
-static inline int is_between(size_t a, size_t b, size_t c)
-{
-	if (a < b) {
-		
-		if (a < c && c <= b)
-			return 1;
-	} else {
-		
-		if (c <= b || a < c)
-			return 1;
-	}
-
-	return 0;
-}
-
-static void fix_up_readers(struct logger_log *log, size_t len)
-{
-	size_t old = log->w_off;
-	size_t new = logger_offset(log, old + len);
-	struct logger_reader *reader;
-
-	if (is_between(old, new, log->head))
-		log->head = get_next_entry(log, log->head, len);
-
-	list_for_each_entry(reader, &log->readers, list)
-		if (is_between(old, new, reader->r_off))
-			reader->r_off = get_next_entry(log, reader->r_off, len);
-}
-
-static void do_write_log(struct logger_log *log, const void *buf, size_t count)
-{
-	size_t len;
-
-	len = min(count, log->size - log->w_off);
-	memcpy(log->buffer + log->w_off, buf, len);
-
-	if (count != len)
-		memcpy(log->buffer, buf + len, count - len);
-
-	log->w_off = logger_offset(log, log->w_off + count);
-
-}
-
-static ssize_t do_write_log_from_user(struct logger_log *log,
-				      const void __user *buf, size_t count)
-{
-	size_t len;
-
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
-		return -EFAULT;
-
-	if (count != len)
-		if (copy_from_user(log->buffer, buf + len, count - len))
-			return -EFAULT;
-
-	log->w_off = logger_offset(log, log->w_off + count);
-
-	return count;
-}
-
 ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig = log->w_off;
+	struct logger_record *rec;
 	struct logger_entry header;
 	struct timespec now;
+	unsigned char *msg;
+	u32 flags = 0;
 	ssize_t ret = 0;
 
 	now = current_kernel_time();
@@ -346,39 +375,37 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	header.len = min_t(size_t, iocb->ki_left, LOGGER_ENTRY_MAX_PAYLOAD);
 	header.hdr_size = sizeof(struct logger_entry);
 
-	
 	if (unlikely(!header.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
-
-	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
-
-	do_write_log(log, &header, sizeof(struct logger_entry));
+	rec = logger_ring_reserve(&log->rings[get_cpu()],
+				  ALIGN(sizeof(struct logger_record) + header.len,
+					LOGGER_RECORD_ALIGN), &header);
+	put_cpu();
+	if (unlikely(!rec))
+		return -EAGAIN;
 
-	while (nr_segs-- > 0) {
+	msg = (unsigned char *)(rec + 1);
+	while (nr_segs-- > 0 && ret < header.len) {
 		size_t len;
-		ssize_t nr;
 
-		
 		len = min_t(size_t, iov->iov_len, header.len - ret);
 
-		
-		nr = do_write_log_from_user(log, iov->iov_base, len);
-		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
+		if (unlikely(copy_from_user(msg + ret, iov->iov_base, len))) {
+			flags = LOGGER_RECORD_DISCARD;
+			ret = -EFAULT;
+			break;
 		}
 
 		iov++;
-		ret += nr;
+		ret += len;
 	}
 
-	mutex_unlock(&log->mutex);
+	logger_ring_commit(rec, flags);
 
-	
-	wake_up_interruptible(&log->wq);
+	smp_mb();
+	if (waitqueue_active(&log->wq))
+		wake_up_interruptible(&log->wq);
 
 	return ret;
 }
@@ -400,21 +427,28 @@ static int logger_open(struct inode *inode, struct file *file)
 
 	if (file->f_mode & FMODE_READ) {
 		struct logger_reader *reader;
+		int i;
 
 		reader = kmalloc(sizeof(struct logger_reader), GFP_KERNEL);
 		if (!reader)
 			return -ENOMEM;
 
+		reader->r_pos = kcalloc(log->nr_rings, sizeof(u32), GFP_KERNEL);
+		if (!reader->r_pos) {
+			kfree(reader);
+			return -ENOMEM;
+		}
+
 		reader->log = log;
 		reader->r_ver = 1;
 		reader->r_all = in_egroup_p(inode->i_gid) ||
 			capable(CAP_SYSLOG);
-
-		INIT_LIST_HEAD(&reader->list);
+		mutex_init(&reader->mutex);
 
 		mutex_lock(&log->mutex);
-		reader->r_off = log->head;
-		list_add_tail(&reader->list, &log->readers);
+		for (i = 0; i < log->nr_rings; i++)
+			reader->r_pos[i] = log->rings[i].flush;
+		reader->flush_seq = log->flush_seq;
 		mutex_unlock(&log->mutex);
 
 		file->private_data = reader;
@@ -428,12 +462,8 @@ static int logger_release(struct inode *ignored, struct file *file)
 {
 	if (file->f_mode & FMODE_READ) {
 		struct logger_reader *reader = file->private_data;
-		struct logger_log *log = reader->log;
-
-		mutex_lock(&log->mutex);
-		list_del(&reader->list);
-		mutex_unlock(&log->mutex);
 
+		kfree(reader->r_pos);
 		kfree(reader);
 	}
 
@@ -454,18 +484,30 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &log->wq, wait);
 
-	mutex_lock(&log->mutex);
-	if (!reader->r_all)
-		reader->r_off = get_next_entry_by_uid(log,
-			reader->r_off, current_euid());
-
-	if (log->w_off != reader->r_off)
+	if (logger_reader_ready(reader))
 		ret |= POLLIN | POLLRDNORM;
-	mutex_unlock(&log->mutex);
 
 	return ret;
 }
 
+static int logger_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct logger_reader *reader;
+
+	if (!(file->f_mode & FMODE_READ))
+		return -EBADF;
+
+	reader = file->private_data;
+	if (!reader->r_all)
+		return -EPERM;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, reader->log->area, vma->vm_pgoff);
+}
+
 static long logger_set_version(struct logger_reader *reader, void __user *arg)
 {
 	int version;
@@ -479,14 +521,36 @@ static long logger_set_version(struct logger_reader *reader, void __user *arg)
 	return 0;
 }
 
+static long logger_get_log_len(struct logger_reader *reader)
+{
+	struct logger_log *log = reader->log;
+	long len = 0;
+	int i;
+
+	logger_reader_sync_flush(reader);
+
+	for (i = 0; i < log->nr_rings; i++) {
+		struct logger_ring *ring = &log->rings[i];
+		u32 tail = ACCESS_ONCE(ring->ctl->tail);
+		u32 head = ACCESS_ONCE(ring->ctl->head);
+		u32 pos = reader->r_pos[i];
+
+		if (pos - tail > head - tail)
+			pos = tail;
+		len += head - pos;
+	}
+
+	return len;
+}
+
 static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct logger_log *log = file_get_log(file);
 	struct logger_reader *reader;
+	struct logger_record rec;
 	long ret = -EINVAL;
 	void __user *argp = (void __user *) arg;
-
-	mutex_lock(&log->mutex);
+	int i;
 
 	switch (cmd) {
 	case LOGGER_GET_LOG_BUF_SIZE:
@@ -498,10 +562,9 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
-		if (log->w_off >= reader->r_off)
-			ret = log->w_off - reader->r_off;
-		else
-			ret = (log->size - reader->r_off) + log->w_off;
+		mutex_lock(&reader->mutex);
+		ret = logger_get_log_len(reader);
+		mutex_unlock(&reader->mutex);
 		break;
 	case LOGGER_GET_NEXT_ENTRY_LEN:
 		if (!(file->f_mode & FMODE_READ)) {
@@ -510,24 +573,24 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		}
 		reader = file->private_data;
 
-		if (!reader->r_all)
-			reader->r_off = get_next_entry_by_uid(log,
-				reader->r_off, current_euid());
-
-		if (log->w_off != reader->r_off)
-			ret = get_user_hdr_len(reader->r_ver) +
-				get_entry_msg_len(log, reader->r_off);
+		mutex_lock(&reader->mutex);
+		if (logger_reader_next(reader, &rec) >= 0)
+			ret = get_user_hdr_len(reader->r_ver) + rec.entry.len;
 		else
 			ret = 0;
+		mutex_unlock(&reader->mutex);
 		break;
 	case LOGGER_FLUSH_LOG:
 		if (!(file->f_mode & FMODE_WRITE)) {
 			ret = -EBADF;
 			break;
 		}
-		list_for_each_entry(reader, &log->readers, list)
-			reader->r_off = log->w_off;
-		log->head = log->w_off;
+		mutex_lock(&log->mutex);
+		for (i = 0; i < log->nr_rings; i++)
+			log->rings[i].flush = ACCESS_ONCE(log->rings[i].ctl->head);
+		smp_wmb();
+		log->flush_seq++;
+		mutex_unlock(&log->mutex);
 		ret = 0;
 		break;
 	case LOGGER_GET_VERSION:
@@ -544,12 +607,18 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
+		mutex_lock(&reader->mutex);
 		ret = logger_set_version(reader, argp);
+		mutex_unlock(&reader->mutex);
+		break;
+	case LOGGER_GET_RING_SIZE:
+		ret = log->ring_size;
+		break;
+	case LOGGER_GET_RING_COUNT:
+		ret = log->nr_rings;
 		break;
 	}
 
-	mutex_unlock(&log->mutex);
-
 	return ret;
 }
 
@@ -558,6 +627,7 @@ static const struct file_operations logger_fops = {
 	.read = logger_read,
 	.aio_write = logger_aio_write,
 	.poll = logger_poll,
+	.mmap = logger_mmap,
 	.unlocked_ioctl = logger_ioctl,
 	.compat_ioctl = logger_ioctl,
 	.open = logger_open,
@@ -565,9 +635,7 @@ static const struct file_operations logger_fops = {
 };
 
 #define DEFINE_LOGGER_DEVICE(VAR, NAME, SIZE) \
-static unsigned char _buf_ ## VAR[SIZE]; \
 static struct logger_log VAR = { \
-	.buffer = _buf_ ## VAR, \
 	.misc = { \
 		.minor = MISC_DYNAMIC_MINOR, \
 		.name = NAME, \
@@ -575,10 +643,7 @@ static struct logger_log VAR = { \
 		.parent = NULL, \
 	}, \
 	.wq = __WAIT_QUEUE_HEAD_INITIALIZER(VAR .wq), \
-	.readers = LIST_HEAD_INIT(VAR .readers), \
 	.mutex = __MUTEX_INITIALIZER(VAR .mutex), \
-	.w_off = 0, \
-	.head = 0, \
 	.size = SIZE, \
 };
 
@@ -606,19 +671,52 @@ static struct logger_log *get_log_from_minor(int minor)
 
 static int __init init_log(struct logger_log *log)
 {
+	size_t stride;
 	int ret;
+	int i;
+
+	log->nr_rings = nr_cpu_ids;
+	log->ring_size = rounddown_pow_of_two(max_t(size_t,
+			log->size / log->nr_rings, LOGGER_RING_MIN_SIZE));
+	stride = PAGE_SIZE + log->ring_size;
+
+	log->rings = kcalloc(log->nr_rings, sizeof(struct logger_ring),
+			     GFP_KERNEL);
+	log->area = vmalloc_user(log->nr_rings * stride);
+	if (!log->rings || !log->area) {
+		printk(KERN_ERR "logger: failed to allocate rings "
+		       "for log '%s'!\n", log->misc.name);
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	for (i = 0; i < log->nr_rings; i++) {
+		struct logger_ring *ring = &log->rings[i];
+
+		ring->ctl = log->area + i * stride;
+		ring->data = (unsigned char *)ring->ctl + PAGE_SIZE;
+		ring->size = log->ring_size;
+		ring->ctl->size = log->ring_size;
+	}
+	log->size = log->nr_rings * log->ring_size;
 
 	ret = misc_register(&log->misc);
 	if (unlikely(ret)) {
 		printk(KERN_ERR "logger: failed to register misc "
 		       "device for log '%s'!\n", log->misc.name);
-		return ret;
+		goto err_free;
 	}
 
-	printk(KERN_INFO "logger: created %luK log '%s'\n",
-	       (unsigned long) log->size >> 10, log->misc.name);
+	printk(KERN_INFO "logger: created %luK log '%s' (%d x %luK)\n",
+	       (unsigned long) log->size >> 10, log->misc.name,
+	       log->nr_rings, (unsigned long) log->ring_size >> 10);
 
 	return 0;
+
+err_free:
+	vfree(log->area);
+	kfree(log->rings);
+	return ret;
 }
 
 static int __init logger_init(void)
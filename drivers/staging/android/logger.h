@@ -41,6 +41,25 @@ struct logger_entry {
 	char		msg[0];		
 };
 
+struct logger_ring_control {
+	__u32		head;
+	__u32		tail;
+	__u32		size;
+	__u32		dropped;
+};
+
+struct logger_record {
+	__u32		len;
+	__u32		flags;
+	__u64		ts;
+	struct logger_entry	entry;
+};
+
+#define LOGGER_RECORD_COMMITTED	0x1
+#define LOGGER_RECORD_PADDING	0x2
+#define LOGGER_RECORD_DISCARD	0x4
+#define LOGGER_RECORD_ALIGN	8
+
 #define LOGGER_LOG_RADIO	"log_radio"	
 #define LOGGER_LOG_EVENTS	"log_events"	
 #define LOGGER_LOG_SYSTEM	"log_system"	
@@ -56,5 +75,7 @@ struct logger_entry {
 #define LOGGER_FLUSH_LOG		_IO(__LOGGERIO, 4) 
 #define LOGGER_GET_VERSION		_IO(__LOGGERIO, 5) 
 #define LOGGER_SET_VERSION		_IO(__LOGGERIO, 6) 
+#define LOGGER_GET_RING_SIZE		_IO(__LOGGERIO, 7)
+#define LOGGER_GET_RING_COUNT		_IO(__LOGGERIO, 8)
 
 #endif 
@@ -36,11 +36,17 @@
 #include <linux/oom.h>
 #include <linux/sched.h>
 #include <linux/rcupdate.h>
+#include <linux/seqlock.h>
 #include <linux/notifier.h>
 #include <linux/mutex.h>
 #include <linux/delay.h>
 #include <linux/swap.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
+#include <linux/vmstat.h>
+
+#define CREATE_TRACE_POINTS
+#include "lowmemorykiller_trace.h"
 
 #ifdef CONFIG_HIGHMEM
 	#define _ZONE ZONE_HIGHMEM
@@ -66,6 +72,18 @@ static int lowmem_minfree[6] = {
 };
 static int lowmem_minfree_size = 4;
 
+static int lowmem_pressure[6] = {
+	100,
+	95,
+	90,
+	60,
+};
+static int lowmem_pressure_size = 4;
+static uint32_t lowmem_use_pressure = 1;
+static uint32_t lowmem_pressure_window_ms = 100;
+static uint32_t lowmem_pressure_min_scan = SWAP_CLUSTER_MAX * 16;
+
+static struct task_struct *lowmem_deathpending;
 static unsigned long lowmem_deathpending_timeout;
 static uint32_t lowmem_sleep_ms = 1;
 static uint32_t lowmem_only_kswapd_sleep = 1;
@@ -139,35 +157,326 @@ int can_use_cma_pages(gfp_t gfp_mask)
 	return can_use;
 }
 
-static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
+struct lowmem_victim {
+	struct task_struct *p;
+	int tasksize;
+	int oom_score_adj;
+	int oom_adj;
+};
+
+static void lowmem_consider(struct task_struct *tsk, int min_score_adj,
+			    struct lowmem_victim *v)
+{
+	struct task_struct *p;
+	int oom_score_adj;
+	int tasksize;
+
+	if (tsk->flags & PF_KTHREAD)
+		return;
+
+	if (test_task_flag(tsk, TIF_MM_RELEASED))
+		return;
+
+	p = find_lock_task_mm(tsk);
+	if (!p)
+		return;
+
+	oom_score_adj = p->signal->oom_score_adj;
+	if (oom_score_adj < min_score_adj) {
+		task_unlock(p);
+		return;
+	}
+	tasksize = get_mm_rss(p->mm);
+	task_unlock(p);
+	if (tasksize <= 0)
+		return;
+	if (v->p) {
+		if (oom_score_adj < v->oom_score_adj)
+			return;
+		if (oom_score_adj == v->oom_score_adj &&
+		    tasksize <= v->tasksize)
+			return;
+	}
+	v->p = p;
+	v->tasksize = tasksize;
+	v->oom_score_adj = oom_score_adj;
+	v->oom_adj = p->signal->oom_adj;
+	lowmem_print(2, "select %d (%s), oom_adj %d score_adj %d, size %d, to kill\n",
+		     p->pid, p->comm, v->oom_adj, oom_score_adj, tasksize);
+}
+
+#ifdef CONFIG_ANDROID_LMK_ADJ_INDEX
+#define LOWMEM_ADJ_BUCKETS	(OOM_SCORE_ADJ_MAX - OOM_SCORE_ADJ_MIN + 1)
+
+static struct hlist_head lowmem_adj_buckets[LOWMEM_ADJ_BUCKETS];
+static DECLARE_BITMAP(lowmem_adj_populated, LOWMEM_ADJ_BUCKETS);
+static DEFINE_SPINLOCK(lowmem_index_lock);
+static seqcount_t lowmem_index_seq = SEQCNT_ZERO;
+
+static void __lowmem_index_add(struct task_struct *p, int adj)
+{
+	int bucket = adj - OOM_SCORE_ADJ_MIN;
+
+	p->lmk_adj = adj;
+	hlist_add_head_rcu(&p->lmk_node, &lowmem_adj_buckets[bucket]);
+	__set_bit(bucket, lowmem_adj_populated);
+}
+
+static void __lowmem_index_del(struct task_struct *p)
+{
+	int bucket = p->lmk_adj - OOM_SCORE_ADJ_MIN;
+
+	hlist_del_init_rcu(&p->lmk_node);
+	if (hlist_empty(&lowmem_adj_buckets[bucket]))
+		__clear_bit(bucket, lowmem_adj_populated);
+}
+
+void lowmem_index_add(struct task_struct *p)
+{
+	if (p->flags & PF_KTHREAD)
+		return;
+
+	spin_lock(&lowmem_index_lock);
+	__lowmem_index_add(p, p->signal->oom_score_adj);
+	spin_unlock(&lowmem_index_lock);
+}
+
+void lowmem_index_del(struct task_struct *p)
+{
+	spin_lock(&lowmem_index_lock);
+	if (!hlist_unhashed(&p->lmk_node))
+		__lowmem_index_del(p);
+	spin_unlock(&lowmem_index_lock);
+}
+
+void lowmem_index_update(struct task_struct *task)
+{
+	struct task_struct *p = task->group_leader;
+	int adj;
+
+	spin_lock(&lowmem_index_lock);
+	adj = p->signal->oom_score_adj;
+	if (!hlist_unhashed(&p->lmk_node) && p->lmk_adj != adj) {
+		write_seqcount_begin(&lowmem_index_seq);
+		__lowmem_index_del(p);
+		__lowmem_index_add(p, adj);
+		write_seqcount_end(&lowmem_index_seq);
+	}
+	spin_unlock(&lowmem_index_lock);
+}
+
+void lowmem_index_replace(struct task_struct *old, struct task_struct *new)
+{
+	spin_lock(&lowmem_index_lock);
+	if (!hlist_unhashed(&old->lmk_node)) {
+		__lowmem_index_del(old);
+		__lowmem_index_add(new, new->signal->oom_score_adj);
+	}
+	spin_unlock(&lowmem_index_lock);
+}
+
+static void lowmem_select(int min_score_adj, struct lowmem_victim *v)
 {
 	struct task_struct *tsk;
-	struct task_struct *selected = NULL;
+	struct hlist_node *node;
+	unsigned long min_bucket;
+	unsigned long bucket = LOWMEM_ADJ_BUCKETS;
+	unsigned long next;
+	unsigned seq;
+
+	min_bucket = max(min_score_adj, OOM_SCORE_ADJ_MIN) - OOM_SCORE_ADJ_MIN;
+	while (!v->p) {
+		next = find_last_bit(lowmem_adj_populated, bucket);
+		if (next == bucket || next < min_bucket)
+			break;
+		bucket = next;
+		/*
+		 * A task moved to another bucket under us takes the walk
+		 * with it, so walk the bucket again.
+		 */
+		do {
+			seq = read_seqcount_begin(&lowmem_index_seq);
+			hlist_for_each_entry_rcu(tsk, node,
+						 &lowmem_adj_buckets[bucket],
+						 lmk_node)
+				lowmem_consider(tsk, min_score_adj, v);
+		} while (read_seqcount_retry(&lowmem_index_seq, seq));
+	}
+}
+#else
+static void lowmem_select(int min_score_adj, struct lowmem_victim *v)
+{
+	struct task_struct *tsk;
+
+	for_each_process(tsk)
+		lowmem_consider(tsk, min_score_adj, v);
+}
+#endif
+
+static bool lowmem_victim_pending(void)
+{
+	struct task_struct *p = lowmem_deathpending;
+	bool pending = false;
+
+	if (!p)
+		return false;
+
+	if (time_before_eq(jiffies, lowmem_deathpending_timeout)) {
+		rcu_read_lock();
+		pending = pid_alive(p) && !test_task_flag(p, TIF_MM_RELEASED);
+		rcu_read_unlock();
+	}
+	if (!pending) {
+		lowmem_deathpending = NULL;
+		put_task_struct(p);
+	}
+	return pending;
+}
+
+#ifdef CONFIG_VM_EVENT_COUNTERS
+#define LOWMEM_PGSTEAL_FIRST	(PGSTEAL_KSWAPD_NORMAL - ZONE_NORMAL)
+#define LOWMEM_PGSCAN_FIRST	(PGSCAN_KSWAPD_NORMAL - ZONE_NORMAL)
+
+static struct {
+	unsigned long stamp;
+	unsigned long scan_stamp;
+	unsigned long scanned;
+	unsigned long reclaimed;
+	unsigned long stall_us;
+	int reclaim;
+	int stall;
+	int level;
+} lowmem_pressure_state;
+
+static unsigned long lowmem_sum_events(int first, int nr)
+{
+	unsigned long sum = 0;
+	int cpu;
+	int i;
+
+	for_each_online_cpu(cpu) {
+		struct vm_event_state *this = &per_cpu(vm_event_states, cpu);
+
+		for (i = first; i < first + nr; i++)
+			sum += this->event[i];
+	}
+	return sum;
+}
+
+static void lowmem_pressure_reset(void)
+{
+	lowmem_pressure_state.stamp = jiffies;
+	lowmem_pressure_state.scan_stamp = jiffies;
+	lowmem_pressure_state.scanned =
+		lowmem_sum_events(LOWMEM_PGSCAN_FIRST, 2 * MAX_NR_ZONES);
+	lowmem_pressure_state.reclaimed =
+		lowmem_sum_events(LOWMEM_PGSTEAL_FIRST, 2 * MAX_NR_ZONES);
+	lowmem_pressure_state.stall_us = lowmem_sum_events(ALLOCSTALL_US, 1);
+}
+
+static int lowmem_update_pressure(void)
+{
+	unsigned long now = jiffies;
+	unsigned long scanned, reclaimed, stall_us, elapsed_us;
+
+	if (time_before(now, lowmem_pressure_state.stamp +
+			msecs_to_jiffies(lowmem_pressure_window_ms)))
+		return lowmem_pressure_state.level;
+
+	scanned = lowmem_sum_events(LOWMEM_PGSCAN_FIRST, 2 * MAX_NR_ZONES) -
+		lowmem_pressure_state.scanned;
+	reclaimed = lowmem_sum_events(LOWMEM_PGSTEAL_FIRST, 2 * MAX_NR_ZONES) -
+		lowmem_pressure_state.reclaimed;
+	stall_us = lowmem_sum_events(ALLOCSTALL_US, 1) -
+		lowmem_pressure_state.stall_us;
+	elapsed_us = jiffies_to_usecs(now - lowmem_pressure_state.stamp);
+
+	if (scanned >= lowmem_pressure_min_scan) {
+		if (reclaimed >= scanned)
+			lowmem_pressure_state.reclaim = 0;
+		else
+			lowmem_pressure_state.reclaim =
+				(scanned - reclaimed) * 100 / scanned;
+		lowmem_pressure_state.scanned += scanned;
+		lowmem_pressure_state.reclaimed += reclaimed;
+		lowmem_pressure_state.scan_stamp = now;
+	} else if (time_after(now, lowmem_pressure_state.scan_stamp + HZ)) {
+		lowmem_pressure_state.reclaim = 0;
+		lowmem_pressure_state.scanned += scanned;
+		lowmem_pressure_state.reclaimed += reclaimed;
+		lowmem_pressure_state.scan_stamp = now;
+	}
+
+	lowmem_pressure_state.stall = elapsed_us ?
+		min_t(unsigned long, stall_us * 100 / elapsed_us, 100) : 0;
+	lowmem_pressure_state.stall_us += stall_us;
+	lowmem_pressure_state.stamp = now;
+	lowmem_pressure_state.level = max(lowmem_pressure_state.reclaim,
+					  lowmem_pressure_state.stall);
+
+	trace_lowmemory_pressure(lowmem_pressure_state.reclaim,
+				 lowmem_pressure_state.stall,
+				 lowmem_pressure_state.level);
+	return lowmem_pressure_state.level;
+}
+#else
+static void lowmem_pressure_reset(void)
+{
+}
+
+static int lowmem_update_pressure(void)
+{
+	return 0;
+}
+#endif
+
+static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
+{
+	struct lowmem_victim victim = { .p = NULL };
 	int rem = 0;
-	int tasksize;
 	int i;
 	int min_score_adj = OOM_SCORE_ADJ_MAX + 1;
-	int selected_tasksize = 0;
-	int selected_oom_score_adj;
-	int selected_oom_adj = 0;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free;
 	int other_file;
+	int free;
+	int minfree;
 	int reserved_free = 0;
 	int cma_free = 0;
+	int pressure;
 	unsigned long nr_to_scan = sc->nr_to_scan;
 	struct zone *zone;
-	int use_cma = can_use_cma_pages(sc->gfp_mask);
+	int use_cma;
+	ktime_t start;
 
-	if (nr_to_scan > 0) {
-		if (!mutex_trylock(&scan_mutex)) {
-			if (!(lowmem_only_kswapd_sleep && !current_is_kswapd())) {
-				msleep_interruptible(lowmem_sleep_ms);
-			}
-			return 0;
-		}
+	rem = global_page_state(NR_ACTIVE_ANON) +
+		global_page_state(NR_ACTIVE_FILE) +
+		global_page_state(NR_INACTIVE_ANON) +
+		global_page_state(NR_INACTIVE_FILE);
+	if (nr_to_scan <= 0) {
+		lowmem_print(5, "lowmem_shrink %lu, %x, return %d\n",
+			     nr_to_scan, sc->gfp_mask, rem);
+		return rem;
 	}
 
+	if (!mutex_trylock(&scan_mutex)) {
+		if (!(lowmem_only_kswapd_sleep && !current_is_kswapd()))
+			msleep_interruptible(lowmem_sleep_ms);
+		return 0;
+	}
+	start = ktime_get();
+
+	if (lowmem_victim_pending()) {
+		lowmem_print(2, "skipping , waiting for process %d (%s) dead\n",
+			     lowmem_deathpending->pid,
+			     lowmem_deathpending->comm);
+		if (!(lowmem_only_kswapd_sleep && !current_is_kswapd()))
+			msleep_interruptible(lowmem_sleep_ms);
+		mutex_unlock(&scan_mutex);
+		return 0;
+	}
+
+	use_cma = can_use_cma_pages(sc->gfp_mask);
 	for_each_zone(zone)
 	{
 		if (is_normal(zone))
@@ -176,7 +485,6 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		cma_free += zone_page_state(zone, NR_FREE_CMA_PAGES);
 	}
 
-
 	other_free = global_page_state(NR_FREE_PAGES);
 
 	if (global_page_state(NR_SHMEM) + global_page_state(NR_MLOCK) + total_swapcache_pages <
@@ -188,111 +496,69 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	else
 		other_file = 0;
 
+	free = other_free - reserved_free - (use_cma ? 0 : cma_free);
+	pressure = lowmem_update_pressure();
+
 	if (lowmem_adj_size < array_size)
 		array_size = lowmem_adj_size;
 	if (lowmem_minfree_size < array_size)
 		array_size = lowmem_minfree_size;
+	if (lowmem_use_pressure && lowmem_pressure_size < array_size)
+		array_size = lowmem_pressure_size;
 	for (i = 0; i < array_size; i++) {
-		if ((other_free - reserved_free - (use_cma ? 0 : cma_free)) < lowmem_minfree[i] &&
-		    other_file < lowmem_minfree[i]) {
+		minfree = lowmem_minfree[i];
+		if (lowmem_use_pressure) {
+			if (pressure >= lowmem_pressure[i])
+				minfree = lowmem_minfree[array_size - 1];
+			else if (i > 0)
+				continue;
+		}
+		if (free < minfree && other_file < minfree) {
 			min_score_adj = lowmem_adj[i];
 			break;
 		}
 	}
-	if (nr_to_scan > 0)
-		lowmem_print(3, "lowmem_shrink %lu, %x, ofree %d %d, ma %d, rfree %d\n",
-				nr_to_scan, sc->gfp_mask, other_free,
-				other_file, min_score_adj, reserved_free);
-	rem = global_page_state(NR_ACTIVE_ANON) +
-		global_page_state(NR_ACTIVE_FILE) +
-		global_page_state(NR_INACTIVE_ANON) +
-		global_page_state(NR_INACTIVE_FILE);
-	if (nr_to_scan <= 0 || min_score_adj == OOM_SCORE_ADJ_MAX + 1) {
+	lowmem_print(3, "lowmem_shrink %lu, %x, ofree %d %d, ma %d, rfree %d, pressure %d\n",
+			nr_to_scan, sc->gfp_mask, other_free,
+			other_file, min_score_adj, reserved_free, pressure);
+	if (min_score_adj == OOM_SCORE_ADJ_MAX + 1) {
 		lowmem_print(5, "lowmem_shrink %lu, %x, return %d\n",
 			     nr_to_scan, sc->gfp_mask, rem);
-
-		if (nr_to_scan > 0)
-			mutex_unlock(&scan_mutex);
-
+		mutex_unlock(&scan_mutex);
 		return rem;
 	}
-	selected_oom_score_adj = min_score_adj;
 
 	rcu_read_lock();
-	for_each_process(tsk) {
-		struct task_struct *p;
-		int oom_score_adj;
-
-		if (tsk->flags & PF_KTHREAD)
-			continue;
-
-		
-		if (test_task_flag(tsk, TIF_MM_RELEASED))
-			continue;
-
-		if (time_before_eq(jiffies, lowmem_deathpending_timeout)) {
-			if (test_task_flag(tsk, TIF_MEMDIE)) {
-				lowmem_print(2, "skipping , waiting for process %d (%s) dead\n",
-				tsk->pid, tsk->comm);
-				rcu_read_unlock();
-				
-				if (!(lowmem_only_kswapd_sleep && !current_is_kswapd())) {
-					msleep_interruptible(lowmem_sleep_ms);
-				}
-				mutex_unlock(&scan_mutex);
-				return 0;
-			}
-		}
-
-		p = find_lock_task_mm(tsk);
-		if (!p)
-			continue;
-
-		oom_score_adj = p->signal->oom_score_adj;
-		if (oom_score_adj < min_score_adj) {
-			task_unlock(p);
-			continue;
-		}
-		tasksize = get_mm_rss(p->mm);
-		task_unlock(p);
-		if (tasksize <= 0)
-			continue;
-		if (selected) {
-			if (oom_score_adj < selected_oom_score_adj)
-				continue;
-			if (oom_score_adj == selected_oom_score_adj &&
-			    tasksize <= selected_tasksize)
-				continue;
-		}
-		selected = p;
-		selected_tasksize = tasksize;
-		selected_oom_score_adj = oom_score_adj;
-		selected_oom_adj = p->signal->oom_adj;
-		lowmem_print(2, "select %d (%s), oom_adj %d score_adj %d, size %d, to kill\n",
-			     p->pid, p->comm, selected_oom_adj, oom_score_adj, tasksize);
-	}
-	if (selected) {
+	lowmem_select(min_score_adj, &victim);
+	if (victim.p) {
+		struct task_struct *selected = victim.p;
 		bool should_dump_meminfo = false;
 
 		lowmem_print(1, "[%s] send sigkill to %d (%s), oom_adj %d, score_adj %d,"
 			" min_score_adj %d, size %dK, free %dK, file %dK, "
-			" reserved_free %dK, cma_free %dK, use_cma %d\n",
+			" reserved_free %dK, cma_free %dK, use_cma %d, pressure %d\n",
 			     current->comm, selected->pid, selected->comm,
-			     selected_oom_adj, selected_oom_score_adj,
-			     min_score_adj, selected_tasksize << 2,
-			     other_free << 2, other_file << 2, reserved_free << 2, cma_free << 2, use_cma);
+			     victim.oom_adj, victim.oom_score_adj,
+			     min_score_adj, victim.tasksize << 2,
+			     other_free << 2, other_file << 2, reserved_free << 2,
+			     cma_free << 2, use_cma, pressure);
 
 		lowmem_deathpending_timeout = jiffies + HZ;
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_AUTODETECT_OOM_ADJ_VALUES
 #define DUMP_INFO_OOM_SCORE_ADJ_THRESHOLD	((7 * OOM_SCORE_ADJ_MAX) / -OOM_DISABLE)
-		if (selected_oom_score_adj < DUMP_INFO_OOM_SCORE_ADJ_THRESHOLD)
+		if (victim.oom_score_adj < DUMP_INFO_OOM_SCORE_ADJ_THRESHOLD)
 #else
-		if (selected->signal->oom_adj < 7)
+		if (victim.oom_adj < 7)
 #endif
 			should_dump_meminfo = true;
 		send_sig(SIGKILL, selected, 0);
 		set_tsk_thread_flag(selected, TIF_MEMDIE);
-		rem -= selected_tasksize;
+		get_task_struct(selected);
+		lowmem_deathpending = selected;
+		trace_lowmemory_kill(selected, victim.oom_score_adj,
+				     min_score_adj, victim.tasksize, pressure,
+				     ktime_to_ns(ktime_sub(ktime_get(), start)));
+		rem -= victim.tasksize;
 		rcu_read_unlock();
 
 		if (should_dump_meminfo) {
@@ -319,6 +585,7 @@ static struct shrinker lowmem_shrinker = {
 
 static int __init lowmem_init(void)
 {
+	lowmem_pressure_reset();
 	register_shrinker(&lowmem_shrinker);
 	return 0;
 }
@@ -419,6 +686,13 @@ module_param_array_named(adj, lowmem_adj, int, &lowmem_adj_size,
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+module_param_array_named(pressure, lowmem_pressure, int, &lowmem_pressure_size,
+			 S_IRUGO | S_IWUSR);
+module_param_named(use_pressure, lowmem_use_pressure, uint, S_IRUGO | S_IWUSR);
+module_param_named(pressure_window_ms, lowmem_pressure_window_ms, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(pressure_min_scan, lowmem_pressure_min_scan, uint,
+		   S_IRUGO | S_IWUSR);
 
 module_init(lowmem_init);
 module_exit(lowmem_exit);
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2012 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM lowmemorykiller
+
+#if !defined(_LOWMEMORYKILLER_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _LOWMEMORYKILLER_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(lowmemory_pressure,
+	TP_PROTO(int reclaim, int stall, int level),
+	TP_ARGS(reclaim, stall, level),
+	TP_STRUCT__entry(
+		__field(int, reclaim)
+		__field(int, stall)
+		__field(int, level)
+	),
+	TP_fast_assign(
+		__entry->reclaim = reclaim;
+		__entry->stall = stall;
+		__entry->level = level;
+	),
+	TP_printk("reclaim=%d stall=%d level=%d",
+		  __entry->reclaim, __entry->stall, __entry->level)
+);
+
+TRACE_EVENT(lowmemory_kill,
+	TP_PROTO(struct task_struct *p, int oom_score_adj, int min_score_adj,
+		 int tasksize, int pressure, u64 latency_ns),
+	TP_ARGS(p, oom_score_adj, min_score_adj, tasksize, pressure,
+		latency_ns),
+	TP_STRUCT__entry(
+		__array(char, comm, TASK_COMM_LEN)
+		__field(pid_t, pid)
+		__field(int, oom_score_adj)
+		__field(int, min_score_adj)
+		__field(int, tasksize)
+		__field(int, pressure)
+		__field(u64, latency_ns)
+	),
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid = p->pid;
+		__entry->oom_score_adj = oom_score_adj;
+		__entry->min_score_adj = min_score_adj;
+		__entry->tasksize = tasksize;
+		__entry->pressure = pressure;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk("pid=%d comm=%s oom_score_adj=%d min_score_adj=%d size=%dK pressure=%d latency_ns=%llu",
+		  __entry->pid, __entry->comm, __entry->oom_score_adj,
+		  __entry->min_score_adj, __entry->tasksize << 2,
+		  __entry->pressure, __entry->latency_ns)
+);
+
+#endif /* _LOWMEMORYKILLER_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_PATH .
+#define TRACE_INCLUDE_FILE lowmemorykiller_trace
+#include <trace/define_trace.h>
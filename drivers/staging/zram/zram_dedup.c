@@ -0,0 +1,172 @@
+/*
+ * Content based deduplication for the compressed RAM block device
+ *
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/jhash.h>
+#include <linux/vmalloc.h>
+#include <linux/highmem.h>
+
+#include "zram_drv.h"
+
+#define ZRAM_HASH_SHIFT		6
+
+static struct zram_hash *zram_hash_bucket(struct zram_meta *meta, u32 checksum)
+{
+	return &meta->hash[checksum & (meta->hash_size - 1)];
+}
+
+u32 zram_dedup_checksum(unsigned char *mem)
+{
+	return jhash2((const u32 *)mem, PAGE_SIZE / sizeof(u32), 0);
+}
+
+void zram_dedup_insert(struct zram *zram, struct zram_entry *new,
+				u32 checksum)
+{
+	struct zram_hash *hash = zram_hash_bucket(zram->meta, checksum);
+	struct rb_node **rb_node, *parent = NULL;
+	struct zram_entry *entry;
+
+	new->checksum = checksum;
+
+	spin_lock(&hash->lock);
+	rb_node = &hash->rb_root.rb_node;
+	while (*rb_node) {
+		parent = *rb_node;
+		entry = rb_entry(parent, struct zram_entry, rb_node);
+		if (checksum < entry->checksum)
+			rb_node = &parent->rb_left;
+		else
+			rb_node = &parent->rb_right;
+	}
+	rb_link_node(&new->rb_node, parent, rb_node);
+	rb_insert_color(&new->rb_node, &hash->rb_root);
+	spin_unlock(&hash->lock);
+}
+
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+				unsigned char *mem, unsigned char *buf)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned char *cmem;
+	bool match;
+
+	cmem = zs_map_object(meta->mem_pool, entry->handle, ZS_MM_RO);
+	if (entry->len == PAGE_SIZE)
+		match = !memcmp(mem, cmem, PAGE_SIZE);
+	else
+		match = !zcomp_decompress(zram->comp, cmem, entry->len, buf) &&
+			!memcmp(mem, buf, PAGE_SIZE);
+	zs_unmap_object(meta->mem_pool, entry->handle);
+
+	return match;
+}
+
+struct zram_entry *zram_dedup_get(struct zram *zram, unsigned char *mem,
+				u32 checksum, unsigned char *buf)
+{
+	struct zram_hash *hash = zram_hash_bucket(zram->meta, checksum);
+	struct zram_entry *entry = NULL, *prev = NULL;
+	struct rb_node *rb_node;
+
+	spin_lock(&hash->lock);
+	rb_node = hash->rb_root.rb_node;
+	while (rb_node) {
+		struct zram_entry *cur;
+
+		cur = rb_entry(rb_node, struct zram_entry, rb_node);
+		if (checksum <= cur->checksum) {
+			if (checksum == cur->checksum)
+				entry = cur;
+			rb_node = rb_node->rb_left;
+		} else {
+			rb_node = rb_node->rb_right;
+		}
+	}
+
+	/*
+	 * Entries with equal checksums are adjacent in order; try each one.
+	 * The reference held on the candidate keeps it in the tree while
+	 * the lock is dropped to compare contents.
+	 */
+	while (entry) {
+		atomic_inc(&entry->refcount);
+		spin_unlock(&hash->lock);
+
+		if (prev)
+			zram_entry_put(zram, prev);
+		if (zram_dedup_match(zram, entry, mem, buf))
+			return entry;
+		prev = entry;
+
+		spin_lock(&hash->lock);
+		rb_node = rb_next(&entry->rb_node);
+		entry = NULL;
+		if (rb_node) {
+			struct zram_entry *next;
+
+			next = rb_entry(rb_node, struct zram_entry, rb_node);
+			if (next->checksum == checksum)
+				entry = next;
+		}
+	}
+	spin_unlock(&hash->lock);
+
+	if (prev)
+		zram_entry_put(zram, prev);
+	return NULL;
+}
+
+int zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash;
+	int refcount;
+
+	/* Entries only enter the tree before they are published. */
+	if (RB_EMPTY_NODE(&entry->rb_node))
+		return atomic_dec_return(&entry->refcount);
+
+	if (atomic_add_unless(&entry->refcount, -1, 1))
+		return 1;
+
+	hash = zram_hash_bucket(zram->meta, entry->checksum);
+	spin_lock(&hash->lock);
+	refcount = atomic_dec_return(&entry->refcount);
+	if (!refcount) {
+		rb_erase(&entry->rb_node, &hash->rb_root);
+		RB_CLEAR_NODE(&entry->rb_node);
+	}
+	spin_unlock(&hash->lock);
+
+	return refcount;
+}
+
+int zram_dedup_init(struct zram_meta *meta, size_t num_pages)
+{
+	size_t i;
+
+	meta->hash_size = 1;
+	while ((meta->hash_size << ZRAM_HASH_SHIFT) < num_pages)
+		meta->hash_size <<= 1;
+
+	meta->hash = vzalloc(meta->hash_size * sizeof(struct zram_hash));
+	if (!meta->hash)
+		return -ENOMEM;
+
+	for (i = 0; i < meta->hash_size; i++) {
+		spin_lock_init(&meta->hash[i].lock);
+		meta->hash[i].rb_root = RB_ROOT;
+	}
+
+	return 0;
+}
+
+void zram_dedup_fini(struct zram_meta *meta)
+{
+	vfree(meta->hash);
+	meta->hash = NULL;
+}
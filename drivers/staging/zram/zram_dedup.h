@@ -0,0 +1,24 @@
+/*
+ * Content based deduplication for the compressed RAM block device
+ *
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+struct zram;
+struct zram_meta;
+struct zram_entry;
+
+u32 zram_dedup_checksum(unsigned char *mem);
+void zram_dedup_insert(struct zram *zram, struct zram_entry *new,
+				u32 checksum);
+struct zram_entry *zram_dedup_get(struct zram *zram, unsigned char *mem,
+				u32 checksum, unsigned char *buf);
+int zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+
+int zram_dedup_init(struct zram_meta *meta, size_t num_pages);
+void zram_dedup_fini(struct zram_meta *meta);
+
+#endif
@@ -29,10 +29,13 @@
 #include <linux/genhd.h>
 #include <linux/highmem.h>
 #include <linux/slab.h>
-#include <linux/lzo.h>
+#include <linux/bit_spinlock.h>
+#include <linux/err.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
 #include <linux/ratelimit.h>
+#include <linux/fs.h>
+#include <linux/file.h>
 
 #include "zram_drv.h"
 
@@ -43,6 +46,8 @@ static struct zram *zram_devices;
 
 static unsigned int num_devices = 1;
 
+static const char *default_compressor = "lzo";
+
 static inline struct zram *dev_to_zram(struct device *dev)
 {
 	return (struct zram *)dev_to_disk(dev)->private_data;
@@ -105,7 +110,51 @@ static ssize_t zero_pages_show(struct device *dev,
 {
 	struct zram *zram = dev_to_zram(dev);
 
-	return sprintf(buf, "%u\n", zram->stats.pages_zero);
+	return sprintf(buf, "%u\n", atomic_read(&zram->stats.pages_zero));
+}
+
+static ssize_t same_pages_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%u\n", atomic_read(&zram->stats.same_pages));
+}
+
+static ssize_t dedup_saved_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	s64 val = atomic64_read(&zram->stats.stored_size) -
+		  atomic64_read(&zram->stats.compr_size);
+
+	return sprintf(buf, "%llu\n", (u64)max_t(s64, val, 0));
+}
+
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%d\n", zram->use_dedup);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int ret;
+	unsigned short val;
+	struct zram *zram = dev_to_zram(dev);
+
+	ret = kstrtou16(buf, 10, &val);
+	if (ret)
+		return ret;
+
+	down_write(&zram->init_lock);
+	zram->use_dedup = !!val;
+	up_write(&zram->init_lock);
+
+	return len;
 }
 
 static ssize_t orig_data_size_show(struct device *dev,
@@ -114,7 +163,7 @@ static ssize_t orig_data_size_show(struct device *dev,
 	struct zram *zram = dev_to_zram(dev);
 
 	return sprintf(buf, "%llu\n",
-		(u64)(zram->stats.pages_stored) << PAGE_SHIFT);
+		(u64)(atomic_read(&zram->stats.pages_stored)) << PAGE_SHIFT);
 }
 
 static ssize_t compr_data_size_show(struct device *dev,
@@ -141,22 +190,187 @@ static ssize_t mem_used_total_show(struct device *dev,
 	return sprintf(buf, "%llu\n", val);
 }
 
+static ssize_t pages_compacted_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	unsigned long val = 0;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	if (zram->init_done)
+		val = zs_get_pages_compacted(zram->meta->mem_pool);
+	up_read(&zram->init_lock);
+
+	return sprintf(buf, "%lu\n", val);
+}
+
+static ssize_t compact_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	if (!zram->init_done) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	zs_compact(zram->meta->mem_pool);
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
+static ssize_t max_comp_streams_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->max_comp_streams;
+	up_read(&zram->init_lock);
+
+	return sprintf(buf, "%d\n", val);
+}
+
+static ssize_t max_comp_streams_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int num, ret;
+	struct zram *zram = dev_to_zram(dev);
+
+	ret = kstrtoint(buf, 0, &num);
+	if (ret < 0)
+		return ret;
+	if (num < 1)
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (zram->init_done && !zcomp_set_max_streams(zram->comp, num)) {
+		up_write(&zram->init_lock);
+		pr_info("Cannot change max compression streams\n");
+		return -EINVAL;
+	}
+	zram->max_comp_streams = num;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
+static ssize_t comp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->compressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t comp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[sizeof(zram->compressor)];
+	char *nl;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	nl = strchr(compressor, '\n');
+	if (nl)
+		*nl = '\0';
+
+	if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (zram->init_done) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+	strlcpy(zram->compressor, compressor, sizeof(zram->compressor));
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
+static ssize_t comp_stream_waits_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	u64 val = 0;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	if (zram->init_done)
+		val = atomic64_read(&zram->comp->strm_waits);
+	up_read(&zram->init_lock);
+
+	return sprintf(buf, "%llu\n", val);
+}
+
+static ssize_t slot_contended_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%llu\n",
+			(u64)atomic64_read(&zram->stats.slot_contended));
+}
+
+static void zram_lock_table(struct zram *zram, u32 index)
+{
+	unsigned long *value = &zram->meta->table[index].value;
+
+	if (unlikely(!bit_spin_trylock(ZRAM_ACCESS, value))) {
+		atomic64_inc(&zram->stats.slot_contended);
+		bit_spin_lock(ZRAM_ACCESS, value);
+	}
+}
+
+static void zram_unlock_table(struct zram *zram, u32 index)
+{
+	bit_spin_unlock(ZRAM_ACCESS, &zram->meta->table[index].value);
+}
+
 static int zram_test_flag(struct zram_meta *meta, u32 index,
 			enum zram_pageflags flag)
 {
-	return meta->table[index].flags & BIT(flag);
+	return meta->table[index].value & BIT(flag);
 }
 
 static void zram_set_flag(struct zram_meta *meta, u32 index,
 			enum zram_pageflags flag)
 {
-	meta->table[index].flags |= BIT(flag);
+	meta->table[index].value |= BIT(flag);
 }
 
 static void zram_clear_flag(struct zram_meta *meta, u32 index,
 			enum zram_pageflags flag)
 {
-	meta->table[index].flags &= ~BIT(flag);
+	meta->table[index].value &= ~BIT(flag);
+}
+
+static size_t zram_get_obj_size(struct zram_meta *meta, u32 index)
+{
+	return meta->table[index].value & (BIT(ZRAM_FLAG_SHIFT) - 1);
+}
+
+static void zram_set_obj_size(struct zram_meta *meta, u32 index, size_t size)
+{
+	unsigned long flags = meta->table[index].value >> ZRAM_FLAG_SHIFT;
+
+	meta->table[index].value = (flags << ZRAM_FLAG_SHIFT) | size;
+}
+
+static void zram_update_access(struct zram_meta *meta, u32 index)
+{
+#ifdef CONFIG_ZRAM_WRITEBACK
+	meta->table[index].ac_time = jiffies;
+#endif
 }
 
 static inline int is_partial_io(struct bio_vec *bvec)
@@ -164,6 +378,457 @@ static inline int is_partial_io(struct bio_vec *bvec)
 	return bvec->bv_len != PAGE_SIZE;
 }
 
+static void zram_bio_ctx_put(struct zram_bio_ctx *ctx)
+{
+	if (!atomic_dec_and_test(&ctx->pending))
+		return;
+
+	if (ctx->error) {
+		bio_io_error(ctx->parent);
+	} else {
+		set_bit(BIO_UPTODATE, &ctx->parent->bi_flags);
+		bio_endio(ctx->parent, 0);
+	}
+	kfree(ctx);
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+static void reset_bdev(struct zram *zram)
+{
+	if (!zram->backing_dev)
+		return;
+
+	set_blocksize(zram->bdev, zram->old_block_size);
+	blkdev_put(zram->bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	filp_close(zram->backing_dev, NULL);
+	vfree(zram->bitmap);
+
+	zram->backing_dev = NULL;
+	zram->bdev = NULL;
+	zram->old_block_size = 0;
+	zram->bitmap = NULL;
+	zram->rd_bitmap = NULL;
+	zram->free_bitmap = NULL;
+	zram->nr_pages = 0;
+}
+
+static ssize_t backing_dev_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char *p;
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	if (!zram->backing_dev) {
+		up_read(&zram->init_lock);
+		return scnprintf(buf, PAGE_SIZE, "none\n");
+	}
+
+	p = d_path(&zram->backing_dev->f_path, buf, PAGE_SIZE - 1);
+	if (IS_ERR(p)) {
+		ret = PTR_ERR(p);
+		goto out;
+	}
+
+	ret = strlen(p);
+	memmove(buf, p, ret);
+	buf[ret++] = '\n';
+out:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t backing_dev_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	char *file_name, *nl;
+	struct file *backing_dev;
+	struct inode *inode;
+	struct block_device *bdev;
+	unsigned long nr_pages, nr_longs, *bitmap;
+	struct zram *zram = dev_to_zram(dev);
+	int err;
+
+	file_name = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (!file_name)
+		return -ENOMEM;
+
+	strlcpy(file_name, buf, PATH_MAX);
+	nl = strchr(file_name, '\n');
+	if (nl)
+		*nl = '\0';
+
+	down_write(&zram->init_lock);
+	if (zram->init_done) {
+		pr_info("Can't setup backing device for initialized device\n");
+		err = -EBUSY;
+		goto out;
+	}
+
+	backing_dev = filp_open(file_name, O_RDWR | O_LARGEFILE, 0);
+	if (IS_ERR(backing_dev)) {
+		err = PTR_ERR(backing_dev);
+		goto out;
+	}
+
+	inode = backing_dev->f_mapping->host;
+	if (!S_ISBLK(inode->i_mode)) {
+		err = -ENOTBLK;
+		goto out_close;
+	}
+
+	bdev = bdgrab(I_BDEV(inode));
+	err = blkdev_get(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL, zram);
+	if (err < 0)
+		goto out_close;
+
+	nr_pages = i_size_read(inode) >> PAGE_SHIFT;
+	nr_longs = BITS_TO_LONGS(nr_pages);
+	bitmap = vzalloc(3 * nr_longs * sizeof(long));
+	if (!bitmap) {
+		err = -ENOMEM;
+		goto out_put;
+	}
+
+	reset_bdev(zram);
+
+	zram->old_block_size = block_size(bdev);
+	err = set_blocksize(bdev, PAGE_SIZE);
+	if (err) {
+		vfree(bitmap);
+		goto out_put;
+	}
+
+	zram->backing_dev = backing_dev;
+	zram->bdev = bdev;
+	zram->bitmap = bitmap;
+	zram->rd_bitmap = bitmap + nr_longs;
+	zram->free_bitmap = bitmap + 2 * nr_longs;
+	zram->nr_pages = nr_pages;
+	up_write(&zram->init_lock);
+
+	pr_info("setup backing device %s\n", file_name);
+	kfree(file_name);
+	return len;
+
+out_put:
+	blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+out_close:
+	filp_close(backing_dev, NULL);
+out:
+	up_write(&zram->init_lock);
+	kfree(file_name);
+	return err;
+}
+
+static ssize_t idle_age_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%u\n", zram->idle_age);
+}
+
+static ssize_t idle_age_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret)
+		return ret;
+
+	zram->idle_age = val;
+	return len;
+}
+
+static ssize_t bd_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sprintf(buf, "%8llu %8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.bd_count),
+			(u64)atomic64_read(&zram->stats.bd_reads),
+			(u64)atomic64_read(&zram->stats.bd_writes));
+}
+
+static unsigned long alloc_block_bdev(struct zram *zram)
+{
+	unsigned long blk_idx = 1;
+
+retry:
+	blk_idx = find_next_zero_bit(zram->bitmap, zram->nr_pages, blk_idx);
+	if (blk_idx >= zram->nr_pages)
+		return 0;
+
+	if (test_and_set_bit(blk_idx, zram->bitmap))
+		goto retry;
+
+	atomic64_inc(&zram->stats.bd_count);
+	return blk_idx;
+}
+
+static void __free_block_bdev(struct zram *zram, unsigned long blk_idx)
+{
+	int was_set;
+
+	was_set = test_and_clear_bit(blk_idx, zram->bitmap);
+	WARN_ON_ONCE(!was_set);
+	atomic64_dec(&zram->stats.bd_count);
+}
+
+/*
+ * A block that is still being read is only marked here; the read
+ * completion hands it back to the allocator.
+ */
+static void free_block_bdev(struct zram *zram, unsigned long blk_idx)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&zram->bd_lock, flags);
+	if (test_bit(blk_idx, zram->rd_bitmap))
+		set_bit(blk_idx, zram->free_bitmap);
+	else
+		__free_block_bdev(zram, blk_idx);
+	spin_unlock_irqrestore(&zram->bd_lock, flags);
+}
+
+/*
+ * Must be called with the slot that owns @blk_idx locked, so the block
+ * cannot be freed under the caller. Only one read of a block may be in
+ * flight; on failure drop the slot lock and zram_bd_read_wait().
+ */
+static bool zram_bd_read_start(struct zram *zram, unsigned long blk_idx)
+{
+	return !test_and_set_bit(blk_idx, zram->rd_bitmap);
+}
+
+static void zram_bd_read_end(struct zram *zram, unsigned long blk_idx)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&zram->bd_lock, flags);
+	clear_bit(blk_idx, zram->rd_bitmap);
+	smp_mb__after_clear_bit();
+	if (test_and_clear_bit(blk_idx, zram->free_bitmap))
+		__free_block_bdev(zram, blk_idx);
+	spin_unlock_irqrestore(&zram->bd_lock, flags);
+
+	wake_up_bit(&zram->rd_bitmap[BIT_WORD(blk_idx)],
+		    blk_idx % BITS_PER_LONG);
+}
+
+static int zram_bd_wait_action(void *word)
+{
+	io_schedule();
+	return 0;
+}
+
+static void zram_bd_read_wait(struct zram *zram, unsigned long blk_idx)
+{
+	wait_on_bit(&zram->rd_bitmap[BIT_WORD(blk_idx)],
+		    blk_idx % BITS_PER_LONG, zram_bd_wait_action,
+		    TASK_UNINTERRUPTIBLE);
+}
+
+struct zram_sync_io {
+	struct completion done;
+	int error;
+};
+
+static void zram_sync_end_io(struct bio *bio, int err)
+{
+	struct zram_sync_io *io = bio->bi_private;
+
+	if (!err && !test_bit(BIO_UPTODATE, &bio->bi_flags))
+		err = -EIO;
+	io->error = err;
+	complete(&io->done);
+}
+
+static int zram_bdev_rw_sync(struct zram *zram, struct page *page,
+			unsigned long blk_idx, int rw)
+{
+	struct zram_sync_io io;
+	struct bio *bio;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_sector = blk_idx * (PAGE_SIZE >> SECTOR_SHIFT);
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+
+	init_completion(&io.done);
+	io.error = 0;
+	bio->bi_private = &io;
+	bio->bi_end_io = zram_sync_end_io;
+	submit_bio(rw, bio);
+	wait_for_completion(&io.done);
+	bio_put(bio);
+
+	if (!io.error)
+		atomic64_inc(rw == READ ? &zram->stats.bd_reads :
+					  &zram->stats.bd_writes);
+	return io.error;
+}
+
+struct zram_rd_io {
+	struct zram_bio_ctx *ctx;
+	unsigned long blk_idx;
+};
+
+static void zram_read_end_io(struct bio *bio, int err)
+{
+	struct zram_rd_io *io = bio->bi_private;
+	struct zram_bio_ctx *ctx = io->ctx;
+
+	if (err || !test_bit(BIO_UPTODATE, &bio->bi_flags))
+		ctx->error = -EIO;
+	else
+		flush_dcache_page(bio->bi_io_vec[0].bv_page);
+
+	zram_bd_read_end(ctx->zram, io->blk_idx);
+	kfree(io);
+	bio_put(bio);
+	zram_bio_ctx_put(ctx);
+}
+
+static struct zram_bio_ctx *zram_bio_ctx_alloc(struct zram *zram,
+					struct bio *bio)
+{
+	struct zram_bio_ctx *ctx;
+
+	if (!zram->backing_dev)
+		return NULL;
+
+	ctx = kmalloc(sizeof(*ctx), GFP_NOIO | __GFP_NOWARN);
+	if (!ctx)
+		return NULL;
+
+	ctx->zram = zram;
+	ctx->parent = bio;
+	atomic_set(&ctx->pending, 1);
+	ctx->error = 0;
+	return ctx;
+}
+
+static int read_page_from_bdev(struct zram *zram, char *mem,
+			unsigned long blk_idx)
+{
+	struct page *page;
+	int ret;
+
+	page = alloc_page(GFP_NOIO);
+	if (!page)
+		return -ENOMEM;
+
+	ret = zram_bdev_rw_sync(zram, page, blk_idx, READ);
+	if (!ret)
+		copy_page(mem, page_address(page));
+	__free_page(page);
+	return ret;
+}
+
+static int read_from_bdev(struct zram *zram, struct bio_vec *bvec,
+			unsigned long blk_idx, int offset,
+			struct bio *parent, struct zram_bio_ctx **ctxp)
+{
+	struct zram_bio_ctx *ctx = *ctxp;
+	struct zram_rd_io *io;
+	struct bio *bio;
+	char *buf, *user_mem;
+	int ret;
+
+	if (!ctx && !is_partial_io(bvec))
+		ctx = *ctxp = zram_bio_ctx_alloc(zram, parent);
+
+	if (!ctx || is_partial_io(bvec))
+		goto sync;
+
+	io = kmalloc(sizeof(*io), GFP_NOIO | __GFP_NOWARN);
+	if (!io)
+		goto sync;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio) {
+		kfree(io);
+		goto sync;
+	}
+
+	bio->bi_sector = blk_idx * (PAGE_SIZE >> SECTOR_SHIFT);
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, bvec->bv_page, bvec->bv_len, bvec->bv_offset)) {
+		bio_put(bio);
+		kfree(io);
+		ret = -EIO;
+		goto out;
+	}
+
+	io->ctx = ctx;
+	io->blk_idx = blk_idx;
+	atomic_inc(&ctx->pending);
+	bio->bi_private = io;
+	bio->bi_end_io = zram_read_end_io;
+	submit_bio(READ, bio);
+	atomic64_inc(&zram->stats.bd_reads);
+	return 0;
+
+sync:
+	buf = kmalloc(PAGE_SIZE, GFP_NOIO);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = read_page_from_bdev(zram, buf, blk_idx);
+	if (!ret) {
+		user_mem = kmap_atomic(bvec->bv_page);
+		memcpy(user_mem + bvec->bv_offset, buf + offset,
+				bvec->bv_len);
+		kunmap_atomic(user_mem);
+		flush_dcache_page(bvec->bv_page);
+	}
+	kfree(buf);
+out:
+	zram_bd_read_end(zram, blk_idx);
+	return ret;
+}
+#else
+static inline void reset_bdev(struct zram *zram) {}
+static inline void free_block_bdev(struct zram *zram, unsigned long blk_idx) {}
+static inline bool zram_bd_read_start(struct zram *zram,
+				      unsigned long blk_idx)
+{
+	return true;
+}
+static inline void zram_bd_read_end(struct zram *zram,
+				    unsigned long blk_idx) {}
+static inline void zram_bd_read_wait(struct zram *zram,
+				     unsigned long blk_idx) {}
+
+static inline int read_page_from_bdev(struct zram *zram, char *mem,
+			unsigned long blk_idx)
+{
+	return -EIO;
+}
+
+static inline int read_from_bdev(struct zram *zram, struct bio_vec *bvec,
+			unsigned long blk_idx, int offset,
+			struct bio *parent, struct zram_bio_ctx **ctxp)
+{
+	return -EIO;
+}
+#endif
+
 static inline int valid_io_request(struct zram *zram, struct bio *bio)
 {
 	u64 start, end, bound;
@@ -187,53 +852,44 @@ static inline int valid_io_request(struct zram *zram, struct bio *bio)
 
 static void zram_meta_free(struct zram_meta *meta)
 {
+	zram_dedup_fini(meta);
 	zs_destroy_pool(meta->mem_pool);
-	kfree(meta->compress_workmem);
-	free_pages((unsigned long)meta->compress_buffer, 1);
 	vfree(meta->table);
 	kfree(meta);
 }
 
-static struct zram_meta *zram_meta_alloc(u64 disksize)
+static struct zram_meta *zram_meta_alloc(const char *pool_name, u64 disksize)
 {
 	size_t num_pages;
 	struct zram_meta *meta = kmalloc(sizeof(*meta), GFP_KERNEL);
 	if (!meta)
 		goto out;
 
-	meta->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
-	if (!meta->compress_workmem)
-		goto free_meta;
-
-	meta->compress_buffer =
-		(void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, 1);
-	if (!meta->compress_buffer) {
-		pr_err("Error allocating compressor buffer space\n");
-		goto free_workmem;
-	}
-
 	num_pages = disksize >> PAGE_SHIFT;
 	meta->table = vzalloc(num_pages * sizeof(*meta->table));
 	if (!meta->table) {
 		pr_err("Error allocating zram address table\n");
-		goto free_buffer;
+		goto free_meta;
 	}
 
-	meta->mem_pool = zs_create_pool(GFP_NOIO | __GFP_HIGHMEM |
+	meta->mem_pool = zs_create_pool(pool_name, GFP_NOIO | __GFP_HIGHMEM |
 					__GFP_NOWARN);
 	if (!meta->mem_pool) {
 		pr_err("Error creating memory pool\n");
 		goto free_table;
 	}
 
+	if (zram_dedup_init(meta, num_pages)) {
+		pr_err("Error allocating zram dedup hash\n");
+		goto free_pool;
+	}
+
 	return meta;
 
+free_pool:
+	zs_destroy_pool(meta->mem_pool);
 free_table:
 	vfree(meta->table);
-free_buffer:
-	free_pages((unsigned long)meta->compress_buffer, 1);
-free_workmem:
-	kfree(meta->compress_workmem);
 free_meta:
 	kfree(meta);
 	meta = NULL;
@@ -248,88 +904,184 @@ static void update_position(u32 *index, int *offset, struct bio_vec *bvec)
 	*offset = (*offset + bvec->bv_len) % PAGE_SIZE;
 }
 
-static int page_zero_filled(void *ptr)
+static int page_same_filled(void *ptr, unsigned long *element)
 {
 	unsigned int pos;
 	unsigned long *page;
 
 	page = (unsigned long *)ptr;
 
-	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
-		if (page[pos])
+	for (pos = 1; pos != PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos] != page[0])
 			return 0;
 	}
 
+	*element = page[0];
 	return 1;
 }
 
-static void handle_zero_page(struct bio_vec *bvec)
+static void zram_fill_page(void *ptr, unsigned long len,
+			unsigned long element)
+{
+	unsigned long *page = ptr;
+	unsigned long pos;
+
+	if (!element) {
+		memset(ptr, 0, len);
+		return;
+	}
+
+	for (pos = 0; pos < len / sizeof(*page); pos++)
+		page[pos] = element;
+}
+
+static void handle_same_page(struct bio_vec *bvec, unsigned long element)
 {
 	struct page *page = bvec->bv_page;
 	void *user_mem;
 
 	user_mem = kmap_atomic(page);
-	if (is_partial_io(bvec))
-		memset(user_mem + bvec->bv_offset, 0, bvec->bv_len);
-	else
-		clear_page(user_mem);
+	zram_fill_page(user_mem + bvec->bv_offset, bvec->bv_len, element);
 	kunmap_atomic(user_mem);
 
 	flush_dcache_page(page);
 }
 
+static struct zram_entry *zram_entry_alloc(struct zram *zram,
+					unsigned int len)
+{
+	struct zram_entry *entry;
+	unsigned long handle;
+
+	handle = zs_malloc(zram->meta->mem_pool, len);
+	if (!handle)
+		return NULL;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry) {
+		zs_free(zram->meta->mem_pool, handle);
+		return NULL;
+	}
+
+	RB_CLEAR_NODE(&entry->rb_node);
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = 0;
+	atomic_set(&entry->refcount, 1);
+
+	atomic64_add(len, &zram->stats.compr_size);
+	return entry;
+}
+
+void zram_entry_put(struct zram *zram, struct zram_entry *entry)
+{
+	if (zram_dedup_put(zram, entry))
+		return;
+
+	zs_free(zram->meta->mem_pool, entry->handle);
+	atomic64_sub(entry->len, &zram->stats.compr_size);
+	kfree(entry);
+}
+
 static void zram_free_page(struct zram *zram, size_t index)
 {
 	struct zram_meta *meta = zram->meta;
-	unsigned long handle = meta->table[index].handle;
-	u16 size = meta->table[index].size;
+	struct zram_entry *entry;
+	size_t size;
 
-	if (unlikely(!handle)) {
-		if (zram_test_flag(meta, index, ZRAM_ZERO)) {
-			zram_clear_flag(meta, index, ZRAM_ZERO);
-			zram->stats.pages_zero--;
-		}
+	zram_clear_flag(meta, index, ZRAM_HUGE);
+	zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		zram_clear_flag(meta, index, ZRAM_WB);
+		free_block_bdev(zram, meta->table[index].element);
+		meta->table[index].element = 0;
 		return;
 	}
 
-	if (unlikely(size > max_zpage_size))
-		zram->stats.bad_compress--;
+	if (zram_test_flag(meta, index, ZRAM_SAME)) {
+		zram_clear_flag(meta, index, ZRAM_SAME);
+		if (!meta->table[index].element)
+			atomic_dec(&zram->stats.pages_zero);
+		meta->table[index].element = 0;
+		atomic_dec(&zram->stats.same_pages);
+		return;
+	}
 
-	zs_free(meta->mem_pool, handle);
+	entry = meta->table[index].entry;
+	if (unlikely(!entry))
+		return;
 
+	size = zram_get_obj_size(meta, index);
+	if (unlikely(size > max_zpage_size))
+		atomic_dec(&zram->stats.bad_compress);
 	if (size <= PAGE_SIZE / 2)
-		zram->stats.good_compress--;
+		atomic_dec(&zram->stats.good_compress);
 
-	atomic64_sub(meta->table[index].size, &zram->stats.compr_size);
-	zram->stats.pages_stored--;
+	zram_entry_put(zram, entry);
 
-	meta->table[index].handle = 0;
-	meta->table[index].size = 0;
+	atomic64_sub(size, &zram->stats.stored_size);
+	atomic_dec(&zram->stats.pages_stored);
+
+	meta->table[index].entry = NULL;
+	zram_set_obj_size(meta, index, 0);
 }
 
-static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
+static int zram_decompress_page(struct zram *zram, char *mem, u32 index,
+				bool may_sleep)
 {
-	int ret = LZO_E_OK;
-	size_t clen = PAGE_SIZE;
+	int ret = 0;
 	unsigned char *cmem;
 	struct zram_meta *meta = zram->meta;
-	unsigned long handle = meta->table[index].handle;
+	struct zram_entry *entry;
+	size_t size;
+
+again:
+	zram_lock_table(zram, index);
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		unsigned long blk_idx = meta->table[index].element;
+
+		if (!may_sleep) {
+			zram_unlock_table(zram, index);
+			return -EAGAIN;
+		}
+		if (!zram_bd_read_start(zram, blk_idx)) {
+			zram_unlock_table(zram, index);
+			zram_bd_read_wait(zram, blk_idx);
+			goto again;
+		}
+		zram_unlock_table(zram, index);
+		ret = read_page_from_bdev(zram, mem, blk_idx);
+		zram_bd_read_end(zram, blk_idx);
+		return ret;
+	}
+
+	if (zram_test_flag(meta, index, ZRAM_SAME)) {
+		unsigned long element = meta->table[index].element;
 
-	if (!handle || zram_test_flag(meta, index, ZRAM_ZERO)) {
+		zram_unlock_table(zram, index);
+		zram_fill_page(mem, PAGE_SIZE, element);
+		return 0;
+	}
+
+	entry = meta->table[index].entry;
+	size = zram_get_obj_size(meta, index);
+	if (!entry) {
+		zram_unlock_table(zram, index);
 		clear_page(mem);
 		return 0;
 	}
 
-	cmem = zs_map_object(meta->mem_pool, handle, ZS_MM_RO);
-	if (meta->table[index].size == PAGE_SIZE)
+	cmem = zs_map_object(meta->mem_pool, entry->handle, ZS_MM_RO);
+	if (size == PAGE_SIZE)
 		copy_page(mem, cmem);
 	else
-		ret = lzo1x_decompress_safe(cmem, meta->table[index].size,
-						mem, &clen);
-	zs_unmap_object(meta->mem_pool, handle);
+		ret = zcomp_decompress(zram->comp, cmem, size, mem);
+	zs_unmap_object(meta->mem_pool, entry->handle);
+	zram_unlock_table(zram, index);
 
 	
-	if (unlikely(ret != LZO_E_OK)) {
+	if (unlikely(ret)) {
 		pr_err("Decompression failed! err=%d, page=%u\n", ret, index);
 		atomic64_inc(&zram->stats.failed_reads);
 		return ret;
@@ -339,19 +1091,44 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 }
 
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
-			  u32 index, int offset, struct bio *bio)
+			  u32 index, int offset, struct bio *parent,
+			  struct zram_bio_ctx **ctxp)
 {
 	int ret;
 	struct page *page;
-	unsigned char *user_mem, *uncmem = NULL;
+	unsigned char *user_mem, *uncmem;
 	struct zram_meta *meta = zram->meta;
 	page = bvec->bv_page;
 
-	if (unlikely(!meta->table[index].handle) ||
-			zram_test_flag(meta, index, ZRAM_ZERO)) {
-		handle_zero_page(bvec);
+again:
+	uncmem = NULL;
+	zram_lock_table(zram, index);
+	zram_update_access(meta, index);
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		unsigned long blk_idx = meta->table[index].element;
+
+		if (!zram_bd_read_start(zram, blk_idx)) {
+			zram_unlock_table(zram, index);
+			zram_bd_read_wait(zram, blk_idx);
+			goto again;
+		}
+		zram_unlock_table(zram, index);
+		return read_from_bdev(zram, bvec, blk_idx, offset, parent,
+				      ctxp);
+	}
+	if (zram_test_flag(meta, index, ZRAM_SAME)) {
+		unsigned long element = meta->table[index].element;
+
+		zram_unlock_table(zram, index);
+		handle_same_page(bvec, element);
+		return 0;
+	}
+	if (unlikely(!meta->table[index].entry)) {
+		zram_unlock_table(zram, index);
+		handle_same_page(bvec, 0);
 		return 0;
 	}
+	zram_unlock_table(zram, index);
 
 	if (is_partial_io(bvec))
 		
@@ -367,9 +1144,9 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 		goto out_cleanup;
 	}
 
-	ret = zram_decompress_page(zram, uncmem, index);
+	ret = zram_decompress_page(zram, uncmem, index, false);
 	
-	if (unlikely(ret != LZO_E_OK))
+	if (unlikely(ret))
 		goto out_cleanup;
 
 	if (is_partial_io(bvec))
@@ -382,6 +1159,8 @@ out_cleanup:
 	kunmap_atomic(user_mem);
 	if (is_partial_io(bvec))
 		kfree(uncmem);
+	if (ret == -EAGAIN)
+		goto again;
 	return ret;
 }
 
@@ -390,14 +1169,16 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 {
 	int ret = 0;
 	size_t clen;
-	unsigned long handle;
+	unsigned long element;
+	u32 checksum = 0;
 	struct page *page;
 	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
 	struct zram_meta *meta = zram->meta;
+	struct zram_entry *entry;
+	struct zcomp_strm *zstrm = NULL;
 	static unsigned long zram_rs_time;
 
 	page = bvec->bv_page;
-	src = meta->compress_buffer;
 
 	if (is_partial_io(bvec)) {
 		uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
@@ -405,11 +1186,12 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			ret = -ENOMEM;
 			goto out;
 		}
-		ret = zram_decompress_page(zram, uncmem, index);
+		ret = zram_decompress_page(zram, uncmem, index, true);
 		if (ret)
 			goto out;
 	}
 
+	zstrm = zcomp_strm_find(zram->comp);
 	user_mem = kmap_atomic(page);
 
 	if (is_partial_io(bvec)) {
@@ -421,23 +1203,36 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		uncmem = user_mem;
 	}
 
-	if (page_zero_filled(uncmem)) {
-		kunmap_atomic(user_mem);
+	if (page_same_filled(uncmem, &element)) {
+		if (user_mem)
+			kunmap_atomic(user_mem);
 		
+		zram_lock_table(zram, index);
 		zram_free_page(zram, index);
-
-		zram->stats.pages_zero++;
-		zram_set_flag(meta, index, ZRAM_ZERO);
+		zram_set_flag(meta, index, ZRAM_SAME);
+		meta->table[index].element = element;
+		zram_update_access(meta, index);
+		zram_unlock_table(zram, index);
+
+		atomic_inc(&zram->stats.same_pages);
+		if (!element)
+			atomic_inc(&zram->stats.pages_zero);
 		ret = 0;
 		goto out;
 	}
 
-	if (unlikely(meta->table[index].handle ||
-			zram_test_flag(meta, index, ZRAM_ZERO)))
-		zram_free_page(zram, index);
+	if (zram->use_dedup) {
+		checksum = zram_dedup_checksum(uncmem);
+		entry = zram_dedup_get(zram, uncmem, checksum, zstrm->buffer);
+		if (entry) {
+			if (user_mem)
+				kunmap_atomic(user_mem);
+			clen = entry->len;
+			goto found_dup;
+		}
+	}
 
-	ret = lzo1x_1_compress(uncmem, PAGE_SIZE, src, &clen,
-			       meta->compress_workmem);
+	ret = zcomp_compress(zram->comp, zstrm, uncmem, &clen);
 
 	if (!is_partial_io(bvec)) {
 		kunmap_atomic(user_mem);
@@ -445,21 +1240,21 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		uncmem = NULL;
 	}
 
-	if (unlikely(ret != LZO_E_OK)) {
+	if (unlikely(ret)) {
 		pr_err("Compression failed! err=%d\n", ret);
 		goto out;
 	}
 
+	src = zstrm->buffer;
 	if (unlikely(clen > max_zpage_size)) {
-		zram->stats.bad_compress++;
 		clen = PAGE_SIZE;
 		src = NULL;
 		if (is_partial_io(bvec))
 			src = uncmem;
 	}
 
-	handle = zs_malloc(meta->mem_pool, clen);
-	if (!handle) {
+	entry = zram_entry_alloc(zram, clen);
+	if (!entry) {
 		if (printk_timed_ratelimit(&zram_rs_time,
 					   ALLOC_ERROR_LOG_RATE_MS))
 			pr_info("Error allocating memory for compressed page: %u, size=%zu\n",
@@ -467,7 +1262,7 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		ret = -ENOMEM;
 		goto out;
 	}
-	cmem = zs_map_object(meta->mem_pool, handle, ZS_MM_WO);
+	cmem = zs_map_object(meta->mem_pool, entry->handle, ZS_MM_WO);
 
 	if ((clen == PAGE_SIZE) && !is_partial_io(bvec)) {
 		src = kmap_atomic(page);
@@ -477,20 +1272,35 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		memcpy(cmem, src, clen);
 	}
 
-	zs_unmap_object(meta->mem_pool, handle);
+	zcomp_strm_release(zram->comp, zstrm);
+	zstrm = NULL;
+	zs_unmap_object(meta->mem_pool, entry->handle);
+
+	if (zram->use_dedup)
+		zram_dedup_insert(zram, entry, checksum);
 
+found_dup:
+	zram_lock_table(zram, index);
 	zram_free_page(zram, index);
 
-	meta->table[index].handle = handle;
-	meta->table[index].size = clen;
+	meta->table[index].entry = entry;
+	zram_set_obj_size(meta, index, clen);
+	if (clen == PAGE_SIZE)
+		zram_set_flag(meta, index, ZRAM_HUGE);
+	zram_update_access(meta, index);
+	zram_unlock_table(zram, index);
 
 	
-	atomic64_add(clen, &zram->stats.compr_size);
-	zram->stats.pages_stored++;
+	atomic64_add(clen, &zram->stats.stored_size);
+	atomic_inc(&zram->stats.pages_stored);
 	if (clen <= PAGE_SIZE / 2)
-		zram->stats.good_compress++;
+		atomic_inc(&zram->stats.good_compress);
+	if (unlikely(clen > max_zpage_size))
+		atomic_inc(&zram->stats.bad_compress);
 
 out:
+	if (zstrm)
+		zcomp_strm_release(zram->comp, zstrm);
 	if (is_partial_io(bvec))
 		kfree(uncmem);
 
@@ -499,36 +1309,125 @@ out:
 	return ret;
 }
 
-static void handle_pending_slot_free(struct zram *zram)
+#ifdef CONFIG_ZRAM_WRITEBACK
+static bool zram_wb_candidate(struct zram *zram, u32 index, bool huge)
 {
-	struct zram_slot_free *free_rq;
+	struct zram_meta *meta = zram->meta;
+
+	if (zram_test_flag(meta, index, ZRAM_SAME) ||
+	    zram_test_flag(meta, index, ZRAM_WB) ||
+	    zram_test_flag(meta, index, ZRAM_UNDER_WB) ||
+	    !meta->table[index].entry)
+		return false;
+
+	if (huge)
+		return zram_test_flag(meta, index, ZRAM_HUGE);
+
+	return time_after_eq(jiffies, meta->table[index].ac_time +
+				(unsigned long)zram->idle_age * HZ);
+}
+
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	unsigned long nr_pages, blk_idx;
+	struct page *page;
+	ssize_t ret = len;
+	bool huge;
+	u32 index;
+	int err;
+
+	if (sysfs_streq(buf, "idle"))
+		huge = false;
+	else if (sysfs_streq(buf, "huge"))
+		huge = true;
+	else
+		return -EINVAL;
+
+	/*
+	 * ZRAM_UNDER_WB only tells a writer whether the slot changed under
+	 * it if no other writer can set the flag again meanwhile.
+	 */
+	mutex_lock(&zram->wb_lock);
+	down_read(&zram->init_lock);
+	if (!zram->init_done) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	if (!zram->backing_dev) {
+		ret = -ENODEV;
+		goto out_unlock;
+	}
 
-	spin_lock(&zram->slot_free_lock);
-	while (zram->slot_free_rq) {
-		free_rq = zram->slot_free_rq;
-		zram->slot_free_rq = free_rq->next;
-		zram_free_page(zram, free_rq->index);
-		kfree(free_rq);
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto out_unlock;
 	}
-	spin_unlock(&zram->slot_free_lock);
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		zram_lock_table(zram, index);
+		if (!zram_wb_candidate(zram, index, huge)) {
+			zram_unlock_table(zram, index);
+			continue;
+		}
+		zram_set_flag(meta, index, ZRAM_UNDER_WB);
+		zram_unlock_table(zram, index);
+
+		blk_idx = alloc_block_bdev(zram);
+		if (!blk_idx) {
+			ret = -ENOSPC;
+			err = -ENOSPC;
+		} else {
+			err = zram_decompress_page(zram, page_address(page),
+						index, true);
+			if (!err)
+				err = zram_bdev_rw_sync(zram, page, blk_idx,
+							WRITE);
+		}
+
+		zram_lock_table(zram, index);
+		if (err || !zram_test_flag(meta, index, ZRAM_UNDER_WB)) {
+			zram_clear_flag(meta, index, ZRAM_UNDER_WB);
+			zram_unlock_table(zram, index);
+			if (blk_idx)
+				free_block_bdev(zram, blk_idx);
+			if (ret == -ENOSPC)
+				break;
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_set_flag(meta, index, ZRAM_WB);
+		meta->table[index].element = blk_idx;
+		zram_unlock_table(zram, index);
+
+		cond_resched();
+	}
+
+	__free_page(page);
+out_unlock:
+	up_read(&zram->init_lock);
+	mutex_unlock(&zram->wb_lock);
+	return ret;
 }
+#endif
 
 static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
-			int offset, struct bio *bio, int rw)
+			int offset, struct bio *bio, struct zram_bio_ctx **ctxp,
+			int rw)
 {
 	int ret;
 
-	if (rw == READ) {
-		down_read(&zram->lock);
-		handle_pending_slot_free(zram);
-		ret = zram_bvec_read(zram, bvec, index, offset, bio);
-		up_read(&zram->lock);
-	} else {
-		down_write(&zram->lock);
-		handle_pending_slot_free(zram);
+	if (rw == READ)
+		ret = zram_bvec_read(zram, bvec, index, offset, bio, ctxp);
+	else
 		ret = zram_bvec_write(zram, bvec, index, offset);
-		up_write(&zram->lock);
-	}
 
 	return ret;
 }
@@ -538,8 +1437,6 @@ static void zram_reset_device(struct zram *zram, bool reset_capacity)
 	size_t index;
 	struct zram_meta *meta;
 
-	flush_work(&zram->free_work);
-
 	down_write(&zram->init_lock);
 	if (!zram->init_done) {
 		up_write(&zram->init_lock);
@@ -550,15 +1447,13 @@ static void zram_reset_device(struct zram *zram, bool reset_capacity)
 	zram->init_done = 0;
 
 	
-	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
-		unsigned long handle = meta->table[index].handle;
-		if (!handle)
-			continue;
-
-		zs_free(meta->mem_pool, handle);
-	}
+	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++)
+		zram_free_page(zram, index);
 
-	zram_meta_free(zram->meta);
+	reset_bdev(zram);
+	zcomp_destroy(zram->comp);
+	zram->comp = NULL;
+	zram_meta_free(meta);
 	zram->meta = NULL;
 	
 	memset(&zram->stats, 0, sizeof(zram->stats));
@@ -569,7 +1464,8 @@ static void zram_reset_device(struct zram *zram, bool reset_capacity)
 	up_write(&zram->init_lock);
 }
 
-static void zram_init_device(struct zram *zram, struct zram_meta *meta)
+static void zram_init_device(struct zram *zram, struct zram_meta *meta,
+			struct zcomp *comp)
 {
 	if (zram->disksize > 2 * (totalram_pages << PAGE_SHIFT)) {
 		pr_info(
@@ -589,6 +1485,7 @@ static void zram_init_device(struct zram *zram, struct zram_meta *meta)
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, zram->disk->queue);
 
 	zram->meta = meta;
+	zram->comp = comp;
 	zram->init_done = 1;
 
 	pr_debug("Initialization done!\n");
@@ -599,28 +1496,45 @@ static ssize_t disksize_store(struct device *dev,
 {
 	u64 disksize;
 	struct zram_meta *meta;
+	struct zcomp *comp;
 	struct zram *zram = dev_to_zram(dev);
+	int err;
 
 	disksize = memparse(buf, NULL);
 	if (!disksize)
 		return -EINVAL;
 
 	disksize = PAGE_ALIGN(disksize);
-	meta = zram_meta_alloc(disksize);
+	meta = zram_meta_alloc(zram->disk->disk_name, disksize);
+	if (!meta)
+		return -ENOMEM;
+
 	down_write(&zram->init_lock);
 	if (zram->init_done) {
-		up_write(&zram->init_lock);
-		zram_meta_free(meta);
 		pr_info("Cannot change disksize for initialized device\n");
-		return -EBUSY;
+		err = -EBUSY;
+		goto out_free_meta;
+	}
+
+	comp = zcomp_create(zram->compressor, zram->max_comp_streams);
+	if (IS_ERR(comp)) {
+		pr_info("Cannot initialise %s compressing backend\n",
+				zram->compressor);
+		err = PTR_ERR(comp);
+		goto out_free_meta;
 	}
 
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
-	zram_init_device(zram, meta);
+	zram_init_device(zram, meta, comp);
 	up_write(&zram->init_lock);
 
 	return len;
+
+out_free_meta:
+	up_write(&zram->init_lock);
+	zram_meta_free(meta);
+	return err;
 }
 
 static ssize_t reset_store(struct device *dev,
@@ -658,6 +1572,7 @@ static void __zram_make_request(struct zram *zram, struct bio *bio, int rw)
 	int i, offset;
 	u32 index;
 	struct bio_vec *bvec;
+	struct zram_bio_ctx *ctx = NULL;
 
 	switch (rw) {
 	case READ:
@@ -681,26 +1596,38 @@ static void __zram_make_request(struct zram *zram, struct bio *bio, int rw)
 			bv.bv_len = max_transfer_size;
 			bv.bv_offset = bvec->bv_offset;
 
-			if (zram_bvec_rw(zram, &bv, index, offset, bio, rw) < 0)
+			if (zram_bvec_rw(zram, &bv, index, offset, bio, &ctx,
+					 rw) < 0)
 				goto out;
 
 			bv.bv_len = bvec->bv_len - max_transfer_size;
 			bv.bv_offset += max_transfer_size;
-			if (zram_bvec_rw(zram, &bv, index+1, 0, bio, rw) < 0)
+			if (zram_bvec_rw(zram, &bv, index+1, 0, bio, &ctx,
+					 rw) < 0)
 				goto out;
 		} else
-			if (zram_bvec_rw(zram, bvec, index, offset, bio, rw)
-			    < 0)
+			if (zram_bvec_rw(zram, bvec, index, offset, bio, &ctx,
+					 rw) < 0)
 				goto out;
 
 		update_position(&index, &offset, bvec);
 	}
 
+	if (ctx) {
+		zram_bio_ctx_put(ctx);
+		return;
+	}
+
 	set_bit(BIO_UPTODATE, &bio->bi_flags);
 	bio_endio(bio, 0);
 	return;
 
 out:
+	if (ctx) {
+		ctx->error = -EIO;
+		zram_bio_ctx_put(ctx);
+		return;
+	}
 	bio_io_error(bio);
 }
 
@@ -727,40 +1654,17 @@ error:
 	bio_io_error(bio);
 }
 
-static void zram_slot_free(struct work_struct *work)
-{
-	struct zram *zram;
-
-	zram = container_of(work, struct zram, free_work);
-	down_write(&zram->lock);
-	handle_pending_slot_free(zram);
-	up_write(&zram->lock);
-}
-
-static void add_slot_free(struct zram *zram, struct zram_slot_free *free_rq)
-{
-	spin_lock(&zram->slot_free_lock);
-	free_rq->next = zram->slot_free_rq;
-	zram->slot_free_rq = free_rq;
-	spin_unlock(&zram->slot_free_lock);
-}
-
 static void zram_slot_free_notify(struct block_device *bdev,
 				unsigned long index)
 {
 	struct zram *zram;
-	struct zram_slot_free *free_rq;
 
 	zram = bdev->bd_disk->private_data;
-	atomic64_inc(&zram->stats.notify_free);
-
-	free_rq = kmalloc(sizeof(struct zram_slot_free), GFP_ATOMIC);
-	if (!free_rq)
-		return;
 
-	free_rq->index = index;
-	add_slot_free(zram, free_rq);
-	schedule_work(&zram->free_work);
+	zram_lock_table(zram, index);
+	zram_free_page(zram, index);
+	zram_unlock_table(zram, index);
+	atomic64_inc(&zram->stats.notify_free);
 }
 
 static const struct block_device_operations zram_devops = {
@@ -777,9 +1681,29 @@ static DEVICE_ATTR(num_writes, S_IRUGO, num_writes_show, NULL);
 static DEVICE_ATTR(invalid_io, S_IRUGO, invalid_io_show, NULL);
 static DEVICE_ATTR(notify_free, S_IRUGO, notify_free_show, NULL);
 static DEVICE_ATTR(zero_pages, S_IRUGO, zero_pages_show, NULL);
+static DEVICE_ATTR(same_pages, S_IRUGO, same_pages_show, NULL);
+static DEVICE_ATTR(dedup_saved, S_IRUGO, dedup_saved_show, NULL);
+static DEVICE_ATTR(use_dedup, S_IRUGO | S_IWUSR,
+		use_dedup_show, use_dedup_store);
+#ifdef CONFIG_ZRAM_WRITEBACK
+static DEVICE_ATTR(backing_dev, S_IRUGO | S_IWUSR,
+		backing_dev_show, backing_dev_store);
+static DEVICE_ATTR(idle_age, S_IRUGO | S_IWUSR,
+		idle_age_show, idle_age_store);
+static DEVICE_ATTR(writeback, S_IWUSR, NULL, writeback_store);
+static DEVICE_ATTR(bd_stat, S_IRUGO, bd_stat_show, NULL);
+#endif
 static DEVICE_ATTR(orig_data_size, S_IRUGO, orig_data_size_show, NULL);
 static DEVICE_ATTR(compr_data_size, S_IRUGO, compr_data_size_show, NULL);
 static DEVICE_ATTR(mem_used_total, S_IRUGO, mem_used_total_show, NULL);
+static DEVICE_ATTR(compact, S_IWUSR, NULL, compact_store);
+static DEVICE_ATTR(pages_compacted, S_IRUGO, pages_compacted_show, NULL);
+static DEVICE_ATTR(max_comp_streams, S_IRUGO | S_IWUSR,
+		max_comp_streams_show, max_comp_streams_store);
+static DEVICE_ATTR(comp_algorithm, S_IRUGO | S_IWUSR,
+		comp_algorithm_show, comp_algorithm_store);
+static DEVICE_ATTR(comp_stream_waits, S_IRUGO, comp_stream_waits_show, NULL);
+static DEVICE_ATTR(slot_contended, S_IRUGO, slot_contended_show, NULL);
 
 static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_disksize.attr,
@@ -790,9 +1714,24 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_invalid_io.attr,
 	&dev_attr_notify_free.attr,
 	&dev_attr_zero_pages.attr,
+	&dev_attr_same_pages.attr,
+	&dev_attr_dedup_saved.attr,
+	&dev_attr_use_dedup.attr,
 	&dev_attr_orig_data_size.attr,
 	&dev_attr_compr_data_size.attr,
 	&dev_attr_mem_used_total.attr,
+	&dev_attr_compact.attr,
+	&dev_attr_pages_compacted.attr,
+	&dev_attr_max_comp_streams.attr,
+	&dev_attr_comp_algorithm.attr,
+	&dev_attr_comp_stream_waits.attr,
+	&dev_attr_slot_contended.attr,
+#ifdef CONFIG_ZRAM_WRITEBACK
+	&dev_attr_backing_dev.attr,
+	&dev_attr_idle_age.attr,
+	&dev_attr_writeback.attr,
+	&dev_attr_bd_stat.attr,
+#endif
 	NULL,
 };
 
@@ -804,12 +1743,14 @@ static int create_device(struct zram *zram, int device_id)
 {
 	int ret = -ENOMEM;
 
-	init_rwsem(&zram->lock);
 	init_rwsem(&zram->init_lock);
-
-	INIT_WORK(&zram->free_work, zram_slot_free);
-	spin_lock_init(&zram->slot_free_lock);
-	zram->slot_free_rq = NULL;
+	zram->max_comp_streams = num_online_cpus();
+	strlcpy(zram->compressor, default_compressor, sizeof(zram->compressor));
+#ifdef CONFIG_ZRAM_WRITEBACK
+	zram->idle_age = 3600;
+	mutex_init(&zram->wb_lock);
+	spin_lock_init(&zram->bd_lock);
+#endif
 
 	zram->queue = blk_alloc_queue(GFP_KERNEL);
 	if (!zram->queue) {
@@ -17,8 +17,11 @@
 
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/rbtree.h>
 
 #include "../zsmalloc/zsmalloc.h"
+#include "zcomp.h"
+#include "zram_dedup.h"
 
 static const unsigned max_num_devices = 32;
 
@@ -36,53 +39,74 @@ static const size_t max_zpage_size = PAGE_SIZE / 10 * 9;
 #define ZRAM_SECTOR_PER_LOGICAL_BLOCK	\
 	(1 << (ZRAM_LOGICAL_BLOCK_SHIFT - SECTOR_SHIFT))
 
+#define ZRAM_FLAG_SHIFT 24
+
 enum zram_pageflags {
 	
-	ZRAM_ZERO,
+	ZRAM_SAME = ZRAM_FLAG_SHIFT,	
+	ZRAM_ACCESS,	
+	ZRAM_HUGE,	
+	ZRAM_WB,	
+	ZRAM_UNDER_WB,	
 
 	__NR_ZRAM_PAGEFLAGS,
 };
 
 
-struct table {
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 len;
+	u32 checksum;
+	atomic_t refcount;
 	unsigned long handle;
-	u16 size;	
-	u8 count;	
-	u8 flags;
-} __aligned(4);
+};
+
+struct table {
+	union {
+		struct zram_entry *entry;
+		unsigned long element;	
+	};
+	unsigned long value;	
+#ifdef CONFIG_ZRAM_WRITEBACK
+	unsigned long ac_time;	
+#endif
+};
 
 struct zram_stats {
 	atomic64_t compr_size;	
+	atomic64_t stored_size;	
 	atomic64_t num_reads;	
 	atomic64_t num_writes;	
 	atomic64_t failed_reads;	
 	atomic64_t failed_writes;	
 	atomic64_t invalid_io;	
 	atomic64_t notify_free;	
-	u32 pages_zero;		
-	u32 pages_stored;	
-	u32 good_compress;	
-	u32 bad_compress;	
+	atomic64_t slot_contended;	
+	atomic64_t bd_count;		
+	atomic64_t bd_reads;		
+	atomic64_t bd_writes;		
+	atomic_t pages_zero;		
+	atomic_t same_pages;		
+	atomic_t pages_stored;	
+	atomic_t good_compress;	
+	atomic_t bad_compress;	
+};
+
+struct zram_hash {
+	spinlock_t lock;
+	struct rb_root rb_root;
 };
 
 struct zram_meta {
-	void *compress_workmem;
-	void *compress_buffer;
 	struct table *table;
 	struct zs_pool *mem_pool;
-};
-
-struct zram_slot_free {
-	unsigned long index;
-	struct zram_slot_free *next;
+	struct zram_hash *hash;
+	size_t hash_size;
 };
 
 struct zram {
 	struct zram_meta *meta;
-	struct rw_semaphore lock; 
-
-	struct work_struct free_work;  
-	struct zram_slot_free *slot_free_rq; 
+	struct zcomp *comp;
 
 	struct request_queue *queue;
 	struct gendisk *disk;
@@ -90,8 +114,31 @@ struct zram {
 	
 	struct rw_semaphore init_lock;
 	u64 disksize;	
-	spinlock_t slot_free_lock;
+	int max_comp_streams;
+	char compressor[10];
+	bool use_dedup;
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct file *backing_dev;
+	struct block_device *bdev;
+	unsigned int old_block_size;
+	unsigned long *bitmap;
+	unsigned long *rd_bitmap;	/* blocks being read */
+	unsigned long *free_bitmap;	/* blocks to free once read */
+	spinlock_t bd_lock;
+	unsigned long nr_pages;
+	unsigned int idle_age;	
+	struct mutex wb_lock;
+#endif
 
 	struct zram_stats stats;
 };
+
+struct zram_bio_ctx {
+	struct zram *zram;
+	struct bio *parent;
+	atomic_t pending;
+	int error;
+};
+
+void zram_entry_put(struct zram *zram, struct zram_entry *entry);
 #endif
@@ -32,11 +32,18 @@
 #include <linux/hardirq.h>
 #include <linux/spinlock.h>
 #include <linux/types.h>
+#include <linux/bit_spinlock.h>
+#include <linux/shrinker.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
 
 #include "zsmalloc.h"
 
 #define ZS_ALIGN		8
 
+#define ZS_HANDLE_SIZE (sizeof(unsigned long))
+
 #define ZS_MAX_ZSPAGE_ORDER 2
 #define ZS_MAX_PAGES_PER_ZSPAGE (_AC(1, UL) << ZS_MAX_ZSPAGE_ORDER)
 
@@ -49,7 +56,11 @@
 #endif
 #endif
 #define _PFN_BITS		(MAX_PHYSMEM_BITS - PAGE_SHIFT)
-#define OBJ_INDEX_BITS	(BITS_PER_LONG - _PFN_BITS)
+
+#define HANDLE_PIN_BIT	0
+#define OBJ_ALLOCATED_TAG 1
+#define OBJ_TAG_BITS	1
+#define OBJ_INDEX_BITS	(BITS_PER_LONG - _PFN_BITS - OBJ_TAG_BITS)
 #define OBJ_INDEX_MASK	((_AC(1, UL) << OBJ_INDEX_BITS) - 1)
 
 #define MAX(a, b) ((a) >= (b) ? (a) : (b))
@@ -70,6 +81,15 @@ enum fullness_group {
 	ZS_FULL
 };
 
+enum zs_stat_type {
+	OBJ_ALLOCATED,
+	OBJ_USED,
+	CLASS_ALMOST_FULL,
+	CLASS_ALMOST_EMPTY,
+	CLASS_FULL,
+	NR_ZS_STAT_TYPE,
+};
+
 static const int fullness_threshold_frac = 4;
 
 struct size_class {
@@ -78,24 +98,37 @@ struct size_class {
 
 	
 	int pages_per_zspage;
+	bool huge;
 
 	spinlock_t lock;
 
 	
 	u64 pages_allocated;
+	unsigned long stats[NR_ZS_STAT_TYPE];
 
 	struct page *fullness_list[_ZS_NR_FULLNESS_GROUPS];
 };
 
 struct link_free {
-	
-	void *next;
+	union {
+		void *next;
+		unsigned long handle;
+	};
 };
 
 struct zs_pool {
 	struct size_class size_class[ZS_SIZE_CLASSES];
 
 	gfp_t flags;	
+	const char *name;
+	struct kmem_cache *handle_cachep;
+
+	struct shrinker shrinker;
+	atomic_long_t pages_compacted;
+
+#ifdef CONFIG_ZSMALLOC_STAT
+	struct dentry *stat_dentry;
+#endif
 };
 
 #define CLASS_IDX_BITS	28
@@ -115,11 +148,80 @@ struct mapping_area {
 #endif
 	char *vm_addr; 
 	enum zs_mapmode vm_mm; 
+	bool huge;
 };
 
 
 static DEFINE_PER_CPU(struct mapping_area, zs_map_area);
 
+static unsigned long alloc_handle(struct zs_pool *pool)
+{
+	return (unsigned long)kmem_cache_alloc(pool->handle_cachep,
+			pool->flags & ~__GFP_HIGHMEM);
+}
+
+static void free_handle(struct zs_pool *pool, unsigned long handle)
+{
+	kmem_cache_free(pool->handle_cachep, (void *)handle);
+}
+
+static void record_obj(unsigned long handle, unsigned long obj)
+{
+	*(unsigned long *)handle = obj;
+}
+
+static unsigned long handle_to_obj(unsigned long handle)
+{
+	return *(unsigned long *)handle;
+}
+
+static void pin_tag(unsigned long handle)
+{
+	bit_spin_lock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
+static int trypin_tag(unsigned long handle)
+{
+	return bit_spin_trylock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
+static void unpin_tag(unsigned long handle)
+{
+	bit_spin_unlock(HANDLE_PIN_BIT, (unsigned long *)handle);
+}
+
+static inline void zs_stat_inc(struct size_class *class,
+				enum zs_stat_type type, unsigned long cnt)
+{
+	class->stats[type] += cnt;
+}
+
+static inline void zs_stat_dec(struct size_class *class,
+				enum zs_stat_type type, unsigned long cnt)
+{
+	class->stats[type] -= cnt;
+}
+
+static inline unsigned long zs_stat_get(struct size_class *class,
+				enum zs_stat_type type)
+{
+	return class->stats[type];
+}
+
+static int fullness_to_stat(enum fullness_group fullness)
+{
+	switch (fullness) {
+	case ZS_ALMOST_FULL:
+		return CLASS_ALMOST_FULL;
+	case ZS_ALMOST_EMPTY:
+		return CLASS_ALMOST_EMPTY;
+	case ZS_FULL:
+		return CLASS_FULL;
+	default:
+		return -1;
+	}
+}
+
 static int is_first_page(struct page *page)
 {
 	return PagePrivate(page);
@@ -160,7 +262,7 @@ static int get_size_class_index(int size)
 		idx = DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE,
 				ZS_SIZE_CLASS_DELTA);
 
-	return idx;
+	return min_t(int, idx, ZS_SIZE_CLASSES - 1);
 }
 
 static enum fullness_group get_fullness_group(struct page *page)
@@ -188,9 +290,14 @@ static void insert_zspage(struct page *page, struct size_class *class,
 				enum fullness_group fullness)
 {
 	struct page **head;
+	int stat;
 
 	BUG_ON(!is_first_page(page));
 
+	stat = fullness_to_stat(fullness);
+	if (stat >= 0)
+		zs_stat_inc(class, stat, 1);
+
 	if (fullness >= _ZS_NR_FULLNESS_GROUPS)
 		return;
 
@@ -205,9 +312,14 @@ static void remove_zspage(struct page *page, struct size_class *class,
 				enum fullness_group fullness)
 {
 	struct page **head;
+	int stat;
 
 	BUG_ON(!is_first_page(page));
 
+	stat = fullness_to_stat(fullness);
+	if (stat >= 0)
+		zs_stat_dec(class, stat, 1);
+
 	if (fullness >= _ZS_NR_FULLNESS_GROUPS)
 		return;
 
@@ -290,26 +402,28 @@ static struct page *get_next_page(struct page *page)
 	return next;
 }
 
-static void *obj_location_to_handle(struct page *page, unsigned long obj_idx)
+static void *location_to_obj(struct page *page, unsigned long obj_idx)
 {
-	unsigned long handle;
+	unsigned long obj;
 
 	if (!page) {
 		BUG_ON(obj_idx);
 		return NULL;
 	}
 
-	handle = page_to_pfn(page) << OBJ_INDEX_BITS;
-	handle |= ((obj_idx + 1) & OBJ_INDEX_MASK);
+	obj = page_to_pfn(page) << OBJ_INDEX_BITS;
+	obj |= ((obj_idx + 1) & OBJ_INDEX_MASK);
+	obj <<= OBJ_TAG_BITS;
 
-	return (void *)handle;
+	return (void *)obj;
 }
 
-static void obj_handle_to_location(unsigned long handle, struct page **page,
+static void obj_to_location(unsigned long obj, struct page **page,
 				unsigned long *obj_idx)
 {
-	*page = pfn_to_page(handle >> OBJ_INDEX_BITS);
-	*obj_idx = (handle & OBJ_INDEX_MASK) - 1;
+	obj >>= OBJ_TAG_BITS;
+	*page = pfn_to_page(obj >> OBJ_INDEX_BITS);
+	*obj_idx = (obj & OBJ_INDEX_MASK) - 1;
 }
 
 static unsigned long obj_idx_to_offset(struct page *page,
@@ -379,13 +493,13 @@ static void init_zspage(struct page *first_page, struct size_class *class)
 		for (i = 1; i <= objs_on_page; i++) {
 			off += class->size;
 			if (off < PAGE_SIZE) {
-				link->next = obj_location_to_handle(page, i);
+				link->next = location_to_obj(page, i);
 				link += class->size / sizeof(*link);
 			}
 		}
 
 		next_page = get_next_page(page);
-		link->next = obj_location_to_handle(next_page, 0);
+		link->next = location_to_obj(next_page, 0);
 		kunmap_atomic(link);
 		page = next_page;
 		off = (off + class->size) % PAGE_SIZE;
@@ -425,7 +539,7 @@ static struct page *alloc_zspage(struct size_class *class, gfp_t flags)
 
 	init_zspage(first_page, class);
 
-	first_page->freelist = obj_location_to_handle(first_page, 0);
+	first_page->freelist = location_to_obj(first_page, 0);
 	
 	first_page->objects = class->pages_per_zspage * PAGE_SIZE / class->size;
 
@@ -546,6 +660,12 @@ static void __zs_unmap_object(struct mapping_area *area,
 	if (area->vm_mm == ZS_MM_RO)
 		goto out;
 
+	if (!area->huge) {
+		buf += ZS_HANDLE_SIZE;
+		size -= ZS_HANDLE_SIZE;
+		off += ZS_HANDLE_SIZE;
+	}
+
 	sizes[0] = PAGE_SIZE - off;
 	sizes[1] = size - sizes[0];
 
@@ -591,6 +711,475 @@ static struct notifier_block zs_cpu_nb = {
 	.notifier_call = zs_cpu_notifier
 };
 
+static unsigned long obj_malloc(struct page *first_page,
+		struct size_class *class, unsigned long handle)
+{
+	unsigned long obj;
+	struct link_free *link;
+	struct page *m_page;
+	unsigned long m_objidx, m_offset;
+	void *vaddr;
+
+	obj = (unsigned long)first_page->freelist;
+	obj_to_location(obj, &m_page, &m_objidx);
+	m_offset = obj_idx_to_offset(m_page, m_objidx, class->size);
+
+	vaddr = kmap_atomic(m_page);
+	link = (struct link_free *)vaddr + m_offset / sizeof(*link);
+	first_page->freelist = link->next;
+	if (!class->huge)
+		link->handle = handle | OBJ_ALLOCATED_TAG;
+	else
+		set_page_private(first_page, handle);
+	kunmap_atomic(vaddr);
+
+	first_page->inuse++;
+	zs_stat_inc(class, OBJ_USED, 1);
+
+	return obj;
+}
+
+static void obj_free(struct size_class *class, unsigned long obj)
+{
+	struct link_free *link;
+	struct page *first_page, *f_page;
+	unsigned long f_objidx, f_offset;
+	void *vaddr;
+
+	obj &= ~OBJ_ALLOCATED_TAG;
+	obj_to_location(obj, &f_page, &f_objidx);
+	first_page = get_first_page(f_page);
+	f_offset = obj_idx_to_offset(f_page, f_objidx, class->size);
+
+	vaddr = kmap_atomic(f_page);
+	link = (struct link_free *)(vaddr + f_offset);
+	link->next = first_page->freelist;
+	if (class->huge)
+		set_page_private(first_page, 0);
+	kunmap_atomic(vaddr);
+	first_page->freelist = (void *)obj;
+
+	first_page->inuse--;
+	zs_stat_dec(class, OBJ_USED, 1);
+}
+
+static bool zspage_full(struct page *first_page)
+{
+	BUG_ON(!is_first_page(first_page));
+
+	return first_page->inuse == first_page->objects;
+}
+
+static void zs_object_copy(unsigned long src, unsigned long dst,
+				struct size_class *class)
+{
+	struct page *s_page, *d_page;
+	unsigned long s_objidx, d_objidx;
+	unsigned long s_off, d_off;
+	void *s_addr, *d_addr;
+	int s_size, d_size, size;
+	int written = 0;
+
+	s_size = d_size = class->size;
+
+	obj_to_location(src, &s_page, &s_objidx);
+	obj_to_location(dst, &d_page, &d_objidx);
+
+	s_off = obj_idx_to_offset(s_page, s_objidx, class->size);
+	d_off = obj_idx_to_offset(d_page, d_objidx, class->size);
+
+	if (s_off + class->size > PAGE_SIZE)
+		s_size = PAGE_SIZE - s_off;
+
+	if (d_off + class->size > PAGE_SIZE)
+		d_size = PAGE_SIZE - d_off;
+
+	s_addr = kmap_atomic(s_page);
+	d_addr = kmap_atomic(d_page);
+
+	while (1) {
+		size = min(s_size, d_size);
+		memcpy(d_addr + d_off, s_addr + s_off, size);
+		written += size;
+
+		if (written == class->size)
+			break;
+
+		s_off += size;
+		s_size -= size;
+		d_off += size;
+		d_size -= size;
+
+		if (s_off >= PAGE_SIZE) {
+			kunmap_atomic(d_addr);
+			kunmap_atomic(s_addr);
+			s_page = get_next_page(s_page);
+			BUG_ON(!s_page);
+			s_addr = kmap_atomic(s_page);
+			d_addr = kmap_atomic(d_page);
+			s_size = class->size - written;
+			s_off = 0;
+		}
+
+		if (d_off >= PAGE_SIZE) {
+			kunmap_atomic(d_addr);
+			d_page = get_next_page(d_page);
+			BUG_ON(!d_page);
+			d_addr = kmap_atomic(d_page);
+			d_size = class->size - written;
+			d_off = 0;
+		}
+	}
+
+	kunmap_atomic(d_addr);
+	kunmap_atomic(s_addr);
+}
+
+static unsigned long find_alloced_obj(struct page *page, int *index,
+					struct size_class *class)
+{
+	unsigned long head;
+	int offset = 0;
+	unsigned long handle = 0;
+	void *addr = kmap_atomic(page);
+
+	if (!is_first_page(page))
+		offset = page->index;
+	offset += class->size * *index;
+
+	while (offset < PAGE_SIZE) {
+		head = *(unsigned long *)(addr + offset);
+		if (head & OBJ_ALLOCATED_TAG) {
+			handle = head & ~OBJ_ALLOCATED_TAG;
+			if (trypin_tag(handle))
+				break;
+			handle = 0;
+		}
+
+		offset += class->size;
+		(*index)++;
+	}
+
+	kunmap_atomic(addr);
+	return handle;
+}
+
+struct zs_compact_control {
+	struct page *s_page;
+	struct page *d_page;
+	int index;
+};
+
+static int migrate_zspage(struct size_class *class,
+				struct zs_compact_control *cc)
+{
+	unsigned long used_obj, free_obj;
+	unsigned long handle;
+	struct page *s_page = cc->s_page;
+	struct page *d_page = cc->d_page;
+	int index = cc->index;
+	int ret = 0;
+
+	while (1) {
+		handle = find_alloced_obj(s_page, &index, class);
+		if (!handle) {
+			s_page = get_next_page(s_page);
+			if (!s_page)
+				break;
+			index = 0;
+			continue;
+		}
+
+		if (zspage_full(d_page)) {
+			unpin_tag(handle);
+			ret = -ENOMEM;
+			break;
+		}
+
+		used_obj = handle_to_obj(handle);
+		free_obj = obj_malloc(d_page, class, handle);
+		zs_object_copy(used_obj, free_obj, class);
+		index++;
+		record_obj(handle, free_obj | BIT(HANDLE_PIN_BIT));
+		unpin_tag(handle);
+		obj_free(class, used_obj);
+	}
+
+	cc->s_page = s_page;
+	cc->index = index;
+
+	return ret;
+}
+
+static struct page *isolate_target_page(struct size_class *class)
+{
+	int i;
+	struct page *page;
+
+	for (i = 0; i < _ZS_NR_FULLNESS_GROUPS; i++) {
+		page = class->fullness_list[i];
+		if (page) {
+			remove_zspage(page, class, i);
+			return page;
+		}
+	}
+
+	return NULL;
+}
+
+static struct page *isolate_source_page(struct size_class *class)
+{
+	struct page *page = class->fullness_list[ZS_ALMOST_EMPTY];
+
+	if (page)
+		remove_zspage(page, class, ZS_ALMOST_EMPTY);
+
+	return page;
+}
+
+static enum fullness_group putback_zspage(struct size_class *class,
+						struct page *first_page)
+{
+	enum fullness_group fullness;
+
+	fullness = get_fullness_group(first_page);
+	insert_zspage(first_page, class, fullness);
+	set_zspage_mapping(first_page, class->index, fullness);
+
+	if (fullness == ZS_EMPTY) {
+		zs_stat_dec(class, OBJ_ALLOCATED, first_page->objects);
+		class->pages_allocated -= class->pages_per_zspage;
+		free_zspage(first_page);
+	}
+
+	return fullness;
+}
+
+static unsigned long zs_can_compact(struct size_class *class)
+{
+	unsigned long obj_wasted;
+	int maxobj;
+
+	if (class->huge)
+		return 0;
+
+	maxobj = class->pages_per_zspage * PAGE_SIZE / class->size;
+	obj_wasted = zs_stat_get(class, OBJ_ALLOCATED) -
+			zs_stat_get(class, OBJ_USED);
+	obj_wasted /= maxobj;
+
+	return obj_wasted * class->pages_per_zspage;
+}
+
+static unsigned long __zs_compact(struct zs_pool *pool,
+				struct size_class *class)
+{
+	struct zs_compact_control cc;
+	struct page *src_page;
+	struct page *dst_page = NULL;
+	unsigned long nr_freed = 0;
+
+	spin_lock(&class->lock);
+	while ((src_page = isolate_source_page(class))) {
+		BUG_ON(!is_first_page(src_page));
+
+		if (!zs_can_compact(class))
+			break;
+
+		cc.index = 0;
+		cc.s_page = src_page;
+
+		while ((dst_page = isolate_target_page(class))) {
+			cc.d_page = dst_page;
+			if (!migrate_zspage(class, &cc))
+				break;
+
+			putback_zspage(class, dst_page);
+		}
+
+		if (dst_page == NULL)
+			break;
+
+		putback_zspage(class, dst_page);
+		if (putback_zspage(class, src_page) == ZS_EMPTY)
+			nr_freed += class->pages_per_zspage;
+		spin_unlock(&class->lock);
+		cond_resched();
+		spin_lock(&class->lock);
+	}
+
+	if (src_page)
+		putback_zspage(class, src_page);
+
+	spin_unlock(&class->lock);
+
+	return nr_freed;
+}
+
+unsigned long zs_compact(struct zs_pool *pool)
+{
+	int i;
+	unsigned long nr_freed = 0;
+
+	for (i = ZS_SIZE_CLASSES - 1; i >= 0; i--) {
+		struct size_class *class = &pool->size_class[i];
+
+		if (class->huge)
+			continue;
+		nr_freed += __zs_compact(pool, class);
+	}
+
+	atomic_long_add(nr_freed, &pool->pages_compacted);
+	return nr_freed;
+}
+EXPORT_SYMBOL_GPL(zs_compact);
+
+unsigned long zs_get_pages_compacted(struct zs_pool *pool)
+{
+	return atomic_long_read(&pool->pages_compacted);
+}
+EXPORT_SYMBOL_GPL(zs_get_pages_compacted);
+
+static unsigned long zs_shrinker_count(struct zs_pool *pool)
+{
+	int i;
+	unsigned long pages_to_free = 0;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++)
+		pages_to_free += zs_can_compact(&pool->size_class[i]);
+
+	return pages_to_free;
+}
+
+static int zs_shrinker_shrink(struct shrinker *shrinker,
+				struct shrink_control *sc)
+{
+	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
+						shrinker);
+
+	if (sc->nr_to_scan)
+		zs_compact(pool);
+
+	return min_t(unsigned long, zs_shrinker_count(pool), INT_MAX);
+}
+
+#ifdef CONFIG_ZSMALLOC_STAT
+static struct dentry *zs_stat_root;
+
+static int zs_stats_size_show(struct seq_file *s, void *v)
+{
+	int i;
+	struct zs_pool *pool = s->private;
+	unsigned long almost_full, almost_empty, full;
+	unsigned long obj_allocated, obj_used, pages_used;
+	unsigned long total_almost_full = 0, total_almost_empty = 0;
+	unsigned long total_full = 0;
+	unsigned long total_objs = 0, total_used_objs = 0;
+	unsigned long total_pages = 0;
+
+	seq_printf(s, " %5s %5s %11s %12s %5s %13s %10s %10s %16s\n",
+			"class", "size", "almost_full", "almost_empty", "full",
+			"obj_allocated", "obj_used", "pages_used",
+			"pages_per_zspage");
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		spin_lock(&class->lock);
+		almost_full = zs_stat_get(class, CLASS_ALMOST_FULL);
+		almost_empty = zs_stat_get(class, CLASS_ALMOST_EMPTY);
+		full = zs_stat_get(class, CLASS_FULL);
+		obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
+		obj_used = zs_stat_get(class, OBJ_USED);
+		pages_used = class->pages_allocated;
+		spin_unlock(&class->lock);
+
+		seq_printf(s, " %5u %5u %11lu %12lu %5lu %13lu %10lu %10lu %16d\n",
+			i, class->size, almost_full, almost_empty, full,
+			obj_allocated, obj_used, pages_used,
+			class->pages_per_zspage);
+
+		total_almost_full += almost_full;
+		total_almost_empty += almost_empty;
+		total_full += full;
+		total_objs += obj_allocated;
+		total_used_objs += obj_used;
+		total_pages += pages_used;
+	}
+
+	seq_puts(s, "\n");
+	seq_printf(s, " %5s %5s %11lu %12lu %5lu %13lu %10lu %10lu\n",
+			"Total", "", total_almost_full, total_almost_empty,
+			total_full, total_objs, total_used_objs, total_pages);
+	seq_printf(s, "pages_compacted: %lu\n",
+			zs_get_pages_compacted(pool));
+
+	return 0;
+}
+
+static int zs_stats_size_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, zs_stats_size_show, inode->i_private);
+}
+
+static const struct file_operations zs_stat_size_ops = {
+	.open = zs_stats_size_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void zs_stat_init(void)
+{
+	zs_stat_root = debugfs_create_dir("zsmalloc", NULL);
+	if (!zs_stat_root)
+		pr_warn("debugfs 'zsmalloc' stat dir creation failed\n");
+}
+
+static void zs_stat_exit(void)
+{
+	debugfs_remove_recursive(zs_stat_root);
+}
+
+static void zs_pool_stat_create(struct zs_pool *pool)
+{
+	if (!zs_stat_root)
+		return;
+
+	pool->stat_dentry = debugfs_create_dir(pool->name, zs_stat_root);
+	if (!pool->stat_dentry) {
+		pr_warn("debugfs dir <%s> creation failed\n", pool->name);
+		return;
+	}
+
+	if (!debugfs_create_file("classes", S_IFREG | S_IRUGO,
+				pool->stat_dentry, pool, &zs_stat_size_ops))
+		pr_warn("%s: debugfs file entry <classes> creation failed\n",
+			pool->name);
+}
+
+static void zs_pool_stat_destroy(struct zs_pool *pool)
+{
+	debugfs_remove_recursive(pool->stat_dentry);
+}
+#else
+static inline void zs_stat_init(void)
+{
+}
+
+static inline void zs_stat_exit(void)
+{
+}
+
+static inline void zs_pool_stat_create(struct zs_pool *pool)
+{
+}
+
+static inline void zs_pool_stat_destroy(struct zs_pool *pool)
+{
+}
+#endif
+
 static void zs_exit(void)
 {
 	int cpu;
@@ -598,6 +1187,7 @@ static void zs_exit(void)
 	for_each_online_cpu(cpu)
 		zs_cpu_notifier(NULL, CPU_DEAD, (void *)(long)cpu);
 	unregister_cpu_notifier(&zs_cpu_nb);
+	zs_stat_exit();
 }
 
 static int zs_init(void)
@@ -610,13 +1200,14 @@ static int zs_init(void)
 		if (notifier_to_errno(ret))
 			goto fail;
 	}
+	zs_stat_init();
 	return 0;
 fail:
 	zs_exit();
 	return notifier_to_errno(ret);
 }
 
-struct zs_pool *zs_create_pool(gfp_t flags)
+struct zs_pool *zs_create_pool(const char *name, gfp_t flags)
 {
 	int i, ovhd_size;
 	struct zs_pool *pool;
@@ -626,6 +1217,15 @@ struct zs_pool *zs_create_pool(gfp_t flags)
 	if (!pool)
 		return NULL;
 
+	pool->name = kstrdup(name, GFP_KERNEL);
+	if (!pool->name)
+		goto err_pool;
+
+	pool->handle_cachep = kmem_cache_create("zs_handle", ZS_HANDLE_SIZE,
+						0, 0, NULL);
+	if (!pool->handle_cachep)
+		goto err_name;
+
 	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
 		int size;
 		struct size_class *class;
@@ -639,12 +1239,27 @@ struct zs_pool *zs_create_pool(gfp_t flags)
 		class->index = i;
 		spin_lock_init(&class->lock);
 		class->pages_per_zspage = get_pages_per_zspage(size);
+		if (class->pages_per_zspage == 1 && PAGE_SIZE / size == 1)
+			class->huge = true;
 
 	}
 
 	pool->flags = flags;
+	atomic_long_set(&pool->pages_compacted, 0);
+
+	zs_pool_stat_create(pool);
+
+	pool->shrinker.shrink = zs_shrinker_shrink;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&pool->shrinker);
 
 	return pool;
+
+err_name:
+	kfree(pool->name);
+err_pool:
+	kfree(pool);
+	return NULL;
 }
 EXPORT_SYMBOL_GPL(zs_create_pool);
 
@@ -652,6 +1267,9 @@ void zs_destroy_pool(struct zs_pool *pool)
 {
 	int i;
 
+	unregister_shrinker(&pool->shrinker);
+	zs_pool_stat_destroy(pool);
+
 	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
 		int fg;
 		struct size_class *class = &pool->size_class[i];
@@ -663,23 +1281,27 @@ void zs_destroy_pool(struct zs_pool *pool)
 			}
 		}
 	}
+	kmem_cache_destroy(pool->handle_cachep);
+	kfree(pool->name);
 	kfree(pool);
 }
 EXPORT_SYMBOL_GPL(zs_destroy_pool);
 
 unsigned long zs_malloc(struct zs_pool *pool, size_t size)
 {
-	unsigned long obj;
-	struct link_free *link;
+	unsigned long handle, obj;
 	int class_idx;
 	struct size_class *class;
-
-	struct page *first_page, *m_page;
-	unsigned long m_objidx, m_offset;
+	struct page *first_page;
 
 	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
 		return 0;
 
+	handle = alloc_handle(pool);
+	if (!handle)
+		return 0;
+
+	size += ZS_HANDLE_SIZE;
 	class_idx = get_size_class_index(size);
 	class = &pool->size_class[class_idx];
 	BUG_ON(class_idx != class->index);
@@ -690,69 +1312,57 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size)
 	if (!first_page) {
 		spin_unlock(&class->lock);
 		first_page = alloc_zspage(class, pool->flags);
-		if (unlikely(!first_page))
+		if (unlikely(!first_page)) {
+			free_handle(pool, handle);
 			return 0;
+		}
 
 		set_zspage_mapping(first_page, class->index, ZS_EMPTY);
 		spin_lock(&class->lock);
 		class->pages_allocated += class->pages_per_zspage;
+		zs_stat_inc(class, OBJ_ALLOCATED, first_page->objects);
 	}
 
-	obj = (unsigned long)first_page->freelist;
-	obj_handle_to_location(obj, &m_page, &m_objidx);
-	m_offset = obj_idx_to_offset(m_page, m_objidx, class->size);
-
-	link = (struct link_free *)kmap_atomic(m_page) +
-					m_offset / sizeof(*link);
-	first_page->freelist = link->next;
-	memset(link, POISON_INUSE, sizeof(*link));
-	kunmap_atomic(link);
-
-	first_page->inuse++;
+	obj = obj_malloc(first_page, class, handle);
 	
 	fix_fullness_group(pool, first_page);
+	record_obj(handle, obj);
 	spin_unlock(&class->lock);
 
-	return obj;
+	return handle;
 }
 EXPORT_SYMBOL_GPL(zs_malloc);
 
-void zs_free(struct zs_pool *pool, unsigned long obj)
+void zs_free(struct zs_pool *pool, unsigned long handle)
 {
-	struct link_free *link;
 	struct page *first_page, *f_page;
-	unsigned long f_objidx, f_offset;
-
+	unsigned long obj, f_objidx;
 	int class_idx;
 	struct size_class *class;
 	enum fullness_group fullness;
 
-	if (unlikely(!obj))
+	if (unlikely(!handle))
 		return;
 
-	obj_handle_to_location(obj, &f_page, &f_objidx);
+	pin_tag(handle);
+	obj = handle_to_obj(handle);
+	obj_to_location(obj, &f_page, &f_objidx);
 	first_page = get_first_page(f_page);
 
 	get_zspage_mapping(first_page, &class_idx, &fullness);
 	class = &pool->size_class[class_idx];
-	f_offset = obj_idx_to_offset(f_page, f_objidx, class->size);
 
 	spin_lock(&class->lock);
-
-	
-	link = (struct link_free *)((unsigned char *)kmap_atomic(f_page)
-							+ f_offset);
-	link->next = first_page->freelist;
-	kunmap_atomic(link);
-	first_page->freelist = (void *)obj;
-
-	first_page->inuse--;
+	obj_free(class, obj);
 	fullness = fix_fullness_group(pool, first_page);
-
-	if (fullness == ZS_EMPTY)
+	if (fullness == ZS_EMPTY) {
+		zs_stat_dec(class, OBJ_ALLOCATED, first_page->objects);
 		class->pages_allocated -= class->pages_per_zspage;
-
+	}
 	spin_unlock(&class->lock);
+	unpin_tag(handle);
+
+	free_handle(pool, handle);
 
 	if (fullness == ZS_EMPTY)
 		free_zspage(first_page);
@@ -763,29 +1373,35 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 			enum zs_mapmode mm)
 {
 	struct page *page;
-	unsigned long obj_idx, off;
+	unsigned long obj, obj_idx, off;
 
 	unsigned int class_idx;
 	enum fullness_group fg;
 	struct size_class *class;
 	struct mapping_area *area;
 	struct page *pages[2];
+	void *ret;
 
 	BUG_ON(!handle);
 
 	BUG_ON(in_interrupt());
 
-	obj_handle_to_location(handle, &page, &obj_idx);
+	pin_tag(handle);
+
+	obj = handle_to_obj(handle);
+	obj_to_location(obj, &page, &obj_idx);
 	get_zspage_mapping(get_first_page(page), &class_idx, &fg);
 	class = &pool->size_class[class_idx];
 	off = obj_idx_to_offset(page, obj_idx, class->size);
 
 	area = &get_cpu_var(zs_map_area);
 	area->vm_mm = mm;
+	area->huge = class->huge;
 	if (off + class->size <= PAGE_SIZE) {
 		
 		area->vm_addr = kmap_atomic(page);
-		return area->vm_addr + off;
+		ret = area->vm_addr + off;
+		goto out;
 	}
 
 	
@@ -793,14 +1409,19 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 	pages[1] = get_next_page(page);
 	BUG_ON(!pages[1]);
 
-	return __zs_map_object(area, pages, off, class->size);
+	ret = __zs_map_object(area, pages, off, class->size);
+out:
+	if (!class->huge)
+		ret += ZS_HANDLE_SIZE;
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(zs_map_object);
 
 void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 {
 	struct page *page;
-	unsigned long obj_idx, off;
+	unsigned long obj, obj_idx, off;
 
 	unsigned int class_idx;
 	enum fullness_group fg;
@@ -809,7 +1430,8 @@ void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 
 	BUG_ON(!handle);
 
-	obj_handle_to_location(handle, &page, &obj_idx);
+	obj = handle_to_obj(handle);
+	obj_to_location(obj, &page, &obj_idx);
 	get_zspage_mapping(get_first_page(page), &class_idx, &fg);
 	class = &pool->size_class[class_idx];
 	off = obj_idx_to_offset(page, obj_idx, class->size);
@@ -827,6 +1449,7 @@ void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 		__zs_unmap_object(area, pages, off, class->size);
 	}
 	put_cpu_var(zs_map_area);
+	unpin_tag(handle);
 }
 EXPORT_SYMBOL_GPL(zs_unmap_object);
 
@@ -31,34 +31,56 @@ static struct fuse_conn *fuse_get_conn(struct file *file)
 	return file->private_data;
 }
 
-static void fuse_request_init(struct fuse_req *req)
+static void fuse_request_init(struct fuse_req *req, struct page **pages,
+			      unsigned npages)
 {
 	memset(req, 0, sizeof(*req));
 	INIT_LIST_HEAD(&req->list);
 	INIT_LIST_HEAD(&req->intr_entry);
 	init_waitqueue_head(&req->waitq);
 	atomic_set(&req->count, 1);
+	req->pages = pages;
+	req->max_pages = npages;
 }
 
-struct fuse_req *fuse_request_alloc(void)
+static struct fuse_req *__fuse_request_alloc(unsigned npages, gfp_t flags)
 {
-	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, GFP_KERNEL);
-	if (req)
-		fuse_request_init(req);
+	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, flags);
+	struct page **pages;
+
+	if (!req)
+		return NULL;
+
+	if (npages <= FUSE_DEFAULT_MAX_PAGES_PER_REQ) {
+		pages = req->inline_pages;
+		npages = FUSE_DEFAULT_MAX_PAGES_PER_REQ;
+	} else {
+		pages = kmalloc(sizeof(struct page *) * npages, flags);
+		if (!pages) {
+			kmem_cache_free(fuse_req_cachep, req);
+			return NULL;
+		}
+	}
+
+	fuse_request_init(req, pages, npages);
 	return req;
 }
+
+struct fuse_req *fuse_request_alloc(void)
+{
+	return __fuse_request_alloc(0, GFP_KERNEL);
+}
 EXPORT_SYMBOL_GPL(fuse_request_alloc);
 
-struct fuse_req *fuse_request_alloc_nofs(void)
+struct fuse_req *fuse_request_alloc_nofs(unsigned npages)
 {
-	struct fuse_req *req = kmem_cache_alloc(fuse_req_cachep, GFP_NOFS);
-	if (req)
-		fuse_request_init(req);
-	return req;
+	return __fuse_request_alloc(npages, GFP_NOFS);
 }
 
 void fuse_request_free(struct fuse_req *req)
 {
+	if (req->pages != req->inline_pages)
+		kfree(req->pages);
 	kmem_cache_free(fuse_req_cachep, req);
 }
 
@@ -93,7 +115,7 @@ static void fuse_req_init_context(struct fuse_req *req)
 	req->in.h.pid = current->pid;
 }
 
-struct fuse_req *fuse_get_req(struct fuse_conn *fc)
+struct fuse_req *fuse_get_req_pages(struct fuse_conn *fc, unsigned npages)
 {
 	struct fuse_req *req;
 	sigset_t oldset;
@@ -112,7 +134,7 @@ struct fuse_req *fuse_get_req(struct fuse_conn *fc)
 	if (!fc->connected)
 		goto out;
 
-	req = fuse_request_alloc();
+	req = __fuse_request_alloc(npages, GFP_KERNEL);
 	err = -ENOMEM;
 	if (!req)
 		goto out;
@@ -125,6 +147,12 @@ struct fuse_req *fuse_get_req(struct fuse_conn *fc)
 	atomic_dec(&fc->num_waiting);
 	return ERR_PTR(err);
 }
+EXPORT_SYMBOL_GPL(fuse_get_req_pages);
+
+struct fuse_req *fuse_get_req(struct fuse_conn *fc)
+{
+	return fuse_get_req_pages(fc, 0);
+}
 EXPORT_SYMBOL_GPL(fuse_get_req);
 
 static struct fuse_req *get_reserved_req(struct fuse_conn *fc,
@@ -154,7 +182,8 @@ static void put_reserved_req(struct fuse_conn *fc, struct fuse_req *req)
 	struct fuse_file *ff = file->private_data;
 
 	spin_lock(&fc->lock);
-	fuse_request_init(req);
+	fuse_request_init(req, req->inline_pages,
+			  FUSE_DEFAULT_MAX_PAGES_PER_REQ);
 	BUG_ON(ff->reserved_req);
 	ff->reserved_req = req;
 	wake_up_all(&fc->reserved_req_waitq);
@@ -478,6 +507,7 @@ struct fuse_copy_state {
 	struct pipe_buffer *currbuf;
 	struct pipe_inode_info *pipe;
 	unsigned long nr_segs;
+	unsigned max_segs;
 	unsigned long seglen;
 	unsigned long addr;
 	struct page *pg;
@@ -547,7 +577,7 @@ static int fuse_copy_fill(struct fuse_copy_state *cs)
 		} else {
 			struct page *page;
 
-			if (cs->nr_segs == cs->pipe->buffers)
+			if (cs->nr_segs >= cs->max_segs)
 				return -EIO;
 
 			page = alloc_page(GFP_HIGHUSER);
@@ -722,7 +752,7 @@ static int fuse_ref_page(struct fuse_copy_state *cs, struct page *page,
 {
 	struct pipe_buffer *buf;
 
-	if (cs->nr_segs == cs->pipe->buffers)
+	if (cs->nr_segs >= cs->max_segs)
 		return -EIO;
 
 	unlock_request(cs->fc, cs->req);
@@ -1006,6 +1036,21 @@ __releases(fc->lock)
 		return fuse_read_batch_forget(fc, cs, nbytes);
 }
 
+/* Pipe buffers needed to splice a request: copied args, then one per page. */
+static unsigned fuse_req_pipe_segs(struct fuse_req *req)
+{
+	struct fuse_in *in = &req->in;
+	unsigned data = 0;
+	unsigned segs = 0;
+
+	if (in->argpages) {
+		data = in->args[in->numargs - 1].size;
+		segs = req->num_pages;
+	}
+
+	return segs + DIV_ROUND_UP(in->h.len - data, PAGE_SIZE);
+}
+
 static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 				struct fuse_copy_state *cs, size_t nbytes)
 {
@@ -1044,6 +1089,16 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	}
 
 	req = list_entry(fc->pending.next, struct fuse_req, list);
+
+	/*
+	 * Leave a request that cannot fit in the pipe queued, so the daemon
+	 * can drain or grow the pipe, or fall back to read(), instead of
+	 * the request failing half way through the copy.
+	 */
+	err = -E2BIG;
+	if (cs->pipebufs && fuse_req_pipe_segs(req) > cs->max_segs)
+		goto err_unlock;
+
 	req->state = FUSE_REQ_READING;
 	list_move(&req->list, &fc->io);
 
@@ -1142,6 +1197,9 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	fuse_copy_init(&cs, fc, 1, NULL, 0);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
+	pipe_lock(pipe);
+	cs.max_segs = pipe->buffers - pipe->nrbufs;
+	pipe_unlock(pipe);
 	ret = fuse_dev_do_read(fc, in, &cs, len);
 	if (ret < 0)
 		goto out;
@@ -1449,13 +1507,17 @@ static int fuse_retrieve(struct fuse_conn *fc, struct inode *inode,
 	unsigned int num;
 	unsigned int offset;
 	size_t total_len = 0;
+	unsigned int num_pages;
 
-	req = fuse_get_req(fc);
+	offset = outarg->offset & ~PAGE_CACHE_MASK;
+	num_pages = min_t(u64, fc->max_pages,
+			  (offset + (u64)outarg->size + PAGE_SIZE - 1) >>
+			  PAGE_SHIFT);
+
+	req = fuse_get_req_pages(fc, num_pages);
 	if (IS_ERR(req))
 		return PTR_ERR(req);
 
-	offset = outarg->offset & ~PAGE_CACHE_MASK;
-
 	req->in.h.opcode = FUSE_NOTIFY_REPLY;
 	req->in.h.nodeid = outarg->nodeid;
 	req->in.numargs = 2;
@@ -1471,7 +1533,7 @@ static int fuse_retrieve(struct fuse_conn *fc, struct inode *inode,
 	else if (outarg->offset + num > file_size)
 		num = file_size - outarg->offset;
 
-	while (num && req->num_pages < FUSE_MAX_PAGES_PER_REQ) {
+	while (num && req->num_pages < req->max_pages) {
 		struct page *page;
 		unsigned int this_num;
 
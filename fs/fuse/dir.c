@@ -707,6 +707,15 @@ static int fuse_link(struct dentry *entry, struct inode *newdir,
 static void fuse_fillattr(struct inode *inode, struct fuse_attr *attr,
 			  struct kstat *stat)
 {
+	struct fuse_conn *fc = get_fuse_conn(inode);
+
+	/* see the comment in fuse_change_attributes() */
+	if (fc->writeback_cache && S_ISREG(inode->i_mode)) {
+		attr->size = i_size_read(inode);
+		attr->mtime = inode->i_mtime.tv_sec;
+		attr->mtimensec = inode->i_mtime.tv_nsec;
+	}
+
 	stat->dev = inode->i_sb->s_dev;
 	stat->ino = attr->ino;
 	stat->mode = (inode->i_mode & S_IFMT) | (attr->mode & 07777);
@@ -1290,7 +1299,13 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	fuse_change_attributes_common(inode, &outarg.attr,
 				      attr_timeout(&outarg));
 	oldsize = inode->i_size;
-	i_size_write(inode, outarg.attr.size);
+	if (is_truncate || !fc->writeback_cache || !S_ISREG(inode->i_mode))
+		i_size_write(inode, outarg.attr.size);
+	if (fc->writeback_cache && S_ISREG(inode->i_mode) &&
+	    (attr->ia_valid & (ATTR_MTIME | ATTR_SIZE))) {
+		inode->i_mtime.tv_sec = outarg.attr.mtime;
+		inode->i_mtime.tv_nsec = outarg.attr.mtimensec;
+	}
 
 	if (is_truncate) {
 		
@@ -1298,7 +1313,7 @@ static int fuse_do_setattr(struct dentry *entry, struct iattr *attr,
 	}
 	spin_unlock(&fc->lock);
 
-	if (S_ISREG(inode->i_mode) && oldsize != outarg.attr.size) {
+	if (S_ISREG(inode->i_mode) && oldsize != inode->i_size) {
 		truncate_pagecache(inode, oldsize, outarg.attr.size);
 		invalidate_inode_pages2(inode->i_mapping);
 	}
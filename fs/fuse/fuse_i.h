@@ -23,7 +23,9 @@
 #include <linux/poll.h>
 #include <linux/workqueue.h>
 
-#define FUSE_MAX_PAGES_PER_REQ 32
+#define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
+
+#define FUSE_MAX_MAX_PAGES 256
 
 #define FUSE_NOWRITE INT_MIN
 
@@ -246,7 +248,13 @@ struct fuse_req {
 	} misc;
 
 	
-	struct page *pages[FUSE_MAX_PAGES_PER_REQ];
+	struct page **pages;
+
+	
+	unsigned max_pages;
+
+	
+	struct page *inline_pages[FUSE_DEFAULT_MAX_PAGES_PER_REQ];
 
 	
 	unsigned num_pages;
@@ -296,6 +304,9 @@ struct fuse_conn {
 	unsigned max_write;
 
 	
+	unsigned max_pages;
+
+	
 	wait_queue_head_t waitq;
 
 	
@@ -418,6 +429,9 @@ struct fuse_conn {
 	unsigned no_flock:1;
 
 	
+	unsigned writeback_cache:1;
+
+	
 	atomic_t num_waiting;
 
 	
@@ -541,12 +555,14 @@ void fuse_ctl_cleanup(void);
 
 struct fuse_req *fuse_request_alloc(void);
 
-struct fuse_req *fuse_request_alloc_nofs(void);
+struct fuse_req *fuse_request_alloc_nofs(unsigned npages);
 
 void fuse_request_free(struct fuse_req *req);
 
 struct fuse_req *fuse_get_req(struct fuse_conn *fc);
 
+struct fuse_req *fuse_get_req_pages(struct fuse_conn *fc, unsigned npages);
+
 struct fuse_req *fuse_get_req_nofail(struct fuse_conn *fc, struct file *file);
 
 void fuse_put_request(struct fuse_conn *fc, struct fuse_req *req);
@@ -32,6 +32,7 @@ struct blk_trace;
 struct request;
 struct sg_io_hdr;
 struct bsg_job;
+struct blk_sw_stage;
 
 #define BLKDEV_MIN_RQ	4
 #define BLKDEV_MAX_RQ	128	
@@ -315,6 +316,9 @@ struct request_queue {
 
 	struct mutex		sysfs_lock;
 
+	struct blk_sw_stage __percpu *sw_stage;
+	unsigned int		sw_stage_batch;
+
 #if defined(CONFIG_BLK_DEV_BSG)
 	bsg_job_fn		*bsg_job_fn;
 	int			bsg_job_size;
@@ -347,6 +351,7 @@ struct request_queue {
 #define QUEUE_FLAG_SECDISCARD  17	
 #define QUEUE_FLAG_SAME_FORCE  18	
 #define QUEUE_FLAG_SANITIZE    19	
+#define QUEUE_FLAG_SW_STAGE    20	/* per-CPU submission stage */
 
 #define QUEUE_FLAG_DEFAULT	((1 << QUEUE_FLAG_IO_STAT) |		\
 				 (1 << QUEUE_FLAG_STACKABLE)	|	\
@@ -427,6 +432,7 @@ static inline void queue_flag_clear(unsigned int flag, struct request_queue *q)
 	test_bit(QUEUE_FLAG_STACKABLE, &(q)->queue_flags)
 #define blk_queue_discard(q)	test_bit(QUEUE_FLAG_DISCARD, &(q)->queue_flags)
 #define blk_queue_sanitize(q)	test_bit(QUEUE_FLAG_SANITIZE, &(q)->queue_flags)
+#define blk_queue_staged(q)	test_bit(QUEUE_FLAG_SW_STAGE, &(q)->queue_flags)
 #define blk_queue_secdiscard(q)	(blk_queue_discard(q) && \
 	test_bit(QUEUE_FLAG_SECDISCARD, &(q)->queue_flags))
 
@@ -600,6 +606,9 @@ extern int sg_scsi_ioctl(struct request_queue *, struct gendisk *, fmode_t,
 			 struct scsi_ioctl_command __user *);
 
 extern void blk_queue_bio(struct request_queue *q, struct bio *bio);
+extern int blk_queue_enable_sw_stage(struct request_queue *q,
+				     unsigned int batch);
+extern void blk_queue_disable_sw_stage(struct request_queue *q);
 
 static inline void blk_clear_queue_congested(struct request_queue *q, int sync)
 {
@@ -769,6 +778,7 @@ struct blk_plug {
 	struct list_head list; 
 	struct list_head cb_list; 
 	unsigned int should_sort; 
+	struct blk_sw_stage *sw_stage;
 };
 #define BLK_MAX_REQUEST_COUNT 16
 
@@ -801,7 +811,8 @@ static inline bool blk_needs_flush_plug(struct task_struct *tsk)
 {
 	struct blk_plug *plug = tsk->plug;
 
-	return plug && (!list_empty(&plug->list) || !list_empty(&plug->cb_list));
+	return plug && (!list_empty(&plug->list) || !list_empty(&plug->cb_list) ||
+			plug->sw_stage);
 }
 
 #define blk_rq_tagged(rq)		((rq)->cmd_flags & REQ_QUEUED)
@@ -0,0 +1,29 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+/*
+ * LZ4 Kernel Interface
+ *
+ * Implements the LZ4 block format: a sequence of literal runs, each
+ * followed by a back-reference of at least four bytes into the last
+ * 64KB of output.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#define LZ4_HASH_LOG		12
+#define LZ4_MEM_COMPRESS	((1 << LZ4_HASH_LOG) * sizeof(u32))
+
+static inline size_t lz4_compressbound(size_t isize)
+{
+	return isize + (isize / 255) + 16;
+}
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len);
+
+#endif
@@ -374,6 +374,7 @@ struct mmc_card {
 	unsigned char	speed_class; 
 
 	struct mmc_wr_pack_stats wr_pack_stats; 
+	struct mmc_wr_pack_stats rd_pack_stats;
 
 	struct mmc_bkops_info	bkops_info;
 
@@ -631,6 +632,9 @@ extern void mmc_fixup_device(struct mmc_card *card,
 extern struct mmc_wr_pack_stats *mmc_blk_get_packed_statistics(
 			struct mmc_card *card);
 extern void mmc_blk_init_packed_statistics(struct mmc_card *card);
+extern struct mmc_wr_pack_stats *mmc_blk_get_rd_packed_statistics(
+			struct mmc_card *card);
+extern void mmc_blk_init_rd_packed_statistics(struct mmc_card *card);
 extern void mmc_blk_disable_wr_packing(struct mmc_queue *mq);
 extern int mmc_send_long_pon(struct mmc_card *card);
 #endif 
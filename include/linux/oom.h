@@ -53,6 +53,31 @@ static inline void oom_killer_enable(void)
 
 extern struct task_struct *find_lock_task_mm(struct task_struct *p);
 
+#ifdef CONFIG_ANDROID_LMK_ADJ_INDEX
+extern void lowmem_index_add(struct task_struct *p);
+extern void lowmem_index_del(struct task_struct *p);
+extern void lowmem_index_update(struct task_struct *p);
+extern void lowmem_index_replace(struct task_struct *old,
+				 struct task_struct *new);
+#else
+static inline void lowmem_index_add(struct task_struct *p)
+{
+}
+
+static inline void lowmem_index_del(struct task_struct *p)
+{
+}
+
+static inline void lowmem_index_update(struct task_struct *p)
+{
+}
+
+static inline void lowmem_index_replace(struct task_struct *old,
+					struct task_struct *new)
+{
+}
+#endif
+
 extern int sysctl_oom_dump_tasks;
 extern int sysctl_oom_kill_allocating_task;
 extern int sysctl_panic_on_oom;
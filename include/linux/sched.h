@@ -1020,6 +1020,8 @@ struct task_struct {
 	const struct sched_class *sched_class;
 	struct sched_entity se;
 	struct sched_rt_entity rt;
+	u64 burst_start;
+	u32 burst_avg;
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	
@@ -1054,6 +1056,10 @@ struct task_struct {
 #ifdef CONFIG_SMP
 	struct plist_node pushable_tasks;
 #endif
+#ifdef CONFIG_ANDROID_LMK_ADJ_INDEX
+	struct hlist_node lmk_node;
+	int lmk_adj;
+#endif
 
 	struct mm_struct *mm, *active_mm;
 #ifdef CONFIG_COMPAT_BRK
@@ -2202,6 +2208,17 @@ static inline void set_task_cpu(struct task_struct *p, unsigned int cpu)
 #endif 
 
 extern struct atomic_notifier_head migration_notifier_head;
+extern struct atomic_notifier_head heavy_wakeup_notifier_head;
+extern unsigned int sched_heavy_task_ns;
+
+#ifdef CONFIG_CPU_FREQ
+struct update_util_data {
+	void (*func)(struct update_util_data *data,
+		     u64 time, unsigned long util, unsigned long max);
+};
+
+void cpufreq_set_update_util_data(int cpu, struct update_util_data *data);
+#endif
 
 extern long sched_setaffinity(pid_t pid, const struct cpumask *new_mask);
 extern long sched_getaffinity(pid_t pid, struct cpumask *mask);
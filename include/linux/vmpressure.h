@@ -0,0 +1,29 @@
+#ifndef __LINUX_VMPRESSURE_H
+#define __LINUX_VMPRESSURE_H
+
+#include <linux/types.h>
+#include <linux/gfp.h>
+
+enum vmpressure_levels {
+	VMPRESSURE_LOW = 0,
+	VMPRESSURE_MEDIUM,
+	VMPRESSURE_CRITICAL,
+	VMPRESSURE_NUM_LEVELS,
+};
+
+#ifdef CONFIG_VMPRESSURE
+extern void vmpressure(gfp_t gfp, unsigned long scanned,
+		       unsigned long reclaimed);
+extern void vmpressure_stall(u64 stall_ns);
+#else
+static inline void vmpressure(gfp_t gfp, unsigned long scanned,
+			      unsigned long reclaimed)
+{
+}
+
+static inline void vmpressure_stall(u64 stall_ns)
+{
+}
+#endif
+
+#endif
@@ -1032,6 +1032,9 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 	ftrace_graph_init_task(p);
 
 	rt_mutex_init_task(p);
+#ifdef CONFIG_ANDROID_LMK_ADJ_INDEX
+	INIT_HLIST_NODE(&p->lmk_node);
+#endif
 
 #ifdef CONFIG_PROVE_LOCKING
 	DEBUG_LOCKS_WARN_ON(!p->hardirqs_enabled);
@@ -1280,6 +1283,7 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 			list_add_tail(&p->sibling, &p->real_parent->children);
 			list_add_tail_rcu(&p->tasks, &init_task.tasks);
 			__this_cpu_inc(process_counts);
+			lowmem_index_add(p);
 		}
 		attach_pid(p, PIDTYPE_PID, pid);
 		nr_threads++;
@@ -88,6 +88,11 @@
 #include <trace/events/sched.h>
 
 ATOMIC_NOTIFIER_HEAD(migration_notifier_head);
+ATOMIC_NOTIFIER_HEAD(heavy_wakeup_notifier_head);
+EXPORT_SYMBOL_GPL(heavy_wakeup_notifier_head);
+
+unsigned int sched_heavy_task_ns;
+EXPORT_SYMBOL_GPL(sched_heavy_task_ns);
 
 void start_bandwidth_timer(struct hrtimer *period_timer, ktime_t period)
 {
@@ -1116,10 +1121,20 @@ ttwu_stat(struct task_struct *p, int cpu, int wake_flags)
 #endif 
 }
 
+static inline void task_burst_update(struct task_struct *p)
+{
+	u64 burst = p->se.sum_exec_runtime - p->burst_start;
+
+	if (burst > (u32)~0)
+		burst = (u32)~0;
+	p->burst_avg = (u32)(((u64)p->burst_avg * 3 + burst) >> 2);
+}
+
 static void ttwu_activate(struct rq *rq, struct task_struct *p, int en_flags)
 {
 	activate_task(rq, p, en_flags);
 	p->on_rq = 1;
+	p->burst_start = p->se.sum_exec_runtime;
 
 	
 	if (p->flags & PF_WQ_WORKER)
@@ -1310,6 +1325,10 @@ out:
 	if (src_cpu != cpu && task_notify_on_migrate(p))
 		atomic_notifier_call_chain(&migration_notifier_head,
 					   cpu, (void *)src_cpu);
+	if (success && sched_heavy_task_ns &&
+	    p->burst_avg >= sched_heavy_task_ns)
+		atomic_notifier_call_chain(&heavy_wakeup_notifier_head,
+					   cpu, p);
 	return success;
 }
 
@@ -1364,6 +1383,9 @@ static void __sched_fork(struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+	p->burst_start			= 0;
+	p->burst_avg			= 0;
+
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
@@ -2440,6 +2462,7 @@ need_resched:
 		} else {
 			deactivate_task(rq, prev, DEQUEUE_SLEEP);
 			prev->on_rq = 0;
+			task_burst_update(prev);
 
 			if (prev->flags & PF_WQ_WORKER) {
 				struct task_struct *to_wakeup;
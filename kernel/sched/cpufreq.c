@@ -0,0 +1,21 @@
+#include <linux/export.h>
+
+#include "sched.h"
+
+DEFINE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_set_update_util_data - Install a utilization callback for a CPU.
+ * @cpu: The CPU to set the callback for.
+ * @data: New callback, or NULL to remove the current one.
+ *
+ * The callback runs from CFS enqueue, dequeue and tick with the CPU's run
+ * queue lock held and interrupts disabled, so it must not sleep or wake
+ * tasks directly.  After clearing it the caller must wait for
+ * synchronize_sched() before freeing @data.
+ */
+void cpufreq_set_update_util_data(int cpu, struct update_util_data *data)
+{
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), data);
+}
+EXPORT_SYMBOL_GPL(cpufreq_set_update_util_data);
@@ -369,6 +369,12 @@ struct rq {
 #ifdef CONFIG_SMP
 	struct llist_head wake_list;
 #endif
+
+#ifdef CONFIG_CPU_FREQ
+	u64 util_stamp;
+	unsigned long util_avg;
+	int util_busy;
+#endif
 };
 
 static inline int cpu_of(struct rq *rq)
@@ -754,6 +760,44 @@ static inline void dec_nr_running(struct rq *rq)
 
 extern void update_rq_clock(struct rq *rq);
 
+#ifdef CONFIG_CPU_FREQ
+DECLARE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+#define UTIL_AVG_SHIFT	23
+
+/*
+ * Fold the time since the last event into rq->util_avg, a busy
+ * fraction scaled to SCHED_POWER_SCALE that tracks the run queue's
+ * busy/idle state with a time constant of about 8ms, and pass it to
+ * the registered cpufreq hook.  Called with rq->lock held.
+ */
+static inline void cpufreq_update_util(struct rq *rq)
+{
+	struct update_util_data *data;
+	long long target;
+	u64 delta;
+
+	data = rcu_dereference_sched(per_cpu(cpufreq_update_util_data,
+					     cpu_of(rq)));
+	if (!data)
+		return;
+
+	delta = rq->clock - rq->util_stamp;
+	target = rq->util_busy ? SCHED_POWER_SCALE : 0;
+	if (delta >= (1ULL << UTIL_AVG_SHIFT))
+		rq->util_avg = target;
+	else
+		rq->util_avg += ((target - (long long)rq->util_avg) *
+				 (long long)delta) >> UTIL_AVG_SHIFT;
+	rq->util_stamp = rq->clock;
+	rq->util_busy = rq->nr_running != 0;
+
+	data->func(data, rq->clock, rq->util_avg, SCHED_POWER_SCALE);
+}
+#else
+static inline void cpufreq_update_util(struct rq *rq) {}
+#endif
+
 extern void activate_task(struct rq *rq, struct task_struct *p, int flags);
 extern void deactivate_task(struct rq *rq, struct task_struct *p, int flags);
 
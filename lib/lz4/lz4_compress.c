@@ -0,0 +1,162 @@
+/*
+ * LZ4 block compressor
+ *
+ * Greedy single-pass matcher over a 4-byte hash table holding the
+ * offset of the last position seen for each hash.  Output is the
+ * standard LZ4 block format and can be decoded by any LZ4 decoder.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/bitops.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+static inline const unsigned char *lz4_count(const unsigned char *ip,
+		const unsigned char *ref, const unsigned char *limit)
+{
+	while (ip < limit - (sizeof(unsigned long) - 1)) {
+		unsigned long diff = get_unaligned((const unsigned long *)ref) ^
+				     get_unaligned((const unsigned long *)ip);
+		if (!diff) {
+			ip += sizeof(unsigned long);
+			ref += sizeof(unsigned long);
+			continue;
+		}
+#ifdef __LITTLE_ENDIAN
+		return ip + (__ffs(diff) >> 3);
+#else
+		return ip + ((BITS_PER_LONG - 1 - __fls(diff)) >> 3);
+#endif
+	}
+
+	while (ip < limit && *ip == *ref) {
+		ip++;
+		ref++;
+	}
+	return ip;
+}
+
+static inline unsigned char *lz4_put_length(unsigned char *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = (unsigned char)len;
+	return op;
+}
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	u32 *hash_table = wrkmem;
+	const unsigned char *ip = src;
+	const unsigned char *anchor = src;
+	const unsigned char *const iend = src + src_len;
+	const unsigned char *const mflimit = iend - MFLIMIT;
+	const unsigned char *const matchlimit = iend - LASTLITERALS;
+	unsigned char *op = dst;
+	unsigned char *token;
+	const unsigned char *ref;
+	size_t len;
+	u32 h;
+
+	if (src_len < MINLENGTH)
+		goto last_literals;
+
+	memset(hash_table, 0, LZ4_MEM_COMPRESS);
+	hash_table[LZ4_HASH_VALUE(ip)] = 0;
+	ip++;
+
+	for (;;) {
+		unsigned int attempts = 1 << SKIPSTRENGTH;
+		const unsigned char *forward = ip;
+
+		do {
+			ip = forward;
+			forward += attempts++ >> SKIPSTRENGTH;
+			if (unlikely(ip > mflimit))
+				goto last_literals;
+
+			h = LZ4_HASH_VALUE(ip);
+			ref = src + hash_table[h];
+			hash_table[h] = ip - src;
+		} while (ref + MAX_DISTANCE < ip ||
+			 get_unaligned((const u32 *)ref) !=
+			 get_unaligned((const u32 *)ip));
+
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		len = ip - anchor;
+		token = op++;
+		if (len >= RUN_MASK) {
+			*token = RUN_MASK << ML_BITS;
+			op = lz4_put_length(op, len - RUN_MASK);
+		} else {
+			*token = len << ML_BITS;
+		}
+		memcpy(op, anchor, len);
+		op += len;
+
+next_match:
+		put_unaligned_le16(ip - ref, op);
+		op += 2;
+
+		ip += MINMATCH;
+		anchor = ip;
+		ip = lz4_count(ip, ref + MINMATCH, matchlimit);
+
+		len = ip - anchor;
+		if (len >= ML_MASK) {
+			*token |= ML_MASK;
+			op = lz4_put_length(op, len - ML_MASK);
+		} else {
+			*token |= len;
+		}
+
+		anchor = ip;
+		if (ip > mflimit)
+			break;
+
+		hash_table[LZ4_HASH_VALUE(ip - 2)] = ip - 2 - src;
+
+		h = LZ4_HASH_VALUE(ip);
+		ref = src + hash_table[h];
+		hash_table[h] = ip - src;
+		if (ref + MAX_DISTANCE >= ip &&
+		    get_unaligned((const u32 *)ref) ==
+		    get_unaligned((const u32 *)ip)) {
+			token = op++;
+			*token = 0;
+			goto next_match;
+		}
+
+		ip++;
+	}
+
+last_literals:
+	len = iend - anchor;
+	if (len >= RUN_MASK) {
+		*op++ = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, len - RUN_MASK);
+	} else {
+		*op++ = len << ML_BITS;
+	}
+	memcpy(op, anchor, len);
+	op += len;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Compressor");
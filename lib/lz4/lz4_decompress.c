@@ -0,0 +1,106 @@
+/*
+ * LZ4 block decompressor
+ *
+ * Every length and offset read from the input is checked against both
+ * the input and the output bounds, so corrupted or malicious blocks are
+ * rejected instead of overrunning either buffer.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+static inline int lz4_get_length(const unsigned char **ip,
+		const unsigned char *iend, size_t *len)
+{
+	unsigned int s;
+
+	do {
+		if (unlikely(*ip >= iend))
+			return -1;
+		s = *(*ip)++;
+		*len += s;
+	} while (s == 255);
+
+	return 0;
+}
+
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len)
+{
+	const unsigned char *ip = src;
+	const unsigned char *const iend = src + src_len;
+	unsigned char *op = dest;
+	unsigned char *const oend = dest + *dest_len;
+	const unsigned char *ref;
+	unsigned int token;
+	size_t len, offset;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		len = token >> ML_BITS;
+		if (len == RUN_MASK && lz4_get_length(&ip, iend, &len))
+			goto fail;
+
+		if (unlikely(len > (size_t)(iend - ip) ||
+			     len > (size_t)(oend - op)))
+			goto fail;
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		if (ip == iend)
+			break;
+
+		if (unlikely(iend - ip < 2))
+			goto fail;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (unlikely(!offset || offset > (size_t)(op - dest)))
+			goto fail;
+		ref = op - offset;
+
+		len = token & ML_MASK;
+		if (len == ML_MASK && lz4_get_length(&ip, iend, &len))
+			goto fail;
+		len += MINMATCH;
+
+		if (unlikely(len > (size_t)(oend - op)))
+			goto fail;
+
+		if (offset >= len) {
+			memcpy(op, ref, len);
+			op += len;
+		} else if (offset >= COPYLENGTH) {
+			while (len >= COPYLENGTH) {
+				memcpy(op, ref, COPYLENGTH);
+				op += COPYLENGTH;
+				ref += COPYLENGTH;
+				len -= COPYLENGTH;
+			}
+			while (len--)
+				*op++ = *ref++;
+		} else {
+			while (len--)
+				*op++ = *ref++;
+		}
+	}
+
+	*dest_len = op - dest;
+	return 0;
+
+fail:
+	return -1;
+}
+EXPORT_SYMBOL_GPL(lz4_decompress_unknownoutputsize);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
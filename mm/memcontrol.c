@@ -90,6 +90,8 @@ enum mem_cgroup_events_index {
 	MEM_CGROUP_EVENTS_COUNT,	
 	MEM_CGROUP_EVENTS_PGFAULT,	
 	MEM_CGROUP_EVENTS_PGMAJFAULT,	
+	MEM_CGROUP_EVENTS_PSWPIN,
+	MEM_CGROUP_EVENTS_PSWPOUT,
 	MEM_CGROUP_EVENTS_NSTATS,
 };
 enum mem_cgroup_events_target {
@@ -125,6 +127,7 @@ struct mem_cgroup_per_zone {
 	struct rb_node		tree_node;	
 	unsigned long long	usage_in_excess;
 						
+	unsigned int		reclaim_priority;
 	bool			on_tree;
 	struct mem_cgroup	*memcg;		
 						
@@ -208,6 +211,8 @@ struct mem_cgroup {
 	atomic_t	refcnt;
 
 	int	swappiness;
+
+	unsigned int	reclaim_priority;
 	
 	int		oom_kill_disable;
 
@@ -273,6 +278,7 @@ static bool move_file(void)
 
 #define	MEM_CGROUP_MAX_RECLAIM_LOOPS		(100)
 #define	MEM_CGROUP_MAX_SOFT_LIMIT_RECLAIM_LOOPS	(2)
+#define	MEM_CGROUP_RECLAIM_PRIORITY_MAX		(100)
 
 enum charge_type {
 	MEM_CGROUP_CHARGE_TYPE_CACHE = 0,
@@ -388,6 +394,14 @@ soft_limit_tree_from_page(struct page *page)
 	return &soft_limit_tree.rb_tree_per_node[nid]->rb_tree_per_zone[zid];
 }
 
+static bool mem_cgroup_soft_limit_less(struct mem_cgroup_per_zone *a,
+				       struct mem_cgroup_per_zone *b)
+{
+	if (a->reclaim_priority != b->reclaim_priority)
+		return a->reclaim_priority < b->reclaim_priority;
+	return a->usage_in_excess < b->usage_in_excess;
+}
+
 static void
 __mem_cgroup_insert_exceeded(struct mem_cgroup *memcg,
 				struct mem_cgroup_per_zone *mz,
@@ -402,15 +416,16 @@ __mem_cgroup_insert_exceeded(struct mem_cgroup *memcg,
 		return;
 
 	mz->usage_in_excess = new_usage_in_excess;
+	mz->reclaim_priority = memcg->reclaim_priority;
 	if (!mz->usage_in_excess)
 		return;
 	while (*p) {
 		parent = *p;
 		mz_node = rb_entry(parent, struct mem_cgroup_per_zone,
 					tree_node);
-		if (mz->usage_in_excess < mz_node->usage_in_excess)
+		if (mem_cgroup_soft_limit_less(mz, mz_node))
 			p = &(*p)->rb_left;
-		else if (mz->usage_in_excess >= mz_node->usage_in_excess)
+		else
 			p = &(*p)->rb_right;
 	}
 	rb_link_node(&mz->tree_node, parent, p);
@@ -814,6 +829,9 @@ void mem_cgroup_count_vm_event(struct mm_struct *mm, enum vm_event_item idx)
 	case PGMAJFAULT:
 		this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_PGMAJFAULT]);
 		break;
+	case PSWPIN:
+		this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_PSWPIN]);
+		break;
 	default:
 		BUG();
 	}
@@ -822,6 +840,22 @@ out:
 }
 EXPORT_SYMBOL(mem_cgroup_count_vm_event);
 
+void mem_cgroup_count_swapout(struct page *page)
+{
+	struct page_cgroup *pc;
+	struct mem_cgroup *memcg;
+
+	if (mem_cgroup_disabled())
+		return;
+
+	pc = lookup_page_cgroup(page);
+	rcu_read_lock();
+	memcg = pc->mem_cgroup;
+	if (PageCgroupUsed(pc) && memcg)
+		this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_PSWPOUT]);
+	rcu_read_unlock();
+}
+
 struct lruvec *mem_cgroup_zone_lruvec(struct zone *zone,
 				      struct mem_cgroup *memcg)
 {
@@ -3101,6 +3135,8 @@ enum {
 	MCS_SWAP,
 	MCS_PGFAULT,
 	MCS_PGMAJFAULT,
+	MCS_PSWPIN,
+	MCS_PSWPOUT,
 	MCS_INACTIVE_ANON,
 	MCS_ACTIVE_ANON,
 	MCS_INACTIVE_FILE,
@@ -3125,6 +3161,8 @@ struct {
 	{"swap", "total_swap"},
 	{"pgfault", "total_pgfault"},
 	{"pgmajfault", "total_pgmajfault"},
+	{"pswpin", "total_pswpin"},
+	{"pswpout", "total_pswpout"},
 	{"inactive_anon", "total_inactive_anon"},
 	{"active_anon", "total_active_anon"},
 	{"inactive_file", "total_inactive_file"},
@@ -3157,6 +3195,10 @@ mem_cgroup_get_local_stat(struct mem_cgroup *memcg, struct mcs_total_stat *s)
 	s->stat[MCS_PGFAULT] += val;
 	val = mem_cgroup_read_events(memcg, MEM_CGROUP_EVENTS_PGMAJFAULT);
 	s->stat[MCS_PGMAJFAULT] += val;
+	val = mem_cgroup_read_events(memcg, MEM_CGROUP_EVENTS_PSWPIN);
+	s->stat[MCS_PSWPIN] += val;
+	val = mem_cgroup_read_events(memcg, MEM_CGROUP_EVENTS_PSWPOUT);
+	s->stat[MCS_PSWPOUT] += val;
 
 	
 	val = mem_cgroup_nr_lru_pages(memcg, BIT(LRU_INACTIVE_ANON));
@@ -3328,6 +3370,45 @@ static int mem_cgroup_swappiness_write(struct cgroup *cgrp, struct cftype *cft,
 	return 0;
 }
 
+static u64 mem_cgroup_reclaim_priority_read(struct cgroup *cgrp,
+					    struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cgrp)->reclaim_priority;
+}
+
+static int mem_cgroup_reclaim_priority_write(struct cgroup *cgrp,
+					     struct cftype *cft, u64 val)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+	struct mem_cgroup_per_zone *mz;
+	struct mem_cgroup_tree_per_zone *mctz;
+	unsigned long long excess;
+	int node, zone;
+
+	if (val > MEM_CGROUP_RECLAIM_PRIORITY_MAX)
+		return -EINVAL;
+
+	if (cgrp->parent == NULL)
+		return -EINVAL;
+
+	memcg->reclaim_priority = val;
+	for_each_node(node) {
+		for (zone = 0; zone < MAX_NR_ZONES; zone++) {
+			mz = mem_cgroup_zoneinfo(memcg, node, zone);
+			mctz = soft_limit_tree_node_zone(node, zone);
+			spin_lock(&mctz->lock);
+			if (mz->on_tree) {
+				excess = mz->usage_in_excess;
+				__mem_cgroup_remove_exceeded(memcg, mz, mctz);
+				__mem_cgroup_insert_exceeded(memcg, mz, mctz,
+							     excess);
+			}
+			spin_unlock(&mctz->lock);
+		}
+	}
+	return 0;
+}
+
 static void __mem_cgroup_threshold(struct mem_cgroup *memcg, bool swap)
 {
 	struct mem_cgroup_threshold_ary *t;
@@ -3722,6 +3803,11 @@ static struct cftype mem_cgroup_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+	{
+		.name = "reclaim_priority",
+		.read_u64 = mem_cgroup_reclaim_priority_read,
+		.write_u64 = mem_cgroup_reclaim_priority_write,
+	},
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -3999,8 +4085,10 @@ mem_cgroup_create(struct cgroup *cont)
 	memcg->last_scanned_node = MAX_NUMNODES;
 	INIT_LIST_HEAD(&memcg->oom_notify);
 
-	if (parent)
+	if (parent) {
 		memcg->swappiness = mem_cgroup_swappiness(parent);
+		memcg->reclaim_priority = parent->reclaim_priority;
+	}
 	atomic_set(&memcg->refcnt, 1);
 	memcg->move_charge_at_immigrate = 0;
 	mutex_init(&memcg->thresholds_lock);
@@ -57,6 +57,7 @@
 #include <linux/ftrace_event.h>
 #include <linux/memcontrol.h>
 #include <linux/prefetch.h>
+#include <linux/vmpressure.h>
 #include <linux/mm_inline.h>
 #include <linux/migrate.h>
 #include <linux/page-debug-flags.h>
@@ -1757,6 +1758,7 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order, struct zonelist *zonelist,
 {
 	struct reclaim_state reclaim_state;
 	int progress;
+	u64 start, stall_ns;
 
 	cond_resched();
 
@@ -1767,7 +1769,11 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order, struct zonelist *zonelist,
 	reclaim_state.reclaimed_slab = 0;
 	current->reclaim_state = &reclaim_state;
 
+	start = local_clock();
 	progress = try_to_free_pages(zonelist, order, gfp_mask, nodemask);
+	stall_ns = local_clock() - start;
+	count_vm_events(ALLOCSTALL_US, div_u64(stall_ns, NSEC_PER_USEC));
+	vmpressure_stall(stall_ns);
 
 	current->reclaim_state = NULL;
 	lockdep_clear_current_reclaim_state();
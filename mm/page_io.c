@@ -127,6 +127,7 @@ int swap_writepage(struct page *page, struct writeback_control *wbc)
 	if (wbc->sync_mode == WB_SYNC_ALL)
 		rw |= REQ_SYNC;
 	count_vm_event(PSWPOUT);
+	mem_cgroup_count_swapout(page);
 	set_page_writeback(page);
 	unlock_page(page);
 	submit_bio(rw, bio);
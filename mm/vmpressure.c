@@ -0,0 +1,256 @@
+/*
+ * Memory pressure notifications
+ *
+ * Reclaim efficiency reported by vmscan and the time allocating tasks
+ * spend stalled in direct reclaim are folded into low/medium/critical
+ * pressure levels, which userspace can poll on /dev/vmpressure.
+ *
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/swap.h>
+#include <linux/uaccess.h>
+#include <linux/vmpressure.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+static const unsigned long vmpressure_win = SWAP_CLUSTER_MAX * 16;
+static const unsigned int vmpressure_level_med = 60;
+static const unsigned int vmpressure_level_critical = 95;
+
+static const char * const vmpressure_str_levels[] = {
+	[VMPRESSURE_LOW] = "low",
+	[VMPRESSURE_MEDIUM] = "medium",
+	[VMPRESSURE_CRITICAL] = "critical",
+};
+
+struct vmpressure_file {
+	enum vmpressure_levels threshold;
+	unsigned long seen;
+};
+
+static struct {
+	spinlock_t sr_lock;
+	unsigned long scanned;
+	unsigned long reclaimed;
+	u64 stall_ns;
+	unsigned long stamp;
+	struct work_struct work;
+
+	spinlock_t events_lock;
+	wait_queue_head_t wait;
+	unsigned long seq[VMPRESSURE_NUM_LEVELS];
+	enum vmpressure_levels level;
+	unsigned int pressure;
+} vmpr;
+
+static unsigned int vmpressure_calc(unsigned long scanned,
+				    unsigned long reclaimed, u64 stall_ns,
+				    unsigned long elapsed)
+{
+	unsigned int pressure = 0;
+	unsigned int stall;
+	u64 elapsed_ns;
+
+	if (reclaimed < scanned)
+		pressure = (scanned - reclaimed) * 100 / scanned;
+
+	elapsed_ns = (u64)jiffies_to_usecs(max(elapsed, 1UL)) * NSEC_PER_USEC;
+	stall = min_t(u64, div64_u64(stall_ns * 100, elapsed_ns), 100);
+
+	return max(pressure, stall);
+}
+
+static enum vmpressure_levels vmpressure_level(unsigned int pressure)
+{
+	if (pressure >= vmpressure_level_critical)
+		return VMPRESSURE_CRITICAL;
+	else if (pressure >= vmpressure_level_med)
+		return VMPRESSURE_MEDIUM;
+	return VMPRESSURE_LOW;
+}
+
+static void vmpressure_work_fn(struct work_struct *work)
+{
+	unsigned long scanned, reclaimed, elapsed;
+	unsigned int pressure;
+	enum vmpressure_levels level;
+	u64 stall_ns;
+	int i;
+
+	spin_lock(&vmpr.sr_lock);
+	scanned = vmpr.scanned;
+	reclaimed = vmpr.reclaimed;
+	stall_ns = vmpr.stall_ns;
+	elapsed = jiffies - vmpr.stamp;
+	vmpr.scanned = 0;
+	vmpr.reclaimed = 0;
+	vmpr.stall_ns = 0;
+	vmpr.stamp = jiffies;
+	spin_unlock(&vmpr.sr_lock);
+
+	if (!scanned)
+		return;
+
+	pressure = vmpressure_calc(scanned, reclaimed, stall_ns, elapsed);
+	level = vmpressure_level(pressure);
+
+	spin_lock(&vmpr.events_lock);
+	for (i = VMPRESSURE_LOW; i <= level; i++)
+		vmpr.seq[i]++;
+	vmpr.level = level;
+	vmpr.pressure = pressure;
+	spin_unlock(&vmpr.events_lock);
+
+	wake_up_interruptible(&vmpr.wait);
+}
+
+void vmpressure(gfp_t gfp, unsigned long scanned, unsigned long reclaimed)
+{
+	if (!(gfp & (__GFP_HIGHMEM | __GFP_MOVABLE | __GFP_IO | __GFP_FS)))
+		return;
+
+	if (!scanned)
+		return;
+
+	spin_lock(&vmpr.sr_lock);
+	vmpr.scanned += scanned;
+	vmpr.reclaimed += reclaimed;
+	scanned = vmpr.scanned;
+	spin_unlock(&vmpr.sr_lock);
+
+	if (scanned < vmpressure_win)
+		return;
+	schedule_work(&vmpr.work);
+}
+
+void vmpressure_stall(u64 stall_ns)
+{
+	spin_lock(&vmpr.sr_lock);
+	vmpr.stall_ns += stall_ns;
+	spin_unlock(&vmpr.sr_lock);
+}
+
+static bool vmpressure_pending(struct vmpressure_file *f)
+{
+	return ACCESS_ONCE(vmpr.seq[f->threshold]) != f->seen;
+}
+
+static int vmpressure_open(struct inode *inode, struct file *file)
+{
+	struct vmpressure_file *f;
+
+	f = kzalloc(sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return -ENOMEM;
+
+	f->threshold = VMPRESSURE_LOW;
+	f->seen = ACCESS_ONCE(vmpr.seq[VMPRESSURE_LOW]);
+	file->private_data = f;
+	return nonseekable_open(inode, file);
+}
+
+static int vmpressure_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static unsigned int vmpressure_poll(struct file *file, poll_table *wait)
+{
+	struct vmpressure_file *f = file->private_data;
+
+	poll_wait(file, &vmpr.wait, wait);
+	if (vmpressure_pending(f))
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
+static ssize_t vmpressure_read(struct file *file, char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	struct vmpressure_file *f = file->private_data;
+	char kbuf[32];
+	int len;
+	int ret;
+
+	while (!vmpressure_pending(f)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(vmpr.wait,
+					       vmpressure_pending(f));
+		if (ret)
+			return ret;
+	}
+
+	spin_lock(&vmpr.events_lock);
+	f->seen = vmpr.seq[f->threshold];
+	len = scnprintf(kbuf, sizeof(kbuf), "%s %u\n",
+			vmpressure_str_levels[vmpr.level], vmpr.pressure);
+	spin_unlock(&vmpr.events_lock);
+
+	if (count < len)
+		return -EINVAL;
+	if (copy_to_user(buf, kbuf, len))
+		return -EFAULT;
+	return len;
+}
+
+static ssize_t vmpressure_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct vmpressure_file *f = file->private_data;
+	char kbuf[16];
+	size_t len = min(count, sizeof(kbuf) - 1);
+	int i;
+
+	if (copy_from_user(kbuf, buf, len))
+		return -EFAULT;
+	kbuf[len] = '\0';
+
+	for (i = VMPRESSURE_LOW; i < VMPRESSURE_NUM_LEVELS; i++) {
+		if (sysfs_streq(kbuf, vmpressure_str_levels[i])) {
+			spin_lock(&vmpr.events_lock);
+			f->threshold = i;
+			f->seen = vmpr.seq[i];
+			spin_unlock(&vmpr.events_lock);
+			return count;
+		}
+	}
+	return -EINVAL;
+}
+
+static const struct file_operations vmpressure_fops = {
+	.owner = THIS_MODULE,
+	.open = vmpressure_open,
+	.release = vmpressure_release,
+	.poll = vmpressure_poll,
+	.read = vmpressure_read,
+	.write = vmpressure_write,
+	.llseek = no_llseek,
+};
+
+static struct miscdevice vmpressure_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "vmpressure",
+	.fops = &vmpressure_fops,
+};
+
+static int __init vmpressure_init(void)
+{
+	spin_lock_init(&vmpr.sr_lock);
+	spin_lock_init(&vmpr.events_lock);
+	init_waitqueue_head(&vmpr.wait);
+	INIT_WORK(&vmpr.work, vmpressure_work_fn);
+	vmpr.stamp = jiffies;
+
+	return misc_register(&vmpressure_misc);
+}
+module_init(vmpressure_init);
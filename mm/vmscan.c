@@ -41,6 +41,7 @@
 #include <linux/sysctl.h>
 #include <linux/oom.h>
 #include <linux/prefetch.h>
+#include <linux/vmpressure.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -1403,6 +1404,8 @@ static void shrink_zone(struct zone *zone, struct scan_control *sc)
 		.priority = sc->priority,
 	};
 	struct mem_cgroup *memcg;
+	unsigned long nr_reclaimed = sc->nr_reclaimed;
+	unsigned long nr_scanned = sc->nr_scanned;
 
 	memcg = mem_cgroup_iter(root, NULL, &reclaim);
 	do {
@@ -1418,6 +1421,10 @@ static void shrink_zone(struct zone *zone, struct scan_control *sc)
 		}
 		memcg = mem_cgroup_iter(root, memcg, &reclaim);
 	} while (memcg);
+
+	if (global_reclaim(sc))
+		vmpressure(sc->gfp_mask, sc->nr_scanned - nr_scanned,
+			   sc->nr_reclaimed - nr_reclaimed);
 }
 
 static inline bool compaction_ready(struct zone *zone, struct scan_control *sc)
@@ -582,6 +582,7 @@ const char * const vmstat_text[] = {
 	"kswapd_skip_congestion_wait",
 	"pageoutrun",
 	"allocstall",
+	"allocstall_us",
 
 	"pgrotated",
 
@@ -0,0 +1,198 @@
+/*
+ * iops_scale -- measure small random read IOPS on a block device with
+ * 1..N submitting threads, one pinned per CPU, to show how submission
+ * scales with core count.  Intended for a null_blk device so that the
+ * block layer, not the media, is the bottleneck; compare runs with the
+ * queue's sw_stage attribute set to 0 and to a batch size.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+static const char *dev = "/dev/nullb0";
+static unsigned int bs = 4096;
+static unsigned int seconds = 5;
+static int max_threads;
+static unsigned long long dev_blocks;
+static volatile int stop;
+
+struct worker {
+	pthread_t thread;
+	int cpu;
+	unsigned long long ios;
+	int err;
+};
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	unsigned int seed = w->cpu * 2654435761u + 1;
+	cpu_set_t set;
+	void *buf;
+	int fd;
+
+	CPU_ZERO(&set);
+	CPU_SET(w->cpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+	if (posix_memalign(&buf, 4096, bs)) {
+		w->err = 1;
+		return NULL;
+	}
+
+	fd = open(dev, O_RDONLY | O_DIRECT);
+	if (fd < 0) {
+		perror(dev);
+		w->err = 1;
+		free(buf);
+		return NULL;
+	}
+
+	while (!stop) {
+		unsigned long long blk;
+
+		blk = ((unsigned long long)rand_r(&seed) << 16 ^
+		       rand_r(&seed)) % dev_blocks;
+		if (pread(fd, buf, bs, blk * bs) != (ssize_t)bs) {
+			perror("pread");
+			w->err = 1;
+			break;
+		}
+		w->ios++;
+	}
+
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int run(int nthreads, double *iops)
+{
+	struct worker *w = calloc(nthreads, sizeof(*w));
+	unsigned long long total = 0;
+	double start, elapsed;
+	int i, err = 0;
+
+	if (!w)
+		return -1;
+
+	stop = 0;
+	start = now();
+	for (i = 0; i < nthreads; i++) {
+		w[i].cpu = i;
+		if (pthread_create(&w[i].thread, NULL, worker_fn, &w[i])) {
+			perror("pthread_create");
+			nthreads = i;
+			err = -1;
+			break;
+		}
+	}
+
+	if (!err)
+		sleep(seconds);
+	stop = 1;
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(w[i].thread, NULL);
+		total += w[i].ios;
+		if (w[i].err)
+			err = -1;
+	}
+	elapsed = now() - start;
+
+	*iops = elapsed > 0 ? total / elapsed : 0;
+	free(w);
+	return err;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: iops_scale [-b block_size] [-t seconds] [-n max_threads]\n"
+		"       [device]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long bytes;
+	double iops, base = 0;
+	int opt, fd, n;
+
+	max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((opt = getopt(argc, argv, "b:t:n:")) != -1) {
+		switch (opt) {
+		case 'b':
+			bs = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			max_threads = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind < argc)
+		dev = argv[optind];
+
+	if (!bs || bs % 512 || !seconds || max_threads < 1)
+		usage();
+
+	fd = open(dev, O_RDONLY);
+	if (fd < 0) {
+		perror(dev);
+		return 1;
+	}
+	if (ioctl(fd, BLKGETSIZE64, &bytes)) {
+		perror("BLKGETSIZE64");
+		return 1;
+	}
+	close(fd);
+
+	dev_blocks = bytes / bs;
+	if (!dev_blocks) {
+		fprintf(stderr, "%s: smaller than one block\n", dev);
+		return 1;
+	}
+
+	printf("%7s %12s %8s\n", "threads", "iops", "scaling");
+	for (n = 1; n <= max_threads; n++) {
+		if (run(n, &iops))
+			return 1;
+		if (n == 1)
+			base = iops;
+		printf("%7d %12.0f %7.2fx\n", n, iops, base ? iops / base : 0);
+		fflush(stdout);
+	}
+	return 0;
+}
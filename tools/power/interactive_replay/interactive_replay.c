@@ -0,0 +1,387 @@
+/*
+ * interactive_replay -- replay a recorded load trace through the
+ * interactive cpufreq governor's frequency selection and report
+ * missed frames against a relative energy estimate, with and
+ * without wakeup load prediction.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Trace format, one line per 1ms tick:
+ *
+ *	<work_us> [w<burst_us>] [f]
+ *
+ * work_us is the CPU time the tick's new work needs at the highest
+ * frequency.  A "w" token records a wakeup of a task whose average run
+ * burst is burst_us, as reported by the scheduler's heavy wakeup hook.
+ * An "f" token marks a frame deadline: any work still queued when it
+ * is reached counts as a missed frame.  Lines starting with '#' are
+ * ignored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#define MAX_FREQS	32
+#define MAX_PRED_LOAD	1000
+
+struct tick {
+	unsigned int work_us;
+	unsigned int burst_us;
+	int frame;
+};
+
+static struct tick *ticks;
+static int nticks;
+
+static unsigned int freq_table[MAX_FREQS] = {
+	300000, 422400, 652800, 729600, 883200, 960000, 1036800,
+	1190400, 1267200, 1497600, 1574400, 1728000, 1958400, 2265600,
+};
+static int nfreqs = 14;
+
+static unsigned int hispeed_freq = 1190400;
+static unsigned int go_hispeed_load = 99;
+static unsigned int target_load = 90;
+static unsigned int timer_rate = 20000;
+static unsigned int above_hispeed_delay = 20000;
+static unsigned int min_sample_time = 80000;
+static unsigned int heavy_task_us = 4000;
+static int verbose;
+
+struct governor {
+	int predict;
+	unsigned int cur;
+	unsigned int floor_freq;
+	unsigned long long floor_validate_time;
+	unsigned long long hispeed_validate_time;
+	unsigned long long speedadj;
+	unsigned int speedadj_start;
+	int pred_load;
+	int prev_load;
+
+	/* results */
+	unsigned long long backlog_ns;
+	unsigned long long energy;
+	unsigned long long freq_sum;
+	unsigned int frames;
+	unsigned int missed;
+	unsigned int ramps;
+};
+
+/* lowest table frequency >= freq, else highest */
+static unsigned int table_l(unsigned int freq)
+{
+	int i;
+
+	for (i = 0; i < nfreqs; i++)
+		if (freq_table[i] >= freq)
+			return freq_table[i];
+	return freq_table[nfreqs - 1];
+}
+
+/* highest table frequency <= freq, else lowest */
+static unsigned int table_h(unsigned int freq)
+{
+	int i;
+
+	for (i = nfreqs - 1; i >= 0; i--)
+		if (freq_table[i] <= freq)
+			return freq_table[i];
+	return freq_table[0];
+}
+
+/* Same search as choose_freq() with a single target load. */
+static unsigned int choose_freq(struct governor *g, unsigned int loadadjfreq)
+{
+	unsigned int freq = g->cur;
+	unsigned int prevfreq, freqmin = 0, freqmax = UINT_MAX;
+
+	do {
+		prevfreq = freq;
+		freq = table_l(loadadjfreq / target_load);
+
+		if (freq > prevfreq) {
+			freqmin = prevfreq;
+			if (freq >= freqmax) {
+				freq = table_h(freqmax - 1);
+				if (freq == freqmin) {
+					freq = freqmax;
+					break;
+				}
+			}
+		} else if (freq < prevfreq) {
+			freqmax = prevfreq;
+			if (freq <= freqmin) {
+				freq = table_l(freqmin + 1);
+				if (freq == freqmax)
+					break;
+			}
+		}
+	} while (freq != prevfreq);
+
+	return freq;
+}
+
+static void heavy_wakeup(struct governor *g, unsigned int now,
+			 unsigned int burst_us)
+{
+	unsigned long long load;
+	unsigned int new_freq;
+
+	if (!g->predict || burst_us < heavy_task_us)
+		return;
+
+	load = (unsigned long long)burst_us * 100 / timer_rate + g->prev_load;
+	if (load > MAX_PRED_LOAD)
+		load = MAX_PRED_LOAD;
+	if ((int)load > g->pred_load)
+		g->pred_load = load;
+
+	new_freq = choose_freq(g, (unsigned int)load * g->cur);
+	if (new_freq < hispeed_freq)
+		new_freq = hispeed_freq;
+	if (new_freq <= g->cur)
+		return;
+
+	g->cur = new_freq;
+	g->floor_freq = new_freq;
+	g->floor_validate_time = now;
+	g->hispeed_validate_time = now;
+	g->ramps++;
+}
+
+static void timer(struct governor *g, unsigned int now)
+{
+	unsigned int delta = now - g->speedadj_start;
+	unsigned int loadadjfreq, new_freq;
+	int cpu_load;
+
+	if (!delta)
+		return;
+
+	loadadjfreq = g->speedadj / delta * 100;
+	cpu_load = loadadjfreq / g->cur;
+	if (g->predict) {
+		if (g->pred_load > cpu_load) {
+			cpu_load = g->pred_load;
+			loadadjfreq = g->pred_load * g->cur;
+		}
+		g->pred_load = 0;
+	}
+	g->prev_load = cpu_load;
+	g->speedadj = 0;
+	g->speedadj_start = now;
+
+	if (cpu_load >= (int)go_hispeed_load) {
+		if (g->cur < hispeed_freq) {
+			new_freq = hispeed_freq;
+		} else {
+			new_freq = choose_freq(g, loadadjfreq);
+			if (new_freq < hispeed_freq)
+				new_freq = hispeed_freq;
+		}
+	} else {
+		new_freq = choose_freq(g, loadadjfreq);
+	}
+
+	if (g->cur >= hispeed_freq && new_freq > g->cur &&
+	    now - g->hispeed_validate_time < above_hispeed_delay)
+		return;
+	g->hispeed_validate_time = now;
+
+	new_freq = table_l(new_freq);
+	if (new_freq < g->floor_freq &&
+	    now - g->floor_validate_time < min_sample_time)
+		return;
+
+	g->floor_freq = new_freq;
+	g->floor_validate_time = now;
+	g->cur = new_freq;
+}
+
+static void run(struct governor *g)
+{
+	unsigned int fmax = freq_table[nfreqs - 1];
+	unsigned int now = 0;
+	unsigned long long cap_ns, done_ns;
+	double rel;
+	int i;
+
+	g->cur = freq_table[0];
+	g->floor_freq = g->cur;
+
+	for (i = 0; i < nticks; i++, now += 1000) {
+		struct tick *t = &ticks[i];
+
+		if (now - g->speedadj_start >= timer_rate)
+			timer(g, now);
+		if (t->burst_us)
+			heavy_wakeup(g, now, t->burst_us);
+
+		g->backlog_ns += (unsigned long long)t->work_us * 1000;
+
+		/* work is accounted in ns at fmax; a tick at cur retires less */
+		cap_ns = 1000000ULL * g->cur / fmax;
+		done_ns = g->backlog_ns < cap_ns ? g->backlog_ns : cap_ns;
+		g->backlog_ns -= done_ns;
+
+		/* busy wall time in us, as cputime_speedadj sees it */
+		g->speedadj += done_ns * fmax / g->cur / 1000 * g->cur;
+
+		rel = (double)g->cur / fmax;
+		g->energy += (unsigned long long)(done_ns * fmax / g->cur *
+						  rel * rel * rel / 1000);
+		g->freq_sum += g->cur;
+
+		if (t->frame) {
+			g->frames++;
+			if (g->backlog_ns)
+				g->missed++;
+		}
+
+		if (verbose)
+			printf("%s %6u %8u %8llu%s\n", g->predict ? "P" : "B",
+			       now / 1000, g->cur, g->backlog_ns / 1000,
+			       t->frame && g->backlog_ns ? " jank" : "");
+	}
+}
+
+static void report(const char *name, struct governor *g)
+{
+	printf("%-10s %7u %7u %6.2f%% %12llu %9llu %6u\n", name,
+	       g->frames, g->missed,
+	       g->frames ? 100.0 * g->missed / g->frames : 0.0,
+	       g->energy, nticks ? g->freq_sum / nticks : 0, g->ramps);
+}
+
+static void parse_trace(FILE *fp)
+{
+	char line[256];
+	int alloc = 0;
+
+	while (fgets(line, sizeof(line), fp)) {
+		struct tick t = { 0 };
+		char *tok;
+
+		if (line[0] == '#')
+			continue;
+		for (tok = strtok(line, " \t\n"); tok;
+		     tok = strtok(NULL, " \t\n")) {
+			if (tok[0] == 'w')
+				t.burst_us = strtoul(tok + 1, NULL, 0);
+			else if (tok[0] == 'f')
+				t.frame = 1;
+			else
+				t.work_us = strtoul(tok, NULL, 0);
+		}
+
+		if (nticks == alloc) {
+			alloc = alloc ? alloc * 2 : 4096;
+			ticks = realloc(ticks, alloc * sizeof(*ticks));
+			if (!ticks) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+		ticks[nticks++] = t;
+	}
+}
+
+static void parse_freqs(char *s)
+{
+	char *tok;
+
+	nfreqs = 0;
+	for (tok = strtok(s, ","); tok && nfreqs < MAX_FREQS;
+	     tok = strtok(NULL, ","))
+		freq_table[nfreqs++] = strtoul(tok, NULL, 0);
+	if (!nfreqs) {
+		fprintf(stderr, "empty frequency table\n");
+		exit(1);
+	}
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: interactive_replay [-v] [-F khz,khz,...] [-H hispeed_khz]\n"
+		"       [-g go_hispeed_load] [-l target_load] [-r timer_rate_us]\n"
+		"       [-a above_hispeed_delay_us] [-m min_sample_time_us]\n"
+		"       [-t heavy_task_us] [trace]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct governor base = { .predict = 0 };
+	struct governor pred = { .predict = 1 };
+	FILE *fp = stdin;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "vF:H:g:l:r:a:m:t:")) != -1) {
+		switch (opt) {
+		case 'v':
+			verbose++;
+			break;
+		case 'F':
+			parse_freqs(optarg);
+			break;
+		case 'H':
+			hispeed_freq = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			go_hispeed_load = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			target_load = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			timer_rate = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			above_hispeed_delay = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			min_sample_time = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			heavy_task_us = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (!target_load || !timer_rate)
+		usage();
+
+	if (optind < argc) {
+		fp = fopen(argv[optind], "r");
+		if (!fp) {
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+	parse_trace(fp);
+	if (fp != stdin)
+		fclose(fp);
+
+	run(&base);
+	run(&pred);
+
+	printf("%-10s %7s %7s %7s %12s %9s %6s\n", "mode", "frames", "missed",
+	       "jank", "energy", "avg_khz", "ramps");
+	report("baseline", &base);
+	report("predict", &pred);
+	return 0;
+}
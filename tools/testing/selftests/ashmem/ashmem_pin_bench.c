@@ -0,0 +1,266 @@
+/*
+ * ashmem pin/unpin stress benchmark
+ *
+ * Each thread owns an ashmem area and issues random ASHMEM_PIN and
+ * ASHMEM_UNPIN calls over it, optionally while another thread keeps
+ * purging all unpinned ranges. Per-call latencies are reported as
+ * percentiles so that lock contention shows up in the tail.
+ *
+ * Usage: ashmem_pin_bench [-t threads] [-p pages] [-d seconds] [-s] [-P]
+ *   -s  all threads share a single area
+ *   -P  run a purger thread issuing ASHMEM_PURGE_ALL_CACHES
+ *
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#define __ASHMEMIOC		0x77
+#define ASHMEM_SET_SIZE		_IOW(__ASHMEMIOC, 3, size_t)
+#define ASHMEM_PIN		_IOW(__ASHMEMIOC, 7, struct ashmem_pin)
+#define ASHMEM_UNPIN		_IOW(__ASHMEMIOC, 8, struct ashmem_pin)
+#define ASHMEM_PURGE_ALL_CACHES	_IO(__ASHMEMIOC, 10)
+
+struct ashmem_pin {
+	uint32_t offset;
+	uint32_t len;
+};
+
+#define MAX_SAMPLES	(1 << 20)
+
+struct lat {
+	uint64_t *ns;
+	size_t nr;
+};
+
+struct worker {
+	pthread_t thread;
+	int fd;
+	unsigned int seed;
+	struct lat pin;
+	struct lat unpin;
+	unsigned long purged;
+};
+
+static int nr_pages = 1024;
+static int duration = 5;
+static volatile int stop;
+static long page_size;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int area_create(void)
+{
+	void *map;
+	int fd;
+
+	fd = open("/dev/ashmem", O_RDWR);
+	if (fd < 0)
+		return -1;
+	if (ioctl(fd, ASHMEM_SET_SIZE, (size_t)nr_pages * page_size) < 0)
+		goto err;
+	map = mmap(NULL, (size_t)nr_pages * page_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		goto err;
+	memset(map, 0xa5, (size_t)nr_pages * page_size);
+	return fd;
+err:
+	close(fd);
+	return -1;
+}
+
+static void lat_add(struct lat *l, uint64_t ns)
+{
+	if (l->nr < MAX_SAMPLES)
+		l->ns[l->nr++] = ns;
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct ashmem_pin pin;
+	uint64_t start;
+	unsigned int first, len;
+	int cmd;
+
+	while (!stop) {
+		first = rand_r(&w->seed) % nr_pages;
+		len = 1 + rand_r(&w->seed) % (nr_pages - first);
+		pin.offset = first * page_size;
+		pin.len = len * page_size;
+		cmd = rand_r(&w->seed) & 1 ? ASHMEM_PIN : ASHMEM_UNPIN;
+
+		start = now_ns();
+		if (ioctl(w->fd, cmd, &pin) < 0) {
+			perror("ioctl");
+			break;
+		}
+		lat_add(cmd == ASHMEM_PIN ? &w->pin : &w->unpin,
+			now_ns() - start);
+	}
+	return NULL;
+}
+
+static void *purger_fn(void *arg)
+{
+	struct worker *w = arg;
+
+	while (!stop) {
+		if (ioctl(w->fd, ASHMEM_PURGE_ALL_CACHES) < 0) {
+			if (errno == EPERM)
+				fprintf(stderr, "purger needs CAP_SYS_ADMIN\n");
+			break;
+		}
+		w->purged++;
+		usleep(1000);
+	}
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const char *name, struct lat *all)
+{
+	if (!all->nr) {
+		printf("%-6s no samples\n", name);
+		return;
+	}
+	qsort(all->ns, all->nr, sizeof(all->ns[0]), cmp_u64);
+	printf("%-6s ops %8zu  p50 %7llu ns  p99 %7llu ns  p99.9 %7llu ns  max %7llu ns\n",
+	       name, all->nr,
+	       (unsigned long long)all->ns[all->nr / 2],
+	       (unsigned long long)all->ns[all->nr * 99 / 100],
+	       (unsigned long long)all->ns[all->nr * 999 / 1000],
+	       (unsigned long long)all->ns[all->nr - 1]);
+}
+
+static void merge(struct lat *all, struct lat *l)
+{
+	memcpy(all->ns + all->nr, l->ns, l->nr * sizeof(l->ns[0]));
+	all->nr += l->nr;
+}
+
+int main(int argc, char **argv)
+{
+	struct worker *workers, purger;
+	struct lat pin = { 0 }, unpin = { 0 };
+	int nr_threads = 4, shared = 0, purge = 0;
+	int shared_fd = -1;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "t:p:d:sP")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'p':
+			nr_pages = atoi(optarg);
+			break;
+		case 'd':
+			duration = atoi(optarg);
+			break;
+		case 's':
+			shared = 1;
+			break;
+		case 'P':
+			purge = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t threads] [-p pages] [-d seconds] [-s] [-P]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (nr_threads < 1 || nr_pages < 1 || duration < 1)
+		return 1;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	if (access("/dev/ashmem", R_OK | W_OK)) {
+		printf("ashmem_pin_bench: /dev/ashmem not available, skipping\n");
+		return 0;
+	}
+
+	workers = calloc(nr_threads, sizeof(*workers));
+	if (!workers)
+		return 1;
+
+	if (shared) {
+		shared_fd = area_create();
+		if (shared_fd < 0) {
+			perror("ashmem");
+			return 1;
+		}
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		struct worker *w = &workers[i];
+
+		w->fd = shared ? shared_fd : area_create();
+		if (w->fd < 0) {
+			perror("ashmem");
+			return 1;
+		}
+		w->seed = i + 1;
+		w->pin.ns = malloc(MAX_SAMPLES * sizeof(uint64_t));
+		w->unpin.ns = malloc(MAX_SAMPLES * sizeof(uint64_t));
+		if (!w->pin.ns || !w->unpin.ns)
+			return 1;
+	}
+
+	memset(&purger, 0, sizeof(purger));
+	if (purge) {
+		purger.fd = workers[0].fd;
+		pthread_create(&purger.thread, NULL, purger_fn, &purger);
+	}
+	for (i = 0; i < nr_threads; i++)
+		pthread_create(&workers[i].thread, NULL, worker_fn, &workers[i]);
+
+	sleep(duration);
+	stop = 1;
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(workers[i].thread, NULL);
+	if (purge)
+		pthread_join(purger.thread, NULL);
+
+	pin.ns = malloc((size_t)nr_threads * MAX_SAMPLES * sizeof(uint64_t));
+	unpin.ns = malloc((size_t)nr_threads * MAX_SAMPLES * sizeof(uint64_t));
+	if (!pin.ns || !unpin.ns)
+		return 1;
+	for (i = 0; i < nr_threads; i++) {
+		merge(&pin, &workers[i].pin);
+		merge(&unpin, &workers[i].unpin);
+	}
+
+	printf("threads %d pages %d %s area%s, %d s\n", nr_threads, nr_pages,
+	       shared ? "shared" : "per-thread",
+	       purge ? " with purger" : "", duration);
+	report("pin", &pin);
+	report("unpin", &unpin);
+	if (purge)
+		printf("purges %lu\n", purger.purged);
+
+	return 0;
+}